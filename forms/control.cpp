@@ -7,16 +7,19 @@
 namespace OpenApoc {
 
 Control::Control(Framework &fw, Control* Owner)
-	: owningControl(Owner), focusedChild(nullptr), mouseInside(false), mouseDepressed(false), resolvedLocation(0,0), fw(fw), Name("Control"),Location(0,0), Size(0,0), BackgroundColour( 128, 80, 80 )
+	: dirty(true), renderedLocation(0,0), renderedSize(0,0), owningControl(Owner), focusedChild(nullptr), mouseInside(false), mouseDepressed(false), resolvedLocation(0,0), fw(fw), Name("Control"), ID("Control"), Location(0,0), Size(0,0), BackgroundColour( 128, 80, 80 )
 {
 	if( Owner != nullptr )
 	{
 		Owner->Controls.push_back( this );
+		Owner->SetDirty();
+		Owner->SetLayoutDirty();
 	}
 }
 
 Control::~Control()
 {
+	fw.CancelEvents( this );
 	UnloadResources();
 	// Delete controls
 	while( Controls.size() > 0 )
@@ -30,6 +33,24 @@ Control::~Control()
 void Control::SetFocus(Control* Child)
 {
 	focusedChild = Child;
+	SetDirty();
+}
+
+void Control::SetDirty()
+{
+	for( Control* c = this; c != nullptr; c = c->owningControl )
+	{
+		c->dirty = true;
+	}
+}
+
+void Control::SetLayoutDirty()
+{
+	Form* f = GetForm();
+	if( f != nullptr )
+	{
+		f->InvalidateHitTest();
+	}
 }
 
 Control* Control::GetActiveControl()
@@ -84,50 +105,50 @@ void Control::EventOccured( Event* e )
 		}
 	}
 
-	Event* newevent;
+	ProcessMouseEvent( e );
+
+	if( e->Type == EVENT_KEY_DOWN || e->Type == EVENT_KEY_UP )
+	{
+		if( IsFocused() )
+		{
+			RaiseKeyEvent( (e->Type == EVENT_KEY_DOWN ? FormEventType::KeyDown : FormEventType::KeyUp), e->Data.Keyboard );
 
+			e->Handled = true;
+		}
+	}
+	if( e->Type == EVENT_KEY_PRESS )
+	{
+		if( IsFocused() )
+		{
+			RaiseKeyEvent( FormEventType::KeyPress, e->Data.Keyboard );
+
+			e->Handled = true;
+		}
+	}
+}
+
+void Control::ProcessMouseEvent( Event* e )
+{
 	if( e->Type == EVENT_MOUSE_MOVE )
 	{
 		if( e->Data.Mouse.X >= resolvedLocation.x && e->Data.Mouse.X < resolvedLocation.x + Size.x && e->Data.Mouse.Y >= resolvedLocation.y && e->Data.Mouse.Y < resolvedLocation.y + Size.y )
 		{
 			if( !mouseInside )
 			{
-				newevent = new Event();
-				newevent->Type = EVENT_FORM_INTERACTION;
-				newevent->Data.Forms.RaisedBy = this;
-				newevent->Data.Forms.EventFlag = FormEventType::MouseEnter;
-				memcpy( (void*)&newevent->Data.Forms.MouseInfo, (void*)&e->Data.Mouse, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-				newevent->Data.Forms.MouseInfo.X -= resolvedLocation.x;
-				newevent->Data.Forms.MouseInfo.Y -= resolvedLocation.y;
-				memset( (void*)&newevent->Data.Forms.KeyInfo, 0, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-				fw.PushEvent( newevent );
 				mouseInside = true;
+				SetDirty();
+				RaiseMouseEvent( FormEventType::MouseEnter, e->Data.Mouse );
 			}
 
-			newevent = new Event();
-			newevent->Type = EVENT_FORM_INTERACTION;
-			newevent->Data.Forms.RaisedBy = this;
-			newevent->Data.Forms.EventFlag = FormEventType::MouseMove;
-			memcpy( (void*)&newevent->Data.Forms.MouseInfo, (void*)&e->Data.Mouse, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-			newevent->Data.Forms.MouseInfo.X -= resolvedLocation.x;
-			newevent->Data.Forms.MouseInfo.Y -= resolvedLocation.y;
-			memset( (void*)&newevent->Data.Forms.KeyInfo, 0, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-			fw.PushEvent( newevent );
+			RaiseMouseEvent( FormEventType::MouseMove, e->Data.Mouse );
 
 			e->Handled = true;
 		} else {
 			if( mouseInside )
 			{
-				newevent = new Event();
-				newevent->Type = EVENT_FORM_INTERACTION;
-				newevent->Data.Forms.RaisedBy = this;
-				newevent->Data.Forms.EventFlag = FormEventType::MouseLeave;
-				memcpy( (void*)&newevent->Data.Forms.MouseInfo, (void*)&e->Data.Mouse, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-				newevent->Data.Forms.MouseInfo.X -= resolvedLocation.x;
-				newevent->Data.Forms.MouseInfo.Y -= resolvedLocation.y;
-				memset( (void*)&newevent->Data.Forms.KeyInfo, 0, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-				fw.PushEvent( newevent );
 				mouseInside = false;
+				SetDirty();
+				RaiseMouseEvent( FormEventType::MouseLeave, e->Data.Mouse );
 			}
 		}
 	}
@@ -136,16 +157,9 @@ void Control::EventOccured( Event* e )
 	{
 		if( mouseInside )
 		{
-			newevent = new Event();
-			newevent->Type = EVENT_FORM_INTERACTION;
-			newevent->Data.Forms.RaisedBy = this;
-			newevent->Data.Forms.EventFlag = FormEventType::MouseDown;
-			memcpy( (void*)&newevent->Data.Forms.MouseInfo, (void*)&e->Data.Mouse, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-			newevent->Data.Forms.MouseInfo.X -= resolvedLocation.x;
-			newevent->Data.Forms.MouseInfo.Y -= resolvedLocation.y;
-			memset( (void*)&newevent->Data.Forms.KeyInfo, 0, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-			fw.PushEvent( newevent );
 			mouseDepressed = true;
+			SetDirty();
+			RaiseMouseEvent( FormEventType::MouseDown, e->Data.Mouse );
 
 			e->Handled = true;
 		}
@@ -155,64 +169,45 @@ void Control::EventOccured( Event* e )
 	{
 		if( mouseInside )
 		{
-			newevent = new Event();
-			newevent->Type = EVENT_FORM_INTERACTION;
-			newevent->Data.Forms.RaisedBy = this;
-			newevent->Data.Forms.EventFlag = FormEventType::MouseUp;
-			memcpy( (void*)&newevent->Data.Forms.MouseInfo, (void*)&e->Data.Mouse, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-			newevent->Data.Forms.MouseInfo.X -= resolvedLocation.x;
-			newevent->Data.Forms.MouseInfo.Y -= resolvedLocation.y;
-			memset( (void*)&newevent->Data.Forms.KeyInfo, 0, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-			fw.PushEvent( newevent );
+			RaiseMouseEvent( FormEventType::MouseUp, e->Data.Mouse );
 
 			if( mouseDepressed )
 			{
-				newevent = new Event();
-				newevent->Type = EVENT_FORM_INTERACTION;
-				newevent->Data.Forms.RaisedBy = this;
-				newevent->Data.Forms.EventFlag = FormEventType::MouseClick;
-				memcpy( (void*)&newevent->Data.Forms.MouseInfo, (void*)&e->Data.Mouse, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-				newevent->Data.Forms.MouseInfo.X -= resolvedLocation.x;
-				newevent->Data.Forms.MouseInfo.Y -= resolvedLocation.y;
-				memset( (void*)&newevent->Data.Forms.KeyInfo, 0, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-				fw.PushEvent( newevent );
+				RaiseMouseEvent( FormEventType::MouseClick, e->Data.Mouse );
 			}
 
 			e->Handled = true;
 		}
-		mouseDepressed = false;
-	}
-
-	if( e->Type == EVENT_KEY_DOWN || e->Type == EVENT_KEY_UP )
-	{
-		if( IsFocused() )
+		if( mouseDepressed )
 		{
-			newevent = new Event();
-			newevent->Type = EVENT_FORM_INTERACTION;
-			newevent->Data.Forms.RaisedBy = this;
-			newevent->Data.Forms.EventFlag = (e->Type == EVENT_KEY_DOWN ? FormEventType::KeyDown : FormEventType::KeyUp);
-			memcpy( (void*)&newevent->Data.Forms.KeyInfo, (void*)&e->Data.Keyboard, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-			memset( (void*)&newevent->Data.Forms.MouseInfo, 0, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-			fw.PushEvent( newevent );
-
-			e->Handled = true;
+			mouseDepressed = false;
+			SetDirty();
 		}
 	}
-	if( e->Type == EVENT_KEY_PRESS )
-	{
-		if( IsFocused() )
-		{
-			newevent = new Event();
-			newevent->Type = EVENT_FORM_INTERACTION;
-			newevent->Data.Forms.RaisedBy = this;
-			newevent->Data.Forms.EventFlag = FormEventType::KeyPress;
-			memcpy( (void*)&newevent->Data.Forms.KeyInfo, (void*)&e->Data.Keyboard, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
-			memset( (void*)&newevent->Data.Forms.MouseInfo, 0, sizeof( FRAMEWORK_MOUSE_EVENT ) );
-			fw.PushEvent( newevent );
+}
 
-			e->Handled = true;
-		}
-	}
+void Control::RaiseMouseEvent( FormEventType Type, const FRAMEWORK_MOUSE_EVENT& Mouse )
+{
+	Event formevent;
+	formevent.Type = EVENT_FORM_INTERACTION;
+	formevent.Data.Forms.RaisedBy = this;
+	formevent.Data.Forms.EventFlag = Type;
+	formevent.Data.Forms.MouseInfo = Mouse;
+	formevent.Data.Forms.MouseInfo.X -= resolvedLocation.x;
+	formevent.Data.Forms.MouseInfo.Y -= resolvedLocation.y;
+	memset( (void*)&formevent.Data.Forms.KeyInfo, 0, sizeof( FRAMEWORK_KEYBOARD_EVENT ) );
+	fw.DispatchEvent( &formevent );
+}
+
+void Control::RaiseKeyEvent( FormEventType Type, const FRAMEWORK_KEYBOARD_EVENT& Keyboard )
+{
+	Event formevent;
+	formevent.Type = EVENT_FORM_INTERACTION;
+	formevent.Data.Forms.RaisedBy = this;
+	formevent.Data.Forms.EventFlag = Type;
+	formevent.Data.Forms.KeyInfo = Keyboard;
+	memset( (void*)&formevent.Data.Forms.MouseInfo, 0, sizeof( FRAMEWORK_MOUSE_EVENT ) );
+	fw.DispatchEvent( &formevent );
 }
 
 void Control::Render()
@@ -226,14 +221,19 @@ void Control::Render()
 		controlArea->size != Vec2<unsigned int>{Size.x, Size.y})
 	{
 		controlArea.reset(new Surface{Vec2<unsigned int>{Size.x, Size.y}});
+		dirty = true;
 	}
+	if( dirty )
 	{
-
+		//Cleared first, so anything marked dirty while rendering is picked up next frame
+		dirty = false;
 		RendererSurfaceBinding b(*fw.renderer, controlArea);
 		PreRender();
 		OnRender();
 		PostRender();
 	}
+	renderedLocation = Location;
+	renderedSize = Size;
 
 	fw.renderer->draw(controlArea, Vec2<float>{Location.x, Location.y});
 }
@@ -253,12 +253,25 @@ void Control::PostRender()
 	for( auto ctrlidx = Controls.begin(); ctrlidx != Controls.end(); ctrlidx++ )
 	{
 		Control* c = (Control*)*ctrlidx;
+		//Children entirely outside this control (e.g. scrolled out of a list)
+		//would be clipped anyway, so don't render them. Their geometry is
+		//still recorded so Update() doesn't keep marking them dirty
+		if( c->Location.x >= Size.x || c->Location.y >= Size.y || c->Location.x + c->Size.x <= 0 || c->Location.y + c->Size.y <= 0 )
+		{
+			c->renderedLocation = c->Location;
+			c->renderedSize = c->Size;
+			continue;
+		}
 		c->Render();
 	}
 }
 
 void Control::Update()
 {
+	if( Location != renderedLocation || Size != renderedSize )
+	{
+		SetDirty();
+	}
 	for( auto ctrlidx = Controls.begin(); ctrlidx != Controls.end(); ctrlidx++ )
 	{
 		Control* c = (Control*)*ctrlidx;
@@ -278,6 +291,7 @@ void Control::ConfigureFromXML( tinyxml2::XMLElement* Element )
 	{
 		nodename = Element->Attribute("id");
 		this->Name = nodename;
+		this->ID = Atom(nodename);
 	}
 
 	tinyxml2::XMLElement* node;
@@ -360,6 +374,11 @@ void Control::ConfigureFromXML( tinyxml2::XMLElement* Element )
 						l->TextVAlign = VerticalAlignment::Bottom;
 					}
 				}
+				if( subnode->Attribute("wordwrap") != nullptr )
+				{
+					attribvalue = subnode->Attribute("wordwrap");
+					l->WordWrap = ( attribvalue == "true" );
+				}
 			}
 		}
 		if( nodename == "graphic" )
@@ -576,12 +595,12 @@ Control* Control::operator[]( int Index )
 	return Controls.at( Index );
 }
 
-Control* Control::FindControl( UString ID )
+Control* Control::FindControl( Atom ControlID )
 {
 	for( auto c = Controls.begin(); c != Controls.end(); c++ )
 	{
 		Control* ctrl = (Control*)*c;
-		if( ctrl->Name == ID )
+		if( ctrl->ID == ControlID )
 		{
 			return ctrl;
 		}
@@ -589,6 +608,11 @@ Control* Control::FindControl( UString ID )
 	return nullptr;
 }
 
+Control* Control::FindControl( UString ControlName )
+{
+	return FindControl( Atom( ControlName ) );
+}
+
 Control* Control::GetParent()
 {
 	return owningControl;
@@ -3,18 +3,26 @@
 
 #include "framework/includes.h"
 #include "library/colour.h"
+#include "library/atom.h"
+#include "framework/event.h"
 
 namespace OpenApoc {
 
 class Form;
-class Event;
 class Framework;
 class Surface;
 
 class Control
 {
+	friend class Form;
+
 	private:
 		std::shared_ptr<Surface> controlArea;
+		//Set when controlArea no longer matches what OnRender() would draw
+		bool dirty;
+		//Location and Size as of the last Render(), to catch direct changes
+		Vec2<int> renderedLocation;
+		Vec2<int> renderedSize;
 
 		void PreRender();
 		void PostRender();
@@ -34,6 +42,15 @@ class Control
 		bool IsFocused();
 
 		void ResolveLocation();
+
+		//Build an EVENT_FORM_INTERACTION raised by this control on the stack
+		//and hand it to Framework::DispatchEvent(), which delivers it once
+		//the event being handled (if any) is done. Mouse coordinates are
+		//made relative to this control
+		void RaiseMouseEvent( FormEventType Type, const FRAMEWORK_MOUSE_EVENT& Mouse );
+		//Handles a raw mouse event for this control alone, not its children
+		void ProcessMouseEvent( Event* e );
+		void RaiseKeyEvent( FormEventType Type, const FRAMEWORK_KEYBOARD_EVENT& Keyboard );
 		void ConfigureFromXML( tinyxml2::XMLElement* Element );
 
 		Control* GetRootControl();
@@ -42,6 +59,8 @@ class Control
 
 	public:
 		UString Name;
+		//Interned Name, compare against this rather than Name
+		Atom ID;
 		Vec2<int> Location;
 		Vec2<int> Size;
 		Colour BackgroundColour;
@@ -55,12 +74,20 @@ class Control
 		void Focus();
 
 		virtual void EventOccured(Event* e);
+		//Only re-renders controlArea if this or a child has been marked dirty
 		void Render();
+		//Call whenever something OnRender() draws changes. Also marks all
+		//parents dirty, as they contain this control's image
+		void SetDirty();
+		//Call whenever controls are added to or removed from below this one,
+		//so the form rebuilds its hit-test index
+		void SetLayoutDirty();
 		virtual void Update();
 		virtual void UnloadResources();
 
 		Control* operator[]( int Index );
-		Control* FindControl( UString ID );
+		Control* FindControl( Atom ControlID );
+		Control* FindControl( UString ControlName );
 
 		Control* GetParent();
 		Form* GetForm();
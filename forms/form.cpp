@@ -2,7 +2,7 @@
 
 namespace OpenApoc {
 
-Form::Form( Framework &fw, tinyxml2::XMLElement* FormConfiguration ) : Control( fw, nullptr )
+Form::Form( Framework &fw, tinyxml2::XMLElement* FormConfiguration ) : Control( fw, nullptr ), hitTestDirty(true)
 {
 	if( FormConfiguration == nullptr )
 	{
@@ -37,9 +37,128 @@ Form::~Form()
 
 void Form::EventOccured( Event* e )
 {
+	switch( e->Type )
+	{
+		case EVENT_MOUSE_MOVE:
+		case EVENT_MOUSE_DOWN:
+		case EVENT_MOUSE_UP:
+			DispatchMouseEvent( e );
+			return;
+		case EVENT_FORM_INTERACTION:
+			//Hover events are only ever acted on by the control that raised
+			//them, so don't walk the whole form for them
+			if( e->Data.Forms.EventFlag == FormEventType::MouseMove || e->Data.Forms.EventFlag == FormEventType::MouseEnter || e->Data.Forms.EventFlag == FormEventType::MouseLeave )
+			{
+				Control* raisedBy = e->Data.Forms.RaisedBy;
+				if( raisedBy != nullptr && raisedBy != this && raisedBy->GetForm() == this )
+				{
+					raisedBy->EventOccured( e );
+				}
+				return;
+			}
+			break;
+		default:
+			break;
+	}
 	Control::EventOccured( e );
 }
 
+void Form::InvalidateHitTest()
+{
+	hitTestDirty = true;
+}
+
+void Form::AddToHitTest( Control* Ctrl )
+{
+	for( auto ctrlidx = Ctrl->Controls.rbegin(); ctrlidx != Ctrl->Controls.rend(); ctrlidx++ )
+	{
+		AddToHitTest( *ctrlidx );
+	}
+	hitTestControls.push_back( Ctrl );
+	hitTest.Add( Rect<int>( Ctrl->resolvedLocation, Ctrl->resolvedLocation + Ctrl->Size ) );
+}
+
+void Form::RebuildHitTest()
+{
+	hitTestControls.clear();
+	hitTest.Clear();
+	AddToHitTest( this );
+	hitTest.Build();
+
+	mouseInsideControls.clear();
+	for( unsigned i = 0; i < hitTestControls.size(); i++ )
+	{
+		if( hitTestControls[i]->mouseInside )
+		{
+			mouseInsideControls.push_back( i );
+		}
+	}
+	hitTestDirty = false;
+}
+
+void Form::DispatchMouseEvent( Event* e )
+{
+	if( hitTestDirty )
+	{
+		RebuildHitTest();
+	}
+
+	if( e->Type != EVENT_MOUSE_MOVE )
+	{
+		//Presses go to the first control the mouse is inside, and releases
+		//also reset every control passed over on the way. Both are rare
+		//enough to just walk the list
+		for( unsigned i = 0; i < hitTestControls.size(); i++ )
+		{
+			hitTestControls[i]->ProcessMouseEvent( e );
+			if( e->Handled || hitTestDirty )
+			{
+				return;
+			}
+		}
+		return;
+	}
+
+	//The control under the cursor gets the move, and any control that would
+	//have been offered the event before it (and so isn't under the cursor)
+	//gets a leave if the mouse was inside it
+	int hit = hitTest.Find( Vec2<int>( e->Data.Mouse.X, e->Data.Mouse.Y ) );
+	unsigned limit = (hit < 0 ? hitTestControls.size() : (unsigned)hit);
+
+	//mouseInsideControls is kept sorted, and compacted in place so mouse
+	//motion doesn't allocate
+	unsigned kept = 0;
+	for( unsigned n = 0; n < mouseInsideControls.size(); n++ )
+	{
+		unsigned i = mouseInsideControls[n];
+		if( i < limit )
+		{
+			hitTestControls[i]->ProcessMouseEvent( e );
+			if( hitTestDirty )
+			{
+				//A handler changed the form - the next event rebuilds from
+				//each control's own state
+				return;
+			}
+		}
+		if( hitTestControls[i]->mouseInside && (int)i != hit )
+		{
+			mouseInsideControls[kept++] = i;
+		}
+	}
+	mouseInsideControls.resize( kept );
+
+	if( hit >= 0 )
+	{
+		Control* c = hitTestControls[hit];
+		c->ProcessMouseEvent( e );
+		if( !hitTestDirty && c->mouseInside )
+		{
+			mouseInsideControls.insert( std::lower_bound( mouseInsideControls.begin(), mouseInsideControls.end(), (unsigned)hit ), hit );
+		}
+	}
+}
+
 void Form::OnRender()
 {
 }
@@ -48,6 +167,20 @@ void Form::Update()
 {
 	Control::Update();
 	ResolveLocation();
+
+	//Catch controls that have moved or resized since the index was built
+	if( !hitTestDirty )
+	{
+		for( unsigned i = 0; i < hitTestControls.size(); i++ )
+		{
+			Control* c = hitTestControls[i];
+			if( !(hitTest.GetBounds( i ) == Rect<int>( c->resolvedLocation, c->resolvedLocation + c->Size )) )
+			{
+				hitTestDirty = true;
+				break;
+			}
+		}
+	}
 }
 
 void Form::UnloadResources()
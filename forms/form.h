@@ -2,6 +2,7 @@
 #pragma once
 
 #include "control.h"
+#include "hittestgrid.h"
 
 namespace OpenApoc {
 
@@ -10,6 +11,20 @@ class Framework;
 class Form : public Control
 {
 
+	private:
+		//Every control in the form, in the order Control::EventOccured would
+		//offer them a mouse event - children before parents, last-added first
+		std::vector<Control*> hitTestControls;
+		//Resolved rectangle of each entry in hitTestControls
+		HitTestGrid hitTest;
+		bool hitTestDirty;
+		//Indices into hitTestControls of controls with mouseInside set
+		std::vector<unsigned> mouseInsideControls;
+
+		void AddToHitTest( Control* Ctrl );
+		void RebuildHitTest();
+		void DispatchMouseEvent( Event* e );
+
 	protected:
 		virtual void OnRender();
 
@@ -20,6 +35,9 @@ class Form : public Control
 		virtual void EventOccured( Event* e );
 		virtual void Update();
 		virtual void UnloadResources();
+
+		//Forces the hit-test index to be rebuilt before the next mouse event
+		void InvalidateHitTest();
 };
 
 }; //namespace OpenApoc
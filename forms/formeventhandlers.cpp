@@ -0,0 +1,33 @@
+
+#include "forms/formeventhandlers.h"
+#include "forms/control.h"
+#include "framework/event.h"
+
+namespace OpenApoc {
+
+void FormEventHandlers::Bind( Atom ControlID, FormEventType EventType, Handler EventHandler )
+{
+	handlers[std::make_pair( ControlID, EventType )] = EventHandler;
+}
+
+void FormEventHandlers::Bind( UString ControlName, FormEventType EventType, Handler EventHandler )
+{
+	Bind( Atom( ControlName ), EventType, EventHandler );
+}
+
+bool FormEventHandlers::Dispatch( Event* e ) const
+{
+	if( e->Type != EVENT_FORM_INTERACTION )
+	{
+		return false;
+	}
+	auto handler = handlers.find( std::make_pair( e->Data.Forms.RaisedBy->ID, e->Data.Forms.EventFlag ) );
+	if( handler == handlers.end() )
+	{
+		return false;
+	}
+	handler->second( e );
+	return true;
+}
+
+}; //namespace OpenApoc
@@ -0,0 +1,32 @@
+
+#pragma once
+
+#include "framework/includes.h"
+#include "library/atom.h"
+#include "forms_enums.h"
+
+#include <functional>
+
+namespace OpenApoc {
+
+class Event;
+
+//Maps (control ID, form event type) to a handler. Stages bind their handlers
+//once at construction, then pass EVENT_FORM_INTERACTION events to Dispatch()
+//instead of comparing the raising control's name against string literals.
+class FormEventHandlers
+{
+	public:
+		typedef std::function<void(Event*)> Handler;
+
+		void Bind( Atom ControlID, FormEventType EventType, Handler EventHandler );
+		void Bind( UString ControlName, FormEventType EventType, Handler EventHandler );
+
+		//Returns true if a handler was bound for the event's control and type
+		bool Dispatch( Event* e ) const;
+
+	private:
+		std::map<std::pair<Atom, FormEventType>, Handler> handlers;
+};
+
+}; //namespace OpenApoc
@@ -12,4 +12,5 @@
 #include "vscrollbar.h"
 #include "hscrollbar.h"
 #include "list.h"
-#include "textedit.h"
\ No newline at end of file
+#include "textedit.h"
+#include "formeventhandlers.h"
\ No newline at end of file
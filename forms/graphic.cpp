@@ -61,6 +61,7 @@ std::shared_ptr<Image> Graphic::GetImage()
 void Graphic::SetImage( std::shared_ptr<Image> Image )
 {
 	image = Image;
+	SetDirty();
 }
 
 }; //namespace OpenApoc
@@ -43,11 +43,11 @@ void GraphicButton::EventOccured( Event* e )
 
 	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.RaisedBy == this && e->Data.Forms.EventFlag == FormEventType::MouseClick )
 	{
-		Event* ce = new Event();
-		ce->Type = e->Type;
-		memcpy( (void*)&(ce->Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
-		ce->Data.Forms.EventFlag = FormEventType::ButtonClick;
-		fw.PushEvent( ce );
+		Event ce;
+		ce.Type = e->Type;
+		memcpy( (void*)&(ce.Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
+		ce.Data.Forms.EventFlag = FormEventType::ButtonClick;
+		fw.DispatchEvent( &ce );
 	}
 }
 
@@ -135,6 +135,7 @@ void GraphicButton::SetImage( std::shared_ptr<Image> Image )
 {
 	image_name = "";
 	image = Image;
+	SetDirty();
 }
 
 std::shared_ptr<Image> GraphicButton::GetDepressedImage()
@@ -146,6 +147,7 @@ void GraphicButton::SetDepressedImage( std::shared_ptr<Image> Image )
 {
 	imagedepressed_name = "";
 	imagedepressed = Image;
+	SetDirty();
 }
 
 std::shared_ptr<Image> GraphicButton::GetHoverImage()
@@ -157,6 +159,7 @@ void GraphicButton::SetHoverImage( std::shared_ptr<Image> Image )
 {
 	imagehover_name = "";
 	imagehover = Image;
+	SetDirty();
 }
 
 }; //namespace OpenApoc
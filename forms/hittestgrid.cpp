@@ -0,0 +1,118 @@
+
+#include "forms/hittestgrid.h"
+
+namespace OpenApoc {
+
+HitTestGrid::HitTestGrid( int CellSize ) : cellSize(CellSize), origin(0,0), cellCount(0,0)
+{
+}
+
+void HitTestGrid::Clear()
+{
+	bounds.clear();
+	cells.clear();
+	origin = Vec2<int>(0,0);
+	cellCount = Vec2<int>(0,0);
+}
+
+unsigned HitTestGrid::Add( Rect<int> Bounds )
+{
+	bounds.push_back( Bounds );
+	return bounds.size() - 1;
+}
+
+static int FloorDiv( int a, int b )
+{
+	return (a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+
+void HitTestGrid::Build()
+{
+	cells.clear();
+
+	bool first = true;
+	Vec2<int> minPos(0,0), maxPos(0,0);
+	for( auto &r : bounds )
+	{
+		if( r.p1.x <= r.p0.x || r.p1.y <= r.p0.y )
+		{
+			continue;
+		}
+		if( first )
+		{
+			minPos = r.p0;
+			maxPos = r.p1;
+			first = false;
+		} else {
+			minPos.x = std::min( minPos.x, r.p0.x );
+			minPos.y = std::min( minPos.y, r.p0.y );
+			maxPos.x = std::max( maxPos.x, r.p1.x );
+			maxPos.y = std::max( maxPos.y, r.p1.y );
+		}
+	}
+	if( first )
+	{
+		cellCount = Vec2<int>(0,0);
+		return;
+	}
+
+	origin = Vec2<int>( FloorDiv( minPos.x, cellSize ) * cellSize, FloorDiv( minPos.y, cellSize ) * cellSize );
+	cellCount.x = (maxPos.x - origin.x + cellSize - 1) / cellSize;
+	cellCount.y = (maxPos.y - origin.y + cellSize - 1) / cellSize;
+	cells.resize( cellCount.x * cellCount.y );
+
+	for( unsigned i = 0; i < bounds.size(); i++ )
+	{
+		auto &r = bounds[i];
+		if( r.p1.x <= r.p0.x || r.p1.y <= r.p0.y )
+		{
+			continue;
+		}
+		int x0 = (r.p0.x - origin.x) / cellSize;
+		int y0 = (r.p0.y - origin.y) / cellSize;
+		int x1 = (r.p1.x - 1 - origin.x) / cellSize;
+		int y1 = (r.p1.y - 1 - origin.y) / cellSize;
+		for( int y = y0; y <= y1; y++ )
+		{
+			for( int x = x0; x <= x1; x++ )
+			{
+				cells[y * cellCount.x + x].push_back( i );
+			}
+		}
+	}
+}
+
+int HitTestGrid::Find( Vec2<int> Point ) const
+{
+	if( Point.x < origin.x || Point.y < origin.y )
+	{
+		return -1;
+	}
+	int x = (Point.x - origin.x) / cellSize;
+	int y = (Point.y - origin.y) / cellSize;
+	if( x >= cellCount.x || y >= cellCount.y )
+	{
+		return -1;
+	}
+	for( unsigned i : cells[y * cellCount.x + x] )
+	{
+		Rect<int> r = bounds[i];
+		if( r.within( Point ) )
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+unsigned HitTestGrid::Count() const
+{
+	return bounds.size();
+}
+
+const Rect<int>& HitTestGrid::GetBounds( unsigned Index ) const
+{
+	return bounds[Index];
+}
+
+}; //namespace OpenApoc
@@ -0,0 +1,37 @@
+
+#pragma once
+
+#include "framework/includes.h"
+
+namespace OpenApoc {
+
+//Uniform grid over a list of rectangles, finding the first rectangle (in
+//the order they were added) that contains a point without testing them
+//all. Rectangles are identified by the order they were added in.
+class HitTestGrid
+{
+	private:
+		int cellSize;
+		Vec2<int> origin;
+		Vec2<int> cellCount;
+		std::vector<Rect<int>> bounds;
+		//Indices into bounds, ascending, of every rectangle touching each cell
+		std::vector<std::vector<unsigned>> cells;
+
+	public:
+		HitTestGrid( int CellSize = 64 );
+
+		void Clear();
+		//Rectangles must be added highest priority first
+		unsigned Add( Rect<int> Bounds );
+		//Call once all rectangles are added, before Find()
+		void Build();
+
+		//Returns the index of the first rectangle containing Point, or -1
+		int Find( Vec2<int> Point ) const;
+
+		unsigned Count() const;
+		const Rect<int>& GetBounds( unsigned Index ) const;
+};
+
+}; //namespace OpenApoc
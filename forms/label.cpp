@@ -4,7 +4,7 @@
 
 namespace OpenApoc {
 
-Label::Label( Framework &fw, Control* Owner, UString Text, std::shared_ptr<BitmapFont> font ) : Control( fw, Owner ), text( Text ), font( font ), TextHAlign( HorizontalAlignment::Left ), TextVAlign( VerticalAlignment::Top )
+Label::Label( Framework &fw, Control* Owner, UString Text, std::shared_ptr<BitmapFont> font ) : Control( fw, Owner ), text( Text ), font( font ), TextHAlign( HorizontalAlignment::Left ), TextVAlign( VerticalAlignment::Top ), WordWrap( false )
 {
 }
 
@@ -22,6 +22,28 @@ void Label::OnRender()
 	int xpos;
 	int ypos;
 
+	if( WordWrap )
+	{
+		auto layout = font->layoutText( text, Size.x, TextHAlign );
+		switch( TextVAlign )
+		{
+			case VerticalAlignment::Top:
+				ypos = 0;
+				break;
+			case VerticalAlignment::Centre:
+				ypos = (Size.y / 2) - (layout->size.y / 2);
+				break;
+			case VerticalAlignment::Bottom:
+				ypos = Size.y - layout->size.y;
+				break;
+			default:
+				LogError("Unknown TextVAlign");
+				return;
+		}
+		font->drawText(*fw.renderer, *layout, Vec2<float>{0, ypos});
+		return;
+	}
+
 	switch( TextHAlign )
 	{
 		case HorizontalAlignment::Left:
@@ -54,8 +76,7 @@ void Label::OnRender()
 			return;
 	}
 
-	auto textImage = font->getString(text);
-	fw.renderer->draw(textImage, Vec2<float>{xpos, ypos});
+	font->drawString(*fw.renderer, text, Vec2<float>{xpos, ypos});
 }
 
 void Label::Update()
@@ -75,6 +96,7 @@ UString Label::GetText()
 void Label::SetText( UString Text )
 {
 	text = Text;
+	SetDirty();
 }
 
 }; //namespace OpenApoc
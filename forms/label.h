@@ -22,6 +22,8 @@ class Label : public Control
 	public:
 		HorizontalAlignment TextHAlign;
 		VerticalAlignment TextVAlign;
+		//Wrap the text to the label's width, honouring newlines
+		bool WordWrap;
 
 		Label(Framework &fw, Control* Owner, UString Text, std::shared_ptr<BitmapFont> font);
 		virtual ~Label();
@@ -1,15 +1,16 @@
 
 #include "forms/list.h"
 #include "forms/vscrollbar.h"
+#include "framework/logger.h"
 
 namespace OpenApoc {
 
-ListBox::ListBox( Framework &fw, Control* Owner ) : Control( fw, Owner )
+ListBox::ListBox( Framework &fw, Control* Owner ) : Control( fw, Owner ), renderedScrollValue(0), itemCount(0), rowHeight(64), rowsInvalid(false)
 {
 	ConfigureInternalScrollBar();
 }
 
-ListBox::ListBox( Framework &fw, Control* Owner, VScrollBar* ExternalScrollBar ) : Control( fw, Owner )
+ListBox::ListBox( Framework &fw, Control* Owner, VScrollBar* ExternalScrollBar ) : Control( fw, Owner ), renderedScrollValue(0), itemCount(0), rowHeight(64), rowsInvalid(false)
 {
 	if( ExternalScrollBar == nullptr )
 	{
@@ -43,6 +44,12 @@ void ListBox::OnRender()
 		scroller->Size.y = this->Size.y;
 	}
 
+	if( itemSource )
+	{
+		//Virtual rows are laid out in Update()
+		return;
+	}
+
 	int yoffset = 0;
 
 	for( auto c = Controls.begin(); c != Controls.end(); c++ )
@@ -59,7 +66,7 @@ void ListBox::OnRender()
 	}
 	scroller->Maximum = (yoffset - this->Size.y);
 	scroller->LargeChange = Maths::Max( (scroller->Maximum - scroller->Minimum + 2) / 10.0f, 4.0f );
-
+	renderedScrollValue = scroller->Value;
 }
 
 void ListBox::EventOccured( Event* e )
@@ -69,6 +76,130 @@ void ListBox::EventOccured( Event* e )
 
 void ListBox::Update()
 {
+	if( itemSource )
+	{
+		UpdateVirtualRows();
+	}
+	else if( scroller->Value != renderedScrollValue )
+	{
+		//The items are only moved to the new position in OnRender()
+		SetDirty();
+	}
+	Control::Update();
+}
+
+void ListBox::UpdateVirtualRows()
+{
+	int stride = rowHeight + 1;
+
+	scroller->Maximum = Maths::Max( itemCount * stride - Size.y, 0 );
+	scroller->LargeChange = Maths::Max( (scroller->Maximum - scroller->Minimum + 2) / 10.0f, 4.0f );
+	if( scroller->Value > scroller->Maximum )
+	{
+		scroller->Value = scroller->Maximum;
+		scroller->SetDirty();
+	}
+
+	int offset = scroller->Value;
+	int wantFirst, wantEnd;
+	VirtualRows::Window( offset, Size.y, stride, itemCount, RowMargin, wantFirst, wantEnd );
+
+	auto fetch = [this]( int Index, Control* Recycled ) { return FetchRow( Index, Recycled ); };
+	auto detach = [this]( Control* Row ) { DetachRow( Row ); };
+	if( virtualRows.Update( wantFirst, wantEnd, rowsInvalid, fetch, detach ) )
+	{
+		SetLayoutDirty();
+		SetDirty();
+	}
+	rowsInvalid = false;
+
+	int rowWidth = ( scroller_is_internal ? Size.x - scroller->Size.x : Size.x );
+	int firstRow = virtualRows.GetFirst();
+	auto &rows = virtualRows.GetRows();
+	for( unsigned i = 0; i < rows.size(); i++ )
+	{
+		Control* row = rows[i];
+		if( row == nullptr )
+		{
+			continue;
+		}
+		row->Location.x = 0;
+		row->Location.y = (firstRow + (int)i) * stride - offset;
+		row->Size.x = rowWidth;
+		row->Size.y = rowHeight;
+	}
+}
+
+void ListBox::DetachRow( Control* Row )
+{
+	auto c = std::find( Controls.begin(), Controls.end(), Row );
+	if( c != Controls.end() )
+	{
+		Controls.erase( c );
+	}
+	if( focusedChild == Row )
+	{
+		focusedChild = nullptr;
+	}
+}
+
+Control* ListBox::FetchRow( int Index, Control* Recycled )
+{
+	Control* row = itemSource( Index, Recycled );
+	if( row == nullptr )
+	{
+		LogError("ListBox item source gave no row for item %d", Index);
+		return nullptr;
+	}
+	if( row == Recycled )
+	{
+		Controls.push_back( row );
+	}
+	else if( row->GetParent() != this )
+	{
+		LogError("ListBox row for item %d isn't owned by the list", Index);
+	}
+	return row;
+}
+
+void ListBox::SetItemSource( int Count, int RowHeight, std::function<Control*( int Index, Control* Recycled )> Source )
+{
+	//Drop anything added with AddItem() and the live rows, then the spare
+	//rows, which were made by the old source and may not suit the new one
+	for( auto c = Controls.begin(); c != Controls.end(); )
+	{
+		if( *c == scroller )
+		{
+			c++;
+			continue;
+		}
+		delete *c;
+		c = Controls.erase( c );
+	}
+	for( auto row : virtualRows.Reset() )
+	{
+		delete row;
+	}
+
+	itemSource = Source;
+	itemCount = Count;
+	rowHeight = RowHeight;
+	rowsInvalid = true;
+	scroller->Value = scroller->Minimum;
+	scroller->SetDirty();
+	SetLayoutDirty();
+	SetDirty();
+}
+
+void ListBox::SetItemCount( int Count )
+{
+	itemCount = Count;
+	rowsInvalid = true;
+}
+
+void ListBox::InvalidateItems()
+{
+	rowsInvalid = true;
 }
 
 void ListBox::UnloadResources()
@@ -82,11 +213,21 @@ void ListBox::Clear()
 		delete Controls.back();
 		Controls.pop_back();
 	}
+	for( auto row : virtualRows.Reset() )
+	{
+		delete row;
+	}
+	itemSource = nullptr;
+	itemCount = 0;
+	SetDirty();
+	SetLayoutDirty();
 }
 
 void ListBox::AddItem( Control* Item )
 {
 	Controls.push_back( Item );
+	SetDirty();
+	SetLayoutDirty();
 }
 
 Control* ListBox::RemoveItem( Control* Item )
@@ -96,6 +237,8 @@ Control* ListBox::RemoveItem( Control* Item )
 		if( (Control*)*i == Item )
 		{
 			Controls.erase( i );
+			SetDirty();
+			SetLayoutDirty();
 			return Item;
 		}
 	}
@@ -106,6 +249,8 @@ Control* ListBox::RemoveItem( int Index )
 {
 	Control* c = Controls.at(Index);
 	Controls.erase( Controls.begin() + Index );
+	SetDirty();
+	SetLayoutDirty();
 	return c;
 }
 
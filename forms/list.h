@@ -2,6 +2,8 @@
 #pragma once
 
 #include "control.h"
+#include "virtualrows.h"
+#include <functional>
 
 namespace OpenApoc {
 
@@ -14,9 +16,27 @@ class ListBox : public Control
 		// std::vector<Control*> items;
 		VScrollBar* scroller;
 		bool scroller_is_internal;
+		//The scroll position OnRender() laid the items out for. An external
+		//scrollbar doesn't dirty the list when it moves, so Update() checks
+		int renderedScrollValue;
 
 		void ConfigureInternalScrollBar();
 
+		//Virtual mode - see SetItemSource()
+		std::function<Control*( int Index, Control* Recycled )> itemSource;
+		int itemCount;
+		int rowHeight;
+		VirtualRows virtualRows;
+		bool rowsInvalid;
+		//Rows kept alive either side of the visible ones
+		static const int RowMargin = 2;
+
+		void UpdateVirtualRows();
+		//Takes a row that has left the window out of Controls, so it can be
+		//kept as spare for FetchRow()
+		void DetachRow( Control* Row );
+		Control* FetchRow( int Index, Control* Recycled );
+
 	protected:
 		virtual void OnRender();
 
@@ -34,6 +54,16 @@ class ListBox : public Control
 		Control* RemoveItem( Control* Item );
 		Control* RemoveItem( int Index );
 		Control* operator[]( int Index );
+
+		//Switches to virtual mode. Rather than every item being added up front,
+		//only rows in view have controls, and Source is called to fill in a
+		//row for an item index as it scrolls into view. Recycled is a row that
+		//has scrolled out of view (or nullptr) which Source should reuse if
+		//possible; any new row must be created with this list as its owner.
+		void SetItemSource( int Count, int RowHeight, std::function<Control*( int Index, Control* Recycled )> Source );
+		void SetItemCount( int Count );
+		//Has Source refill every row in view, e.g. after the data changes
+		void InvalidateItems();
 };
 
 }; //namespace OpenApoc
@@ -25,11 +25,11 @@ void TextButton::EventOccured( Event* e )
 
 	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.RaisedBy == this && e->Data.Forms.EventFlag == FormEventType::MouseClick )
 	{
-		Event* ce = new Event();
-		ce->Type = e->Type;
-		memcpy( (void*)&(ce->Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
-		ce->Data.Forms.EventFlag = FormEventType::ButtonClick;
-		fw.PushEvent( ce );
+		Event ce;
+		ce.Type = e->Type;
+		memcpy( (void*)&(ce.Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
+		ce.Data.Forms.EventFlag = FormEventType::ButtonClick;
+		fw.DispatchEvent( &ce );
 	}
 }
 
@@ -83,8 +83,7 @@ void TextButton::OnRender()
 				return;
 		}
 
-		auto textImage = font->getString(text);
-		fw.renderer->draw(textImage, Vec2<float>{xpos,ypos});
+		font->drawString(*fw.renderer, text, Vec2<float>{xpos,ypos});
 	}
 	fw.renderer->draw(cached, Vec2<float>{0,0});
 
@@ -111,6 +110,8 @@ UString TextButton::GetText()
 void TextButton::SetText( UString Text )
 {
 	text = Text;
+	cached.reset();
+	SetDirty();
 }
 
 }; //namespace OpenApoc
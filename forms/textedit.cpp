@@ -28,21 +28,26 @@ void TextEdit::EventOccured( Event* e )
 			if( e->Data.Forms.EventFlag == FormEventType::GotFocus || e->Data.Forms.EventFlag == FormEventType::MouseClick || e->Data.Forms.EventFlag == FormEventType::KeyDown )
 			{
 				editting = true;
+				SetDirty();
 				//e->Handled = true;
 			}
 			if( e->Data.Forms.EventFlag == FormEventType::LostFocus )
 			{
 				editting = false;
+				SetDirty();
 				RaiseEvent( FormEventType::TextEditFinish );
 				//e->Handled = true;
 			}
 		} else if( e->Data.Forms.EventFlag == FormEventType::MouseClick ) {
 			editting = false;
+			SetDirty();
 			RaiseEvent( FormEventType::TextEditFinish );
 		}
 
 		if( e->Data.Forms.EventFlag == FormEventType::KeyPress && editting )
 		{
+			//Most keys move the caret or change the text
+			SetDirty();
 			switch( e->Data.Forms.KeyInfo.KeyCode )
 			{
 				case ALLEGRO_KEY_BACKSPACE:
@@ -188,8 +193,7 @@ void TextEdit::OnRender()
 		}
 	}
 
-	auto textImage = font->getString(text);
-	fw.renderer->draw(textImage, Vec2<float>{xpos, ypos});
+	font->drawString(*fw.renderer, text, Vec2<float>{xpos, ypos});
 }
 
 void TextEdit::Update()
@@ -200,6 +204,7 @@ void TextEdit::Update()
 		if( caretTimer == 0 )
 		{
 			caretDraw = !caretDraw;
+			SetDirty();
 		}
 	}
 }
@@ -217,18 +222,19 @@ void TextEdit::SetText( UString Text )
 {
 	text = Text;
 	SelectionStart = text.length();
+	SetDirty();
 	RaiseEvent( FormEventType::TextChanged );
 }
 
 void TextEdit::RaiseEvent( FormEventType Type )
 {
 	std::ignore = Type;
-	Event* ce = new Event();
-	ce->Type = EVENT_FORM_INTERACTION;
-	memset( (void*)&(ce->Data.Forms), 0, sizeof( FRAMEWORK_FORMS_EVENT ) );
-	ce->Data.Forms.RaisedBy = this;
-	ce->Data.Forms.EventFlag = FormEventType::TextChanged;
-	fw.PushEvent( ce );
+	Event ce;
+	ce.Type = EVENT_FORM_INTERACTION;
+	memset( (void*)&(ce.Data.Forms), 0, sizeof( FRAMEWORK_FORMS_EVENT ) );
+	ce.Data.Forms.RaisedBy = this;
+	ce.Data.Forms.EventFlag = FormEventType::TextChanged;
+	fw.DispatchEvent( &ce );
 }
 
 }; //namespace OpenApoc
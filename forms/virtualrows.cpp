@@ -0,0 +1,89 @@
+#include "forms/virtualrows.h"
+
+namespace OpenApoc {
+
+VirtualRows::VirtualRows() : first(0)
+{
+}
+
+void VirtualRows::Window( int Offset, int Height, int Stride, int Count, int Margin, int &First, int &End )
+{
+	First = Maths::Min( Maths::Max( Offset / Stride - Margin, 0 ), Count );
+	End = Maths::Max( Maths::Min( (Offset + Height) / Stride + 1 + Margin, Count ), First );
+}
+
+bool VirtualRows::Update( int First, int End, bool Invalidate,
+	std::function<Control*( int Index, Control* Recycled )> Fetch,
+	std::function<void( Control* Row )> Detach )
+{
+	if( !Invalidate && First == first && End == first + (int)rows.size() )
+	{
+		return false;
+	}
+
+	std::vector<Control*> oldRows;
+	oldRows.swap( rows );
+	int oldFirst = first;
+
+	for( unsigned i = 0; i < oldRows.size(); i++ )
+	{
+		int index = oldFirst + i;
+		if( oldRows[i] != nullptr && (Invalidate || index < First || index >= End) )
+		{
+			Detach( oldRows[i] );
+			spare.push_back( oldRows[i] );
+			oldRows[i] = nullptr;
+		}
+	}
+	for( int index = First; index < End; index++ )
+	{
+		Control* row = nullptr;
+		if( index >= oldFirst && index < oldFirst + (int)oldRows.size() )
+		{
+			row = oldRows[index - oldFirst];
+		}
+		if( row == nullptr )
+		{
+			Control* recycled = nullptr;
+			if( !spare.empty() )
+			{
+				recycled = spare.back();
+				spare.pop_back();
+			}
+			row = Fetch( index, recycled );
+			if( row != recycled && recycled != nullptr )
+			{
+				spare.push_back( recycled );
+			}
+		}
+		rows.push_back( row );
+	}
+	first = First;
+	return true;
+}
+
+int VirtualRows::GetFirst() const
+{
+	return first;
+}
+
+const std::vector<Control*>& VirtualRows::GetRows() const
+{
+	return rows;
+}
+
+const std::vector<Control*>& VirtualRows::GetSpare() const
+{
+	return spare;
+}
+
+std::vector<Control*> VirtualRows::Reset()
+{
+	std::vector<Control*> freed;
+	freed.swap( spare );
+	rows.clear();
+	first = 0;
+	return freed;
+}
+
+}; //namespace OpenApoc
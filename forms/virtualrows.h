@@ -0,0 +1,49 @@
+#pragma once
+
+#include "framework/includes.h"
+#include <functional>
+
+namespace OpenApoc {
+
+class Control;
+
+//Bookkeeping for a virtual list: which item indices currently have row
+//controls, and the rows that have scrolled out of view waiting to be
+//reused. It never touches the controls themselves - the owner does that
+//in the callbacks passed to Update().
+class VirtualRows
+{
+	private:
+		//Index of rows[0]
+		int first;
+		std::vector<Control*> rows;
+		std::vector<Control*> spare;
+
+	public:
+		VirtualRows();
+
+		//The item indices [First, End) that want rows, for a view Height
+		//pixels tall scrolled Offset pixels down, with rows Stride pixels
+		//apart and Margin extra rows kept either side of the visible ones
+		static void Window( int Offset, int Height, int Stride, int Count, int Margin, int &First, int &End );
+
+		//Moves the rows to cover [First, End). Rows leaving the window (or
+		//all of them, if Invalidate) are passed to Detach and kept as spare.
+		//Rows entering it come from Fetch, given a spare row to reuse (or
+		//nullptr); it may return nullptr if there's no row for the item.
+		//Returns false if nothing changed
+		bool Update( int First, int End, bool Invalidate,
+			std::function<Control*( int Index, Control* Recycled )> Fetch,
+			std::function<void( Control* Row )> Detach );
+
+		int GetFirst() const;
+		//One entry per item from GetFirst(), nullptr where Fetch gave none
+		const std::vector<Control*>& GetRows() const;
+		const std::vector<Control*>& GetSpare() const;
+
+		//Forgets the live rows, which the owner must already have freed or
+		//detached, and returns the spare rows for the owner to free
+		std::vector<Control*> Reset();
+};
+
+}; //namespace OpenApoc
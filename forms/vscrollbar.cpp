@@ -36,18 +36,20 @@ void VScrollBar::EventOccured( Event* e )
 		if( e->Data.Forms.MouseInfo.Y >= (segmentsize * (Value - Minimum)) + grippersize )
 		{
 			Value = Maths::Min(Maximum, Value + LargeChange);
-			Event* ce = new Event();
-			ce->Type = e->Type;
-			memcpy( (void*)&(ce->Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
-			ce->Data.Forms.EventFlag = FormEventType::ScrollBarChange;
-			fw.PushEvent( ce );
+			Event ce;
+			ce.Type = e->Type;
+			memcpy( (void*)&(ce.Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
+			ce.Data.Forms.EventFlag = FormEventType::ScrollBarChange;
+			fw.DispatchEvent( &ce );
+			SetDirty();
 		} else if ( e->Data.Forms.MouseInfo.Y <= segmentsize * (Value - Minimum) ) {
 			Value = Maths::Max(Minimum, Value - LargeChange);
-			Event* ce = new Event();
-			ce->Type = e->Type;
-			memcpy( (void*)&(ce->Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
-			ce->Data.Forms.EventFlag = FormEventType::ScrollBarChange;
-			fw.PushEvent( ce );
+			Event ce;
+			ce.Type = e->Type;
+			memcpy( (void*)&(ce.Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
+			ce.Data.Forms.EventFlag = FormEventType::ScrollBarChange;
+			fw.DispatchEvent( &ce );
+			SetDirty();
 		} else {
 			capture = true;
 		}
@@ -63,11 +65,12 @@ void VScrollBar::EventOccured( Event* e )
 		int segments = (Maximum - Minimum) + 1;
 		float segmentsize = Size.y / (float)segments;
 		Value = Maths::Max(Minimum, Minimum + (int)(e->Data.Forms.MouseInfo.Y / segmentsize));
-		Event* ce = new Event();
-		ce->Type = e->Type;
-		memcpy( (void*)&(ce->Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
-		ce->Data.Forms.EventFlag = FormEventType::ScrollBarChange;
-		fw.PushEvent( ce );
+		Event ce;
+		ce.Type = e->Type;
+		memcpy( (void*)&(ce.Data.Forms), (void*)&(e->Data.Forms), sizeof( FRAMEWORK_FORMS_EVENT ) );
+		ce.Data.Forms.EventFlag = FormEventType::ScrollBarChange;
+		fw.DispatchEvent( &ce );
+		SetDirty();
 	}
 
 	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.RaisedBy == this && e->Data.Forms.EventFlag == FormEventType::MouseClick )
@@ -3,7 +3,6 @@
 #include "game/apocresources/pck.h"
 #include "game/apocresources/apocpalette.h"
 #include "framework/palette.h"
-#include "framework/ignorecase.h"
 #include "library/strings.h"
 
 #include "framework/imageloader_interface.h"
@@ -33,18 +32,12 @@ namespace {
 	std::map<UString, std::unique_ptr<OpenApoc::MusicLoaderFactory>> *registeredMusicLoaders = nullptr;
 	std::map<UString, std::unique_ptr<OpenApoc::SampleLoaderFactory>> *registeredSampleLoaders = nullptr;
 
-static UString GetCorrectCaseFilename(const UString& Filename)
+static UString GetIndexKey(const UString& path)
 {
-	std::string u8Filename = Filename.str();
-	std::unique_ptr<char[]> buf(new char[u8Filename.length() + 1]);
-	strncpy(buf.get(), u8Filename.c_str(), u8Filename.length());
-	buf[Filename.length()] = '\0';
-	if (PHYSFSEXT_locateCorrectCase(buf.get()))
-	{
-		LogInfo("Failed to find file \"%s\"", Filename.str().c_str());
-		return "";
-	}
-	return buf.get();
+	UString key = path.toUpper();
+	if (key.str()[0] == '/')
+		key.remove(0, 1);
+	return key;
 }
 
 class PhysfsIFileImpl : public std::streambuf, public IFileImpl
@@ -309,6 +302,67 @@ Data::Data(Framework &fw, std::vector<UString> paths, int imageCacheSize, int im
 	}
 	//Finally, the write directory trumps all
 	PHYSFS_mount(this->writeDir.str().c_str(), "/", 0);
+
+	this->index_directory("");
+	LogInfo("Indexed %u paths", (unsigned)this->pathIndex.size());
+}
+
+void
+Data::index_path(const UString& path)
+{
+	//If multiple paths differ only in case the first one found wins
+	this->pathIndex.emplace(GetIndexKey(path).str(), path);
+}
+
+void
+Data::index_directory(const UString& path)
+{
+	char **files = PHYSFS_enumerateFiles(path.str().c_str());
+	if (!files)
+	{
+		LogWarning("Failed to enumerate \"%s\" : \"%s\"", path.str().c_str(), PHYSFS_getLastError());
+		return;
+	}
+	for (char **file = files; *file != nullptr; file++)
+	{
+		UString filePath = path.empty() ? UString(*file) : path + "/" + *file;
+		this->index_path(filePath);
+		if (PHYSFS_isDirectory(filePath.str().c_str()))
+			this->index_directory(filePath);
+	}
+	PHYSFS_freeList(files);
+}
+
+UString
+Data::get_correct_case_filename(const UString& path) const
+{
+	auto it = this->pathIndex.find(GetIndexKey(path).str());
+	if (it == this->pathIndex.end())
+	{
+		LogInfo("Failed to find file \"%s\"", path.str().c_str());
+		return "";
+	}
+	return it->second;
+}
+
+void
+Data::file_written(const UString& path)
+{
+	UString key = GetIndexKey(path);
+	auto it = this->pathIndex.find(key.str());
+	if (it != this->pathIndex.end())
+		return;
+	//Make sure any newly-created parent directories are indexed too
+	auto segments = path.split("/");
+	UString dir;
+	for (size_t i = 0; i + 1 < segments.size(); i++)
+	{
+		if (segments[i].empty())
+			continue;
+		dir = dir.empty() ? segments[i] : dir + "/" + segments[i];
+		this->index_path(dir);
+	}
+	this->index_path(path);
 }
 
 Data::~Data()
@@ -433,7 +487,7 @@ Data::load_image(const UString& path)
 	{
 		for (auto &loader : imageLoaders)
 		{
-			img = loader->loadImage(GetCorrectCaseFilename(path));
+			img = loader->loadImage(this->get_correct_case_filename(path));
 			if (img)
 			{
 				break;
@@ -461,7 +515,7 @@ IFile Data::load_file(const UString& path, Data::FileMode mode)
 		LogError("Invalid FileMode set for \"%s\"", path.str().c_str());
 		return f;
 	}
-	UString foundPath = GetCorrectCaseFilename(path);
+	UString foundPath = this->get_correct_case_filename(path);
 	if (foundPath == "")
 	{
 		LogInfo("Failed to find \"%s\"", path.str().c_str());
@@ -480,18 +534,10 @@ Data::load_palette(const UString& path)
 	std::shared_ptr<RGBImage> img = std::dynamic_pointer_cast<RGBImage>(this->load_image(path));
 	if (img)
 	{
-		unsigned int idx = 0;
 		auto p = std::make_shared<Palette>(img->size.x * img->size.y);
 		RGBImageLock src{img, ImageLockUse::Read};
-		for (unsigned int y = 0; y < img->size.y; y++)
-		{
-			for (unsigned int x = 0; x < img->size.x; x++)
-			{
-				Colour c = src.get(Vec2<int>{x,y});
-				p->SetColour(idx, c);
-				idx++;
-			}
-		}
+		const Colour *pixels = static_cast<const Colour*>(src.getData());
+		std::copy(pixels, pixels + p->colours.size(), p->colours.begin());
 		return p;
 	}
 	else
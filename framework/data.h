@@ -7,6 +7,7 @@
 #include <queue>
 #include <vector>
 #include <fstream>
+#include <unordered_map>
 
 namespace OpenApoc {
 
@@ -59,6 +60,12 @@ class Data
 		std::list<std::unique_ptr<SampleLoader>> sampleLoaders;
 		std::list<std::unique_ptr<MusicLoader>> musicLoaders;
 
+		//Every mounted file and directory, keyed by the uppercased path
+		std::unordered_map<std::string, UString> pathIndex;
+		void index_path(const UString& path);
+		void index_directory(const UString& path);
+		UString get_correct_case_filename(const UString& path) const;
+
 	public:
 		Data(Framework &fw, std::vector<UString> paths, int imageCacheSize = 1, int imageSetCacheSize = 1);
 		~Data();
@@ -77,6 +84,10 @@ class Data
 		std::shared_ptr<Palette> load_palette(const UString& path);
 		IFile load_file(const UString& path, FileMode mode = FileMode::Read);
 
+		//Files created in the write dir after startup are not visible to the
+		//load_* functions until passed in here
+		void file_written(const UString& path);
+
 };
 
 }; //namspace OpenApoc
@@ -0,0 +1,22 @@
+#include "framework/eventqueue.h"
+
+namespace OpenApoc {
+
+bool
+EventCoalescer<Event>::merge(Event &into, const Event &next)
+{
+	if (into.Type != EVENT_MOUSE_MOVE || next.Type != EVENT_MOUSE_MOVE)
+		return false;
+	if (into.Data.Mouse.Button != next.Data.Mouse.Button)
+		return false;
+
+	into.Data.Mouse.X = next.Data.Mouse.X;
+	into.Data.Mouse.Y = next.Data.Mouse.Y;
+	into.Data.Mouse.DeltaX += next.Data.Mouse.DeltaX;
+	into.Data.Mouse.DeltaY += next.Data.Mouse.DeltaY;
+	into.Data.Mouse.WheelVertical += next.Data.Mouse.WheelVertical;
+	into.Data.Mouse.WheelHorizontal += next.Data.Mouse.WheelHorizontal;
+	return true;
+}
+
+}; //namespace OpenApoc
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "framework/event.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+
+namespace OpenApoc {
+
+//Decides which queued events pop() may merge. merge() folds next into
+//into and returns true, or returns false to leave both alone. By default
+//nothing is merged
+template <typename T>
+struct EventCoalescer
+{
+	static bool merge(T &into, const T &next)
+	{
+		std::ignore = into;
+		std::ignore = next;
+		return false;
+	}
+};
+
+//A run of MOUSE_MOVE events with the same buttons held becomes one, with
+//the position of the last and the sum of their deltas
+template <>
+struct EventCoalescer<Event>
+{
+	static bool merge(Event &into, const Event &next);
+};
+
+//Fixed-capacity ring of events stored by value. Any number of threads may
+//push(), but only one thread may pop(). Neither side takes a lock.
+//
+//Each slot's sequence number says who may touch it next: a producer
+//claiming position 'pos' waits for sequence == pos, publishes by setting it
+//to pos+1, and the consumer frees it for the next lap by setting it to
+//pos+capacity.
+template <typename T>
+class BasicEventQueue
+{
+	public:
+		struct Stats
+		{
+			//Events accepted by push()
+			uint64_t pushed;
+			//Events returned by pop(), not counting ones merged away
+			uint64_t popped;
+			//Events push() rejected as the queue was full
+			uint64_t dropped;
+			//Events merged into a following one by pop()
+			uint64_t coalesced;
+			//Most events ever waiting when pop() was called
+			size_t maxDepth;
+			//Time between push() and pop(), in microseconds
+			uint64_t totalLatencyUs;
+			uint64_t maxLatencyUs;
+		};
+
+		//capacity is rounded up to a power of two
+		BasicEventQueue(size_t capacity)
+			: writePos(0), readPos(0), dropped(0)
+		{
+			size_t size = 1;
+			while (size < capacity)
+				size *= 2;
+			this->mask = size - 1;
+			this->slots.reset(new Slot[size]);
+			for (size_t i = 0; i < size; i++)
+				this->slots[i].sequence.store(i, std::memory_order_relaxed);
+
+			this->stats.pushed = 0;
+			this->stats.popped = 0;
+			this->stats.dropped = 0;
+			this->stats.coalesced = 0;
+			this->stats.maxDepth = 0;
+			this->stats.totalLatencyUs = 0;
+			this->stats.maxLatencyUs = 0;
+		}
+
+		//Returns false (and drops e) if the queue is full
+		bool push(const T &e)
+		{
+			size_t pos = this->writePos.load(std::memory_order_relaxed);
+			Slot *slot;
+			while (true)
+			{
+				slot = &this->slots[pos & this->mask];
+				size_t seq = slot->sequence.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+				if (diff == 0)
+				{
+					if (this->writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					//The consumer hasn't freed this slot from the previous lap
+					this->dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				else
+				{
+					pos = this->writePos.load(std::memory_order_relaxed);
+				}
+			}
+			slot->event = e;
+			slot->pushTime = Clock::now();
+			slot->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		//Returns false if the queue is empty. If coalesce is set, waiting
+		//events EventCoalescer<T> can merge are folded into e
+		bool pop(T &e, bool coalesce)
+		{
+			size_t depth = this->writePos.load(std::memory_order_relaxed) - this->readPos;
+			if (depth > this->stats.maxDepth)
+				this->stats.maxDepth = depth;
+
+			if (!take(e))
+				return false;
+			this->stats.popped++;
+
+			if (!coalesce)
+				return true;
+
+			while (true)
+			{
+				const Slot &next = this->slots[this->readPos & this->mask];
+				if (next.sequence.load(std::memory_order_acquire) != this->readPos + 1)
+					break;
+				T merged = e;
+				if (!EventCoalescer<T>::merge(merged, next.event))
+					break;
+				take(e);
+				e = merged;
+				this->stats.coalesced++;
+			}
+			return true;
+		}
+
+		//Only safe to call on the thread that calls pop()
+		Stats getStats() const
+		{
+			Stats s = this->stats;
+			s.dropped = this->dropped.load(std::memory_order_relaxed);
+			s.pushed = this->writePos.load(std::memory_order_relaxed);
+			return s;
+		}
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			T event;
+			Clock::time_point pushTime;
+		};
+
+		BasicEventQueue(const BasicEventQueue &) = delete;
+		BasicEventQueue& operator=(const BasicEventQueue &) = delete;
+
+		//Takes the event in the slot at readPos if it has been published
+		bool take(T &e)
+		{
+			Slot &slot = this->slots[this->readPos & this->mask];
+			if (slot.sequence.load(std::memory_order_acquire) != this->readPos + 1)
+				return false;
+
+			e = slot.event;
+			uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - slot.pushTime).count();
+			this->stats.totalLatencyUs += latency;
+			if (latency > this->stats.maxLatencyUs)
+				this->stats.maxLatencyUs = latency;
+
+			slot.sequence.store(this->readPos + this->mask + 1, std::memory_order_release);
+			this->readPos++;
+			return true;
+		}
+
+		std::unique_ptr<Slot[]> slots;
+		size_t mask;
+		std::atomic<size_t> writePos;
+		size_t readPos;
+
+		std::atomic<uint64_t> dropped;
+		Stats stats;
+};
+
+typedef BasicEventQueue<Event> EventQueue;
+
+}; //namespace OpenApoc
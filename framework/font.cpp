@@ -1,42 +1,162 @@
 #include "framework/framework.h"
 #include "framework/image.h"
+#include "framework/textlayout.h"
 
 namespace OpenApoc {
 
+BitmapFont::BitmapFont()
+	: glyphRunCache(256), paragraphCache(256), textLayoutCache(64)
+{
+
+}
+
 BitmapFont::~BitmapFont()
 {
 
 }
 
-std::shared_ptr<PaletteImage>
-BitmapFont::getString(const UString& Text)
+std::shared_ptr<GlyphRun>
+BitmapFont::layoutString(const UString& Text)
 {
-	int height = this->GetFontHeight();
-	int width = this->GetFontWidth(Text);
-	auto img = std::make_shared<PaletteImage>(Vec2<int>{width, height});
-	int pos = 0;
+	auto cached = this->glyphRunCache.get(Text);
+	if (cached)
+		return cached;
 
-	for (size_t i = 0; i < Text.length(); i++)
+	auto run = std::make_shared<GlyphRun>();
+	int pos = 0;
+	for (UniChar c : Text)
 	{
-		UniChar c = Text[i];
 		auto glyph = this->getGlyph(c);
-		PaletteImage::blit(glyph, Vec2<int>{pos, 0}, img);
+		run->glyphs.emplace_back(pos, glyph);
 		pos += glyph->size.x;
 	}
+	run->width = pos;
+
+	this->glyphRunCache.put(Text, run);
+	return run;
+}
 
+std::shared_ptr<BitmapFont::ParagraphLines>
+BitmapFont::layoutParagraph(const UString& Paragraph, int Width)
+{
+	auto key = std::make_pair(Paragraph, Width);
+	auto cached = this->paragraphCache.get(key);
+	if (cached)
+		return cached;
 
-	return img;
+	auto lines = std::make_shared<ParagraphLines>();
+	auto wrapped = wrapParagraph(Paragraph, Width,
+		[this](UniChar c) { return this->getGlyph(c)->size.x; });
+	for (auto &line : wrapped)
+	{
+		lines->push_back(this->layoutString(line));
+	}
+	this->paragraphCache.put(key, lines);
+	return lines;
 }
 
-int BitmapFont::GetFontWidth( const UString& Text )
+std::shared_ptr<TextLayout>
+BitmapFont::layoutText(const UString& Text, int Width, HorizontalAlignment Align)
+{
+	auto key = std::make_tuple(Text, Width, Align);
+	auto cached = this->textLayoutCache.get(key);
+	if (cached)
+		return cached;
+
+	std::vector<std::shared_ptr<GlyphRun>> runs;
+	for (auto &paragraph : Text.split("\n"))
+	{
+		//A paragraph that fits is its own single line whatever the width,
+		//so only paragraphs that actually wrap go through paragraphCache
+		auto run = this->layoutString(paragraph);
+		if (Width <= 0 || run->width <= Width)
+		{
+			runs.push_back(run);
+			continue;
+		}
+		auto lines = this->layoutParagraph(paragraph, Width);
+		runs.insert(runs.end(), lines->begin(), lines->end());
+	}
+
+	int blockWidth = Width;
+	if (blockWidth <= 0)
+	{
+		blockWidth = 0;
+		for (auto &run : runs)
+			blockWidth = std::max(blockWidth, run->width);
+	}
+
+	auto layout = std::make_shared<TextLayout>();
+	int lineHeight = this->GetFontHeight();
+	int y = 0;
+	for (auto &run : runs)
+	{
+		int x;
+		switch (Align)
+		{
+			case HorizontalAlignment::Centre:
+				x = (blockWidth - run->width) / 2;
+				break;
+			case HorizontalAlignment::Right:
+				x = blockWidth - run->width;
+				break;
+			default:
+				x = 0;
+				break;
+		}
+		layout->lines.emplace_back(Vec2<int>{x, y}, run);
+		y += lineHeight;
+	}
+	layout->size = Vec2<int>{blockWidth, y};
+
+	this->textLayoutCache.put(key, layout);
+	return layout;
+}
+
+void
+BitmapFont::drawText(Renderer &r, const TextLayout &layout, Vec2<float> position)
 {
-	int textlen = 0;
-	for( size_t i = 0; i < Text.length(); i++ )
+	for (auto &line : layout.lines)
 	{
-		auto glyph = this->getGlyph(Text[i]);
-		textlen += glyph->size.x;
+		for (auto &glyph : line.second->glyphs)
+		{
+			r.draw(glyph.second, Vec2<float>{position.x + line.first.x + glyph.first, position.y + line.first.y});
+		}
 	}
-	return textlen;
+}
+
+void
+BitmapFont::drawString(Renderer &r, const UString& Text, Vec2<float> position)
+{
+	auto run = this->layoutString(Text);
+	for (auto &glyph : run->glyphs)
+	{
+		r.draw(glyph.second, Vec2<float>{position.x + glyph.first, position.y});
+	}
+}
+
+std::shared_ptr<PaletteImage>
+BitmapFont::getString(const UString& Text)
+{
+	auto run = this->layoutString(Text);
+	if (run->image)
+		return run->image;
+
+	int height = this->GetFontHeight();
+	auto img = std::make_shared<PaletteImage>(Vec2<int>{run->width, height});
+
+	for (auto &glyph : run->glyphs)
+	{
+		PaletteImage::blit(glyph.second, Vec2<int>{glyph.first, 0}, img);
+	}
+
+	run->image = img;
+	return img;
+}
+
+int BitmapFont::GetFontWidth( const UString& Text )
+{
+	return this->layoutString(Text)->width;
 }
 
 }; //namespace OpenApoc
@@ -3,6 +3,9 @@
 
 #include "framework/includes.h"
 #include "library/strings.h"
+#include "library/lrucache.h"
+#include "forms/forms_enums.h"
+#include <tuple>
 
 #define APOCFONT_ALIGN_LEFT	0
 #define APOCFONT_ALIGN_CENTRE	1
@@ -11,16 +14,64 @@
 namespace OpenApoc {
 
 class PaletteImage;
+class Renderer;
+
+//A string laid out as a line of glyphs
+class GlyphRun
+{
+	public:
+		//x offset of each glyph from the start of the line
+		std::vector<std::pair<int, std::shared_ptr<PaletteImage>>> glyphs;
+		int width;
+		//The whole line composed into one image, only created by getString()
+		std::shared_ptr<PaletteImage> image;
+};
+
+//A block of text word-wrapped to a width, with one GlyphRun per line
+class TextLayout
+{
+	public:
+		//Offset of each line from the top left of the block, from the
+		//alignment and line height
+		std::vector<std::pair<Vec2<int>, std::shared_ptr<GlyphRun>>> lines;
+		Vec2<int> size;
+};
 
 class BitmapFont
 {
+	private:
+		typedef std::vector<std::shared_ptr<GlyphRun>> ParagraphLines;
+		typedef std::tuple<UString, int, HorizontalAlignment> TextLayoutKey;
+
+		LRUCache<UString, std::shared_ptr<GlyphRun>> glyphRunCache;
+		//Only paragraphs that needed wrapping, keyed by paragraph and width
+		LRUCache<std::pair<UString, int>, std::shared_ptr<ParagraphLines>> paragraphCache;
+		LRUCache<TextLayoutKey, std::shared_ptr<TextLayout>> textLayoutCache;
+
+		std::shared_ptr<ParagraphLines> layoutParagraph(const UString& Paragraph, int Width);
+
 	public:
+		BitmapFont();
 		virtual ~BitmapFont();
 		virtual std::shared_ptr<PaletteImage> getGlyph(UniChar codepoint) = 0;
 		virtual std::shared_ptr<PaletteImage> getString(const UString& Text);
 		virtual int GetFontHeight() = 0;
 		virtual int GetFontWidth(const UString& Text);
 		virtual UString getName() = 0;
+
+		//Layouts are cached, so calling these every frame for the same text
+		//doesn't allocate
+		std::shared_ptr<GlyphRun> layoutString(const UString& Text);
+		//Draws each glyph separately, so if the glyphs share an ImageSet
+		//they're batched by the renderer
+		void drawString(Renderer &r, const UString& Text, Vec2<float> position);
+
+		//Word-wraps Text to Width (no wrapping if Width <= 0), breaking lines
+		//at '\n' and aligning each line within Width. Each paragraph is
+		//wrapped and cached separately, so changing one paragraph of a long
+		//text only re-wraps that paragraph
+		std::shared_ptr<TextLayout> layoutText(const UString& Text, int Width, HorizontalAlignment Align);
+		void drawText(Renderer &r, const TextLayout &layout, Vec2<float> position);
 };
 
 }; //namespace OpenApoc
@@ -43,12 +43,19 @@ static std::map<UString, UString> defaultConfig =
 #endif
 	{"Language", "en_gb"},
 	{"GameRules", "XCOMAPOC.XML"},
+	//Write the loaded language's strings to strings_<language>.bin, for use
+	//in a <stringtable> element
+	{"Language.SaveStringTable", "false"},
 	{"Resource.LocalDataDir", "./data"},
 	{"Resource.SystemDataDir", DATA_DIRECTORY},
 	{"Resource.LocalCDPath", "./data/cd.iso"},
 	{"Resource.SystemCDPath", DATA_DIRECTORY "/cd.iso"},
 	{"Visual.Renderers", RENDERERS},
 	{"Audio.Backends", "allegro:null"},
+	{"Input.CoalesceMouseMotion", "true"},
+	{"Input.Thread", "false"},
+	//Log per-frame renderer stats every few seconds
+	{"Visual.LogRenderStats", "false"},
 };
 
 std::map<UString, std::unique_ptr<OpenApoc::RendererFactory>> *registeredRenderers = nullptr;
@@ -140,8 +147,31 @@ class FrameworkPrivate
 		ALLEGRO_DISPLAY *screen;
 
 		ALLEGRO_EVENT_QUEUE *eventAllegro;
-		std::list<Event*> eventQueue;
-		ALLEGRO_MUTEX *eventMutex;
+		EventQueue eventQueue;
+		bool coalesceMouseMotion;
+		uint64_t reportedDroppedEvents;
+		ALLEGRO_THREAD *inputThread;
+		//Raw events from the input thread, waiting to be translated here.
+		//Translating can call back into Allegro (display size, joystick
+		//reconfiguration), which must stay on the display thread
+		BasicEventQueue<ALLEGRO_EVENT> allegroEvents;
+		uint64_t reportedDroppedAllegroEvents;
+		//Set while the stage is handling an event, when DispatchEvent()
+		//queues in deferredEvents instead
+		bool dispatching;
+		std::vector<Event> deferredEvents;
+
+		uint64_t frameCount;
+		bool logRenderStats;
+		//Totals at the last periodic stats log
+		Renderer::Stats loggedRenderStats;
+		uint64_t loggedFrameCount;
+
+		FrameworkPrivate()
+			: quitProgram(false), eventQueue(4096), coalesceMouseMotion(true), reportedDroppedEvents(0), inputThread(nullptr),
+			allegroEvents(4096), reportedDroppedAllegroEvents(0), dispatching(false),
+			frameCount(0), logRenderStats(false), loggedRenderStats(), loggedFrameCount(0)
+		{}
 
 		StageStack ProgramStages;
 		std::shared_ptr<Surface> defaultSurface;
@@ -252,7 +282,8 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 	}
 
 	p->eventAllegro = al_create_event_queue();
-	p->eventMutex = al_create_mutex_recursive();
+	p->coalesceMouseMotion = Settings->getBool("Input.CoalesceMouseMotion");
+	p->logRenderStats = Settings->getBool("Visual.LogRenderStats");
 
 	srand( (unsigned int)al_get_time() );
 
@@ -263,6 +294,17 @@ Framework::Framework(const UString programName, const std::vector<UString> cmdli
 	al_register_event_source( p->eventAllegro, al_get_keyboard_event_source() );
 	al_register_event_source( p->eventAllegro, al_get_mouse_event_source() );
 
+	if( Settings->getBool("Input.Thread") && !this->replayEvents )
+	{
+		LogInfo("Starting input thread");
+		p->inputThread = al_create_thread( InputThreadMain, this );
+		if( p->inputThread == nullptr )
+		{
+			LogError("Failed to create input thread - translating events on the main thread");
+		} else {
+			al_start_thread( p->inputThread );
+		}
+	}
 }
 
 Framework::~Framework()
@@ -276,11 +318,29 @@ Framework::~Framework()
 	LogInfo("Saving config");
 	SaveSettings();
 
+	if( p->inputThread != nullptr )
+	{
+		LogInfo("Stopping input thread");
+		al_destroy_thread( p->inputThread );
+		p->inputThread = nullptr;
+	}
+
+	auto stats = p->eventQueue.getStats();
+	LogInfo("Event queue: %llu events, %llu coalesced, %llu dropped, max depth %u, latency mean %lluus max %lluus",
+		(unsigned long long)stats.pushed, (unsigned long long)stats.coalesced,
+		(unsigned long long)stats.dropped, (unsigned)stats.maxDepth,
+		(unsigned long long)(stats.popped + stats.coalesced ? stats.totalLatencyUs / (stats.popped + stats.coalesced) : 0),
+		(unsigned long long)stats.maxLatencyUs);
+
+	if( this->renderer && p->frameCount > 0 )
+	{
+		LogRenderStats( this->renderer->getStats(), Renderer::Stats(), p->frameCount );
+	}
+
 	LogInfo("Shutdown");
 	Display_Shutdown();
 	Audio_Shutdown();
 	al_destroy_event_queue( p->eventAllegro );
-	al_destroy_mutex( p->eventMutex );
 
 	LogInfo("Allegro shutdown");
 	al_uninstall_mouse();
@@ -290,6 +350,20 @@ Framework::~Framework()
 	PHYSFS_deinit();
 }
 
+void Framework::LogRenderStats( const Renderer::Stats& Current, const Renderer::Stats& Previous, uint64_t Frames )
+{
+	double frames = Frames;
+	uint64_t batches = Current.batches - Previous.batches;
+	LogInfo("Renderer over %llu frames: %.1f draw calls/frame, %.1f batches/frame, %.1f sprites/batch, %.3fms submit/frame, %.1f API calls/frame (%.1f redundant state changes skipped)",
+		(unsigned long long)Frames,
+		(Current.drawCalls - Previous.drawCalls) / frames,
+		batches / frames,
+		batches ? (double)(Current.batchedSprites - Previous.batchedSprites) / batches : 0.0,
+		(Current.submitTimeUs - Previous.submitTimeUs) / frames / 1000.0,
+		(Current.glCalls - Previous.glCalls) / frames,
+		(Current.stateChangesSkipped - Previous.stateChangesSkipped) / frames);
+}
+
 void Framework::Run()
 {
 	LogInfo("Program loop started");
@@ -335,6 +409,14 @@ void Framework::Run()
 		{
 			p->ProgramStages.Current()->Render();
 			al_flip_display();
+			p->frameCount++;
+			if( p->logRenderStats && p->frameCount - p->loggedFrameCount >= 300 )
+			{
+				auto stats = this->renderer->getStats();
+				LogRenderStats( stats, p->loggedRenderStats, p->frameCount - p->loggedFrameCount );
+				p->loggedRenderStats = stats;
+				p->loggedFrameCount = p->frameCount;
+			}
 		}
 		if (this->dumpEvents)
 		{
@@ -352,16 +434,16 @@ void Framework::ReadRecordedEvents()
 	std::string line;
 	while (std::getline(this->eventStream, line))
 	{
-		Event *e = new Event(UString(line));
+		Event e{UString(line)};
 		PushEvent(e);
-		if (e->Type == EVENT_END_OF_FRAME)
+		if (e.Type == EVENT_END_OF_FRAME)
 			break;
 	}
 	if (!this->eventStream)
 	{
 		LogInfo("Reached end of reply, appending CLOSE");
-		Event *e = new Event();
-		e->Type = EVENT_WINDOW_CLOSED;
+		Event e;
+		e.Type = EVENT_WINDOW_CLOSED;
 		PushEvent( e );
 	}
 }
@@ -374,49 +456,90 @@ void Framework::ProcessEvents()
 		return;
 	}
 
-	// Convert Allegro events before we process
-	// TODO: Consider threading the translation
+	// Convert Allegro events before we process, either straight from
+	// Allegro or the ones the input thread has collected
 	if (this->replayEvents)
 		ReadRecordedEvents();
 	else
 		TranslateAllegroEvents();
 
-	al_lock_mutex( p->eventMutex );
-
-	while( p->eventQueue.size() > 0 && !p->ProgramStages.IsEmpty() )
+	Event e;
+	while( !p->ProgramStages.IsEmpty() && p->eventQueue.pop( e, p->coalesceMouseMotion ) )
 	{
-		Event* e;
-		e = p->eventQueue.front();
-		p->eventQueue.pop_front();
-		if (!e) {
-			LogError("Invalid event on queue");
-			continue;
-		}
 		if (this->dumpEvents)
-			DumpEvent(e);
-		switch( e->Type )
+			DumpEvent(&e);
+		switch( e.Type )
 		{
 			case EVENT_WINDOW_CLOSED:
-				delete e;
-				al_unlock_mutex( p->eventMutex );
 				ShutdownFramework();
 				return;
 				break;
 			default:
-				p->ProgramStages.Current()->EventOccurred( e );
+				DeliverEvent( &e );
 				break;
 		}
-		delete e;
 	}
 
-	al_unlock_mutex( p->eventMutex );
+	auto dropped = p->eventQueue.getStats().dropped;
+	if( dropped != p->reportedDroppedEvents )
+	{
+		LogWarning("Event queue full - dropped %llu events", (unsigned long long)(dropped - p->reportedDroppedEvents));
+		p->reportedDroppedEvents = dropped;
+	}
+}
+
+void Framework::PushEvent( const Event& e )
+{
+	p->eventQueue.push( e );
+}
+
+EventQueue::Stats Framework::GetEventQueueStats()
+{
+	return p->eventQueue.getStats();
+}
+
+void Framework::DispatchEvent( Event* e )
+{
+	if( p->ProgramStages.IsEmpty() )
+	{
+		return;
+	}
+	if( p->dispatching )
+	{
+		p->deferredEvents.push_back( *e );
+		return;
+	}
+	DeliverEvent( e );
+}
+
+void Framework::DeliverEvent( Event* e )
+{
+	p->dispatching = true;
+	p->ProgramStages.Current()->EventOccurred( e );
+	//Handlers may raise more events, growing the list as it's walked
+	for( size_t i = 0; i < p->deferredEvents.size() && !p->ProgramStages.IsEmpty(); i++ )
+	{
+		Event deferred = p->deferredEvents[i];
+		if( deferred.Type == EVENT_UNDEFINED )
+		{
+			continue;
+		}
+		p->ProgramStages.Current()->EventOccurred( &deferred );
+	}
+	//Keeps its capacity, so later dispatches don't allocate
+	p->deferredEvents.clear();
+	p->dispatching = false;
 }
 
-void Framework::PushEvent( Event* e )
+void Framework::CancelEvents( Control* RaisedBy )
 {
-	al_lock_mutex( p->eventMutex );
-	p->eventQueue.push_back( e );
-	al_unlock_mutex( p->eventMutex );
+	for( auto &e : p->deferredEvents )
+	{
+		if( e.Type == EVENT_FORM_INTERACTION && e.Data.Forms.RaisedBy == RaisedBy )
+		{
+			e.Type = EVENT_UNDEFINED;
+		}
+	}
 }
 
 void Framework::DumpEvent(Event* e)
@@ -430,123 +553,149 @@ void Framework::DumpEvent(Event* e)
 void Framework::TranslateAllegroEvents()
 {
 	ALLEGRO_EVENT e;
-	Event* fwE;
 
-	while( al_get_next_event( p->eventAllegro, &e ) )
+	if( p->inputThread == nullptr )
 	{
-		switch( e.type )
+		while( al_get_next_event( p->eventAllegro, &e ) )
 		{
-			case ALLEGRO_EVENT_DISPLAY_CLOSE:
-				fwE = new Event();
-				fwE->Type = EVENT_WINDOW_CLOSED;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_JOYSTICK_CONFIGURATION:
-				al_reconfigure_joysticks();
-				break;
-			case ALLEGRO_EVENT_TIMER:
-				fwE = new Event();
-				fwE->Type = EVENT_TIMER_TICK;
-				fwE->Data.Timer.TimerObject = (void*)e.timer.source;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_KEY_DOWN:
-				fwE = new Event();
-				fwE->Type = EVENT_KEY_DOWN;
-				fwE->Data.Keyboard.KeyCode = e.keyboard.keycode;
-				fwE->Data.Keyboard.UniChar = e.keyboard.unichar;
-				fwE->Data.Keyboard.Modifiers = e.keyboard.modifiers;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_KEY_UP:
-				fwE = new Event();
-				fwE->Type = EVENT_KEY_UP;
-				fwE->Data.Keyboard.KeyCode = e.keyboard.keycode;
-				fwE->Data.Keyboard.UniChar = e.keyboard.unichar;
-				fwE->Data.Keyboard.Modifiers = e.keyboard.modifiers;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_KEY_CHAR:
-				fwE = new Event();
-				fwE->Type = EVENT_KEY_PRESS;
-				fwE->Data.Keyboard.KeyCode = e.keyboard.keycode;
-				fwE->Data.Keyboard.UniChar = e.keyboard.unichar;
-				fwE->Data.Keyboard.Modifiers = e.keyboard.modifiers;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_MOUSE_AXES:
-				fwE = new Event();
-				fwE->Type = EVENT_MOUSE_MOVE;
-				fwE->Data.Mouse.X = e.mouse.x;
-				fwE->Data.Mouse.Y = e.mouse.y;
-				fwE->Data.Mouse.DeltaX = e.mouse.dx;
-				fwE->Data.Mouse.DeltaY = e.mouse.dy;
-				fwE->Data.Mouse.WheelVertical = e.mouse.dz;
-				fwE->Data.Mouse.WheelHorizontal = e.mouse.dw;
-				fwE->Data.Mouse.Button = e.mouse.button;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
-				fwE = new Event();
-				fwE->Type = EVENT_MOUSE_DOWN;
-				fwE->Data.Mouse.X = e.mouse.x;
-				fwE->Data.Mouse.Y = e.mouse.y;
-				fwE->Data.Mouse.DeltaX = e.mouse.dx;
-				fwE->Data.Mouse.DeltaY = e.mouse.dy;
-				fwE->Data.Mouse.WheelVertical = e.mouse.dz;
-				fwE->Data.Mouse.WheelHorizontal = e.mouse.dw;
-				fwE->Data.Mouse.Button = e.mouse.button;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
-				fwE = new Event();
-				fwE->Type = EVENT_MOUSE_UP;
-				fwE->Data.Mouse.X = e.mouse.x;
-				fwE->Data.Mouse.Y = e.mouse.y;
-				fwE->Data.Mouse.DeltaX = e.mouse.dx;
-				fwE->Data.Mouse.DeltaY = e.mouse.dy;
-				fwE->Data.Mouse.WheelVertical = e.mouse.dz;
-				fwE->Data.Mouse.WheelHorizontal = e.mouse.dw;
-				fwE->Data.Mouse.Button = e.mouse.button;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_DISPLAY_RESIZE:
-				fwE = new Event();
-				fwE->Type = EVENT_WINDOW_RESIZE;
-				fwE->Data.Display.X = 0;
-				fwE->Data.Display.Y = 0;
-				fwE->Data.Display.Width = al_get_display_width( p->screen );
-				fwE->Data.Display.Height = al_get_display_height( p->screen );
-				fwE->Data.Display.Active = true;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_DISPLAY_SWITCH_IN:
-				fwE = new Event();
-				fwE->Type = EVENT_WINDOW_ACTIVATE;
-				fwE->Data.Display.X = 0;
-				fwE->Data.Display.Y = 0;
-				fwE->Data.Display.Width = al_get_display_width( p->screen );
-				fwE->Data.Display.Height = al_get_display_height( p->screen );
-				fwE->Data.Display.Active = true;
-				PushEvent( fwE );
-				break;
-			case ALLEGRO_EVENT_DISPLAY_SWITCH_OUT:
-				fwE = new Event();
-				fwE->Type = EVENT_WINDOW_DEACTIVATE;
-				fwE->Data.Display.X = 0;
-				fwE->Data.Display.Y = 0;
-				fwE->Data.Display.Width = al_get_display_width( p->screen );
-				fwE->Data.Display.Height = al_get_display_height( p->screen );
-				fwE->Data.Display.Active = false;
-				PushEvent( fwE );
-				break;
-			default:
-				fwE = new Event();
-				fwE->Type = EVENT_UNDEFINED;
-				PushEvent( fwE );
-				break;
+			TranslateAllegroEvent( e );
+		}
+		return;
+	}
+
+	while( p->allegroEvents.pop( e, false ) )
+	{
+		TranslateAllegroEvent( e );
+	}
+
+	auto dropped = p->allegroEvents.getStats().dropped;
+	if( dropped != p->reportedDroppedAllegroEvents )
+	{
+		LogWarning("Input thread queue full - dropped %llu events", (unsigned long long)(dropped - p->reportedDroppedAllegroEvents));
+		p->reportedDroppedAllegroEvents = dropped;
+	}
+}
+
+void Framework::TranslateAllegroEvent( const ALLEGRO_EVENT& e )
+{
+	Event fwE;
+
+	switch( e.type )
+	{
+		case ALLEGRO_EVENT_DISPLAY_CLOSE:
+			fwE.Type = EVENT_WINDOW_CLOSED;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_JOYSTICK_CONFIGURATION:
+			al_reconfigure_joysticks();
+			break;
+		case ALLEGRO_EVENT_TIMER:
+			fwE.Type = EVENT_TIMER_TICK;
+			fwE.Data.Timer.TimerObject = (void*)e.timer.source;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_KEY_DOWN:
+			fwE.Type = EVENT_KEY_DOWN;
+			fwE.Data.Keyboard.KeyCode = e.keyboard.keycode;
+			fwE.Data.Keyboard.UniChar = e.keyboard.unichar;
+			fwE.Data.Keyboard.Modifiers = e.keyboard.modifiers;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_KEY_UP:
+			fwE.Type = EVENT_KEY_UP;
+			fwE.Data.Keyboard.KeyCode = e.keyboard.keycode;
+			fwE.Data.Keyboard.UniChar = e.keyboard.unichar;
+			fwE.Data.Keyboard.Modifiers = e.keyboard.modifiers;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_KEY_CHAR:
+			fwE.Type = EVENT_KEY_PRESS;
+			fwE.Data.Keyboard.KeyCode = e.keyboard.keycode;
+			fwE.Data.Keyboard.UniChar = e.keyboard.unichar;
+			fwE.Data.Keyboard.Modifiers = e.keyboard.modifiers;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_MOUSE_AXES:
+			fwE.Type = EVENT_MOUSE_MOVE;
+			fwE.Data.Mouse.X = e.mouse.x;
+			fwE.Data.Mouse.Y = e.mouse.y;
+			fwE.Data.Mouse.DeltaX = e.mouse.dx;
+			fwE.Data.Mouse.DeltaY = e.mouse.dy;
+			fwE.Data.Mouse.WheelVertical = e.mouse.dz;
+			fwE.Data.Mouse.WheelHorizontal = e.mouse.dw;
+			fwE.Data.Mouse.Button = e.mouse.button;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
+			fwE.Type = EVENT_MOUSE_DOWN;
+			fwE.Data.Mouse.X = e.mouse.x;
+			fwE.Data.Mouse.Y = e.mouse.y;
+			fwE.Data.Mouse.DeltaX = e.mouse.dx;
+			fwE.Data.Mouse.DeltaY = e.mouse.dy;
+			fwE.Data.Mouse.WheelVertical = e.mouse.dz;
+			fwE.Data.Mouse.WheelHorizontal = e.mouse.dw;
+			fwE.Data.Mouse.Button = e.mouse.button;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
+			fwE.Type = EVENT_MOUSE_UP;
+			fwE.Data.Mouse.X = e.mouse.x;
+			fwE.Data.Mouse.Y = e.mouse.y;
+			fwE.Data.Mouse.DeltaX = e.mouse.dx;
+			fwE.Data.Mouse.DeltaY = e.mouse.dy;
+			fwE.Data.Mouse.WheelVertical = e.mouse.dz;
+			fwE.Data.Mouse.WheelHorizontal = e.mouse.dw;
+			fwE.Data.Mouse.Button = e.mouse.button;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_DISPLAY_RESIZE:
+			fwE.Type = EVENT_WINDOW_RESIZE;
+			fwE.Data.Display.X = 0;
+			fwE.Data.Display.Y = 0;
+			fwE.Data.Display.Width = al_get_display_width( p->screen );
+			fwE.Data.Display.Height = al_get_display_height( p->screen );
+			fwE.Data.Display.Active = true;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_DISPLAY_SWITCH_IN:
+			fwE.Type = EVENT_WINDOW_ACTIVATE;
+			fwE.Data.Display.X = 0;
+			fwE.Data.Display.Y = 0;
+			fwE.Data.Display.Width = al_get_display_width( p->screen );
+			fwE.Data.Display.Height = al_get_display_height( p->screen );
+			fwE.Data.Display.Active = true;
+			PushEvent( fwE );
+			break;
+		case ALLEGRO_EVENT_DISPLAY_SWITCH_OUT:
+			fwE.Type = EVENT_WINDOW_DEACTIVATE;
+			fwE.Data.Display.X = 0;
+			fwE.Data.Display.Y = 0;
+			fwE.Data.Display.Width = al_get_display_width( p->screen );
+			fwE.Data.Display.Height = al_get_display_height( p->screen );
+			fwE.Data.Display.Active = false;
+			PushEvent( fwE );
+			break;
+		default:
+			fwE.Type = EVENT_UNDEFINED;
+			PushEvent( fwE );
+			break;
+	}
+}
+
+void* Framework::InputThreadMain( ALLEGRO_THREAD* thread, void* arg )
+{
+	Framework* fw = static_cast<Framework*>( arg );
+	ALLEGRO_EVENT e;
+
+	while( !al_get_thread_should_stop( thread ) )
+	{
+		//Time out now and then to check if we've been asked to stop
+		if( al_wait_for_event_timed( fw->p->eventAllegro, &e, 0.05f ) )
+		{
+			fw->p->allegroEvents.push( e );
 		}
 	}
+	return nullptr;
 }
 
 void Framework::ShutdownFramework()
@@ -586,6 +735,8 @@ void Framework::Display_Initialise()
 	}
 
 	al_set_new_display_flags(display_flags);
+	//Used for depth-sorted sprite drawing, if available
+	al_set_new_display_option(ALLEGRO_DEPTH_SIZE, 24, ALLEGRO_SUGGEST);
 
 	p->screen = al_create_display( scrW, scrH );
 
@@ -615,6 +766,8 @@ void Framework::Display_Initialise()
 		}
 		this->renderer.reset(r);
 		LogInfo("Using renderer: %s", this->renderer->getName().str().c_str());
+		if (p->logRenderStats)
+			this->renderer->countAPICalls();
 		break;
 	}
 	if (!this->renderer)
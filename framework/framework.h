@@ -9,6 +9,7 @@
 #include "logger.h"
 #include "includes.h"
 #include "event.h"
+#include "eventqueue.h"
 #include "data.h"
 #include "stagestack.h"
 #include "renderer.h"
@@ -44,6 +45,17 @@ class Framework
 		UString programName;
 		void Audio_Initialise();
 		void Audio_Shutdown();
+		void TranslateAllegroEvent( const ALLEGRO_EVENT& e );
+		//Body of the optional input thread (Input.Thread setting), which
+		//drains the Allegro queue as events arrive instead of once a frame.
+		//It only passes the raw events on - TranslateAllegroEvents() still
+		//converts them on the main thread
+		static void* InputThreadMain( ALLEGRO_THREAD* thread, void* arg );
+		//Logs the per-frame averages of the stats between two snapshots
+		void LogRenderStats( const Renderer::Stats& Current, const Renderer::Stats& Previous, uint64_t Frames );
+		//Hands e to the current stage, then any events DispatchEvent()
+		//deferred while it was being handled
+		void DeliverEvent( Event* e );
 	public:
 		std::unique_ptr<Data> data;
 		GameState state;
@@ -59,8 +71,21 @@ class Framework
 
 		void Run();
 		void ProcessEvents();
-		void PushEvent( Event* e );
+		//Safe to call from any thread. Events are dropped if the queue is full
+		void PushEvent( const Event& e );
+		//Delivers e to the current stage immediately instead of queueing it.
+		//The caller keeps ownership of e.
+		//Re-entrancy: if the stage is already handling an event (so the
+		//forms may be part way through walking their controls), e is
+		//copied and delivered once that handler returns, still before
+		//the next queued event. Handlers are therefore free to add, remove
+		//or delete controls, including the one that raised the event
+		void DispatchEvent( Event* e );
+		//Drops any deferred events raised by the control - called as it's
+		//destroyed, so handlers never see a dangling RaisedBy
+		void CancelEvents( Control* RaisedBy );
 		void DumpEvent( Event* e );
+		EventQueue::Stats GetEventQueueStats();
 		void TranslateAllegroEvents();
 		void ReadRecordedEvents();
 		void ShutdownFramework();
@@ -7,8 +7,111 @@
 #include <physfs.h>
 #include "logger.h"
 
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLIT_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace OpenApoc {
 
+namespace {
+
+//Copies every non-transparent pixel in a row - index 0 is transparent
+void blitRowTransparent(const uint8_t *src, uint8_t *dst, int count)
+{
+	int i = 0;
+#ifdef BLIT_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+		__m128i transparent = _mm_cmpeq_epi8(s, zero);
+		d = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, s));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), d);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		if (src[i] != 0)
+			dst[i] = src[i];
+	}
+}
+
+//Copies every non-transparent pixel in a row - zero alpha is transparent
+void blitRowTransparent(const Colour *src, Colour *dst, int count)
+{
+	int i = 0;
+#ifdef BLIT_SSE2
+	static_assert(offsetof(Colour, a) == 3, "SSE2 blit expects alpha in the top byte");
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+		__m128i transparent = _mm_cmpeq_epi32(_mm_srli_epi32(s, 24), zero);
+		d = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, s));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), d);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		if (src[i].a != 0)
+			dst[i] = src[i];
+	}
+}
+
+template <typename T>
+void blitPixels(const T *src, Vec2<unsigned int> srcSize, Rect<int> srcRect,
+	T *dst, Vec2<unsigned int> dstSize, Vec2<int> dstOffset, BlitMode mode)
+{
+	//Clip the source rect to the source image
+	if (srcRect.p0.x < 0)
+	{
+		dstOffset.x -= srcRect.p0.x;
+		srcRect.p0.x = 0;
+	}
+	if (srcRect.p0.y < 0)
+	{
+		dstOffset.y -= srcRect.p0.y;
+		srcRect.p0.y = 0;
+	}
+	srcRect.p1.x = std::min(srcRect.p1.x, (int)srcSize.x);
+	srcRect.p1.y = std::min(srcRect.p1.y, (int)srcSize.y);
+
+	//Then clip to the destination image, moving the source rect to match
+	if (dstOffset.x < 0)
+	{
+		srcRect.p0.x -= dstOffset.x;
+		dstOffset.x = 0;
+	}
+	if (dstOffset.y < 0)
+	{
+		srcRect.p0.y -= dstOffset.y;
+		dstOffset.y = 0;
+	}
+	int width = std::min(srcRect.p1.x - srcRect.p0.x, (int)dstSize.x - dstOffset.x);
+	int height = std::min(srcRect.p1.y - srcRect.p0.y, (int)dstSize.y - dstOffset.y);
+	if (width <= 0 || height <= 0)
+		return;
+
+	const T *srcRow = src + srcRect.p0.y * srcSize.x + srcRect.p0.x;
+	T *dstRow = dst + dstOffset.y * dstSize.x + dstOffset.x;
+	for (int y = 0; y < height; y++)
+	{
+		if (mode == BlitMode::Opaque)
+			memcpy(dstRow, srcRow, width * sizeof(T));
+		else
+			blitRowTransparent(srcRow, dstRow, width);
+		srcRow += srcSize.x;
+		dstRow += dstSize.x;
+	}
+}
+
+}; //anonymous namespace
+
 Image::~Image()
 {
 }
@@ -40,36 +143,71 @@ PaletteImage::toRGBImage(std::shared_ptr<Palette> p)
 	std::shared_ptr<RGBImage> i = std::make_shared<RGBImage>(size);
 
 	RGBImageLock imgLock{i, ImageLockUse::Write};
+	p->expand(this->indices.get(), static_cast<Colour*>(imgLock.getData()), size.x * size.y);
+	return i;
+}
+
+std::shared_ptr<ImageSet>
+PaletteImage::toRGBImageSet(std::shared_ptr<ImageSet> set, std::shared_ptr<Palette> p)
+{
+	auto rgbSet = std::make_shared<ImageSet>();
+	rgbSet->maxSize = set->maxSize;
+	rgbSet->images.reserve(set->images.size());
 
-	for (unsigned int y = 0; y < this->size.y; y++)
+	for (auto &img : set->images)
 	{
-		for (unsigned int x = 0; x < this->size.x; x++)
+		std::shared_ptr<PaletteImage> palImg = std::dynamic_pointer_cast<PaletteImage>(img);
+		if (!palImg)
 		{
-			uint8_t idx = this->indices[y*this->size.x + x];
-			imgLock.set(Vec2<unsigned int>{x,y}, p->GetColour(idx));
+			rgbSet->images.push_back(img);
+			continue;
 		}
+		//Not marked as owned by rgbSet - the renderer treats owned images as
+		//part of a palette spritesheet
+		rgbSet->images.push_back(palImg->toRGBImage(p));
 	}
-	return i;
+	return rgbSet;
 }
 
 void
 PaletteImage::blit(std::shared_ptr<PaletteImage> src, Vec2<unsigned int> offset, std::shared_ptr<PaletteImage> dst)
+{
+	blit(src, Rect<int>{0, 0, (int)src->size.x, (int)src->size.y}, dst, Vec2<int>{(int)offset.x, (int)offset.y});
+}
+
+void
+PaletteImage::blit(std::shared_ptr<PaletteImage> src, Rect<int> srcRect, std::shared_ptr<PaletteImage> dst, Vec2<int> dstOffset, BlitMode mode)
 {
 	PaletteImageLock reader(src, ImageLockUse::Read);
 	PaletteImageLock writer(dst, ImageLockUse::Write);
 
-	for (unsigned int y = 0; y < src->size.y; y++)
+	blitPixels(static_cast<const uint8_t*>(reader.getData()), src->size, srcRect,
+		static_cast<uint8_t*>(writer.getData()), dst->size, dstOffset, mode);
+}
+
+Rect<int>
+PaletteImage::getOpaqueBounds() const
+{
+	Rect<int> bounds{(int)size.x, (int)size.y, 0, 0};
+	for (unsigned int y = 0; y < size.y; y++)
 	{
-		for (unsigned int x = 0; x < src->size.x; x++)
-		{
-			Vec2<unsigned int> readPos{x,y};
-			Vec2<unsigned int> writePos{readPos + offset};
-			if (writePos.x >= dst->size.x ||
-			    writePos.y >= dst->size.y)
-				break;
-			writer.set(writePos, reader.get(readPos));
-		}
+		const uint8_t *row = &this->indices[y * size.x];
+		unsigned int x0 = 0;
+		while (x0 < size.x && row[x0] == 0)
+			x0++;
+		if (x0 == size.x)
+			continue;
+		unsigned int x1 = size.x;
+		while (row[x1 - 1] == 0)
+			x1--;
+		bounds.p0.x = std::min(bounds.p0.x, (int)x0);
+		bounds.p1.x = std::max(bounds.p1.x, (int)x1);
+		bounds.p0.y = std::min(bounds.p0.y, (int)y);
+		bounds.p1.y = y + 1;
 	}
+	if (bounds.p1.x == 0)
+		return Rect<int>{0, 0, 0, 0};
+	return bounds;
 }
 
 RGBImage::RGBImage(Vec2<unsigned int> size, Colour initialColour)
@@ -128,6 +266,23 @@ void RGBImage::saveBitmap(const UString &filename)
 RGBImage::~RGBImage()
 {}
 
+void
+RGBImage::blit(std::shared_ptr<RGBImage> src, Vec2<unsigned int> srcOffset, std::shared_ptr<RGBImage> dst, Vec2<unsigned int> dstOffset)
+{
+	blit(src, Rect<int>{(int)srcOffset.x, (int)srcOffset.y, (int)src->size.x, (int)src->size.y},
+		dst, Vec2<int>{(int)dstOffset.x, (int)dstOffset.y});
+}
+
+void
+RGBImage::blit(std::shared_ptr<RGBImage> src, Rect<int> srcRect, std::shared_ptr<RGBImage> dst, Vec2<int> dstOffset, BlitMode mode)
+{
+	RGBImageLock reader(src, ImageLockUse::Read);
+	RGBImageLock writer(dst, ImageLockUse::Write);
+
+	blitPixels(static_cast<const Colour*>(reader.getData()), src->size, srcRect,
+		static_cast<Colour*>(writer.getData()), dst->size, dstOffset, mode);
+}
+
 RGBImageLock::RGBImageLock(std::shared_ptr<RGBImage> img, ImageLockUse use)
 	: img(img), use(use)
 {
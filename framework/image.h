@@ -16,6 +16,14 @@ enum class ImageLockUse
 	ReadWrite,
 };
 
+enum class BlitMode
+{
+	//Copy every pixel
+	Opaque,
+	//Skip palette index 0 / RGB pixels with zero alpha
+	Transparent,
+};
+
 class Image
 {
 	protected:
@@ -48,7 +56,15 @@ class PaletteImage : public Image
 		PaletteImage(Vec2<unsigned int> size, uint8_t initialIndex = 0);
 		~PaletteImage();
 		std::shared_ptr<RGBImage> toRGBImage(std::shared_ptr<Palette> p);
+		//Converts every PaletteImage in 'set' - any other images are shared
+		//with the returned set as-is
+		static std::shared_ptr<ImageSet> toRGBImageSet(std::shared_ptr<ImageSet> set, std::shared_ptr<Palette> p);
 		static void blit(std::shared_ptr<PaletteImage> src, Vec2<unsigned int> offset, std::shared_ptr<PaletteImage> dst);
+		//Copies 'srcRect' of src to 'dstOffset' in dst, clipped to both images
+		static void blit(std::shared_ptr<PaletteImage> src, Rect<int> srcRect, std::shared_ptr<PaletteImage> dst, Vec2<int> dstOffset, BlitMode mode = BlitMode::Opaque);
+		//The smallest rect holding every non-transparent (non-zero) pixel,
+		//or an empty rect at {0,0} if there are none
+		Rect<int> getOpaqueBounds() const;
 };
 
 class PaletteImageLock
@@ -78,6 +94,8 @@ class RGBImage : public Image
 		~RGBImage();
 		void saveBitmap(const UString &filename);
 		static void blit(std::shared_ptr<RGBImage> src, Vec2<unsigned int> srcOffset, std::shared_ptr<RGBImage> dst, Vec2<unsigned int> dstOffset);
+		//Copies 'srcRect' of src to 'dstOffset' in dst, clipped to both images
+		static void blit(std::shared_ptr<RGBImage> src, Rect<int> srcRect, std::shared_ptr<RGBImage> dst, Vec2<int> dstOffset, BlitMode mode = BlitMode::Opaque);
 };
 
 class RGBImageLock
@@ -1,4 +1,5 @@
 #include "framework/palette.h"
+#include "framework/palette_expand.h"
 #include <cassert>
 
 namespace OpenApoc {
@@ -26,4 +27,19 @@ Palette::SetColour(unsigned int idx, Colour &c)
 	colours[idx] = c;
 }
 
+void
+Palette::expand(const uint8_t *indices, Colour *out, size_t count) const
+{
+	if (colours.size() >= 256)
+	{
+		PaletteExpand(colours.data(), indices, out, count);
+		return;
+	}
+	//The kernels always take a full 256-entry table
+	Colour table[256];
+	for (unsigned int i = 0; i < 256; i++)
+		table[i] = (i < colours.size()) ? colours[i] : Colour{0,0,0,0};
+	PaletteExpand(table, indices, out, count);
+}
+
 }; //namespace OpenApoc
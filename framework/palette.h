@@ -18,6 +18,10 @@ class Palette
 
 		Colour &GetColour(unsigned int Index);
 		void SetColour(unsigned int Index, Colour &Col);
+
+		//Converts 'count' indices to colours in one go. Indices past the end
+		//of the palette become transparent.
+		void expand(const uint8_t *indices, Colour *out, size_t count) const;
 };
 
 }; //namespace OpenApoc
@@ -0,0 +1,93 @@
+#include "framework/palette_expand.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PALETTE_EXPAND_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(PALETTE_EXPAND_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace OpenApoc {
+
+void PaletteExpandScalar(const Colour *table, const uint8_t *indices, Colour *out, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		out[i+0] = table[indices[i+0]];
+		out[i+1] = table[indices[i+1]];
+		out[i+2] = table[indices[i+2]];
+		out[i+3] = table[indices[i+3]];
+	}
+	for (; i < count; i++)
+		out[i] = table[indices[i]];
+}
+
+#ifdef PALETTE_EXPAND_X86
+
+TARGET_AVX2 void PaletteExpandSIMD(const Colour *table, const uint8_t *indices, Colour *out, size_t count)
+{
+	const int *tableData = reinterpret_cast<const int*>(table);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i idx8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i));
+		__m256i idx32 = _mm256_cvtepu8_epi32(idx8);
+		__m256i colours = _mm256_i32gather_epi32(tableData, idx32, 4);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), colours);
+	}
+	PaletteExpandScalar(table, indices + i, out + i, count - i);
+}
+
+bool PaletteExpandSIMDSupported()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	//AVX2 needs the OS to save the YMM registers too
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+#else
+
+void PaletteExpandSIMD(const Colour *table, const uint8_t *indices, Colour *out, size_t count)
+{
+	PaletteExpandScalar(table, indices, out, count);
+}
+
+bool PaletteExpandSIMDSupported()
+{
+	return false;
+}
+
+#endif
+
+void PaletteExpand(const Colour *table, const uint8_t *indices, Colour *out, size_t count)
+{
+	static const bool useSIMD = PaletteExpandSIMDSupported();
+	if (useSIMD)
+		PaletteExpandSIMD(table, indices, out, count);
+	else
+		PaletteExpandScalar(table, indices, out, count);
+}
+
+}; //namespace OpenApoc
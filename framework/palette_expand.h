@@ -0,0 +1,19 @@
+#pragma once
+
+#include "framework/includes.h"
+
+namespace OpenApoc {
+
+//Palette lookup kernels - each converts 'count' 8-bit indices to colours
+//through a 256-entry table. 'table' must always have 256 entries.
+
+//Plain C++, always available
+void PaletteExpandScalar(const Colour *table, const uint8_t *indices, Colour *out, size_t count);
+//Vectorised with AVX2 gathers, only call if PaletteExpandSIMDSupported()
+void PaletteExpandSIMD(const Colour *table, const uint8_t *indices, Colour *out, size_t count);
+bool PaletteExpandSIMDSupported();
+
+//Uses the fastest kernel the CPU supports, chosen on first call
+void PaletteExpand(const Colour *table, const uint8_t *indices, Colour *out, size_t count);
+
+}; //namespace OpenApoc
@@ -102,7 +102,36 @@ namespace gl
 {
 	namespace exts
 	{
+		LoadTest var_ARB_draw_instanced;
+		LoadTest var_ARB_instanced_arrays;
+		
 	} //namespace exts
+	typedef void (CODEGEN_FUNCPTR *PFNDRAWARRAYSINSTANCEDARB)(GLenum, GLint, GLsizei, GLsizei);
+	PFNDRAWARRAYSINSTANCEDARB DrawArraysInstancedARB = 0;
+	typedef void (CODEGEN_FUNCPTR *PFNDRAWELEMENTSINSTANCEDARB)(GLenum, GLsizei, GLenum, const void *, GLsizei);
+	PFNDRAWELEMENTSINSTANCEDARB DrawElementsInstancedARB = 0;
+	
+	static int Load_ARB_draw_instanced()
+	{
+		int numFailed = 0;
+		DrawArraysInstancedARB = reinterpret_cast<PFNDRAWARRAYSINSTANCEDARB>(IntGetProcAddress("glDrawArraysInstancedARB"));
+		if(!DrawArraysInstancedARB) ++numFailed;
+		DrawElementsInstancedARB = reinterpret_cast<PFNDRAWELEMENTSINSTANCEDARB>(IntGetProcAddress("glDrawElementsInstancedARB"));
+		if(!DrawElementsInstancedARB) ++numFailed;
+		return numFailed;
+	}
+	
+	typedef void (CODEGEN_FUNCPTR *PFNVERTEXATTRIBDIVISORARB)(GLuint, GLuint);
+	PFNVERTEXATTRIBDIVISORARB VertexAttribDivisorARB = 0;
+	
+	static int Load_ARB_instanced_arrays()
+	{
+		int numFailed = 0;
+		VertexAttribDivisorARB = reinterpret_cast<PFNVERTEXATTRIBDIVISORARB>(IntGetProcAddress("glVertexAttribDivisorARB"));
+		if(!VertexAttribDivisorARB) ++numFailed;
+		return numFailed;
+	}
+	
 	typedef void (CODEGEN_FUNCPTR *PFNACCUM)(GLenum, GLfloat);
 	PFNACCUM Accum = 0;
 	typedef void (CODEGEN_FUNCPTR *PFNALPHAFUNC)(GLenum, GLfloat);
@@ -2691,11 +2720,15 @@ namespace gl
 			
 			void InitializeMappingTable(std::vector<MapEntry> &table)
 			{
-				table.reserve(0);
+				table.reserve(2);
+				table.push_back(MapEntry("GL_ARB_draw_instanced", &exts::var_ARB_draw_instanced, Load_ARB_draw_instanced));
+				table.push_back(MapEntry("GL_ARB_instanced_arrays", &exts::var_ARB_instanced_arrays, Load_ARB_instanced_arrays));
 			}
 			
 			void ClearExtensionVars()
 			{
+				exts::var_ARB_draw_instanced = exts::LoadTest();
+				exts::var_ARB_instanced_arrays = exts::LoadTest();
 			}
 			
 			void LoadExtByName(std::vector<MapEntry> &table, const char *extensionName)
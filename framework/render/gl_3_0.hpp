@@ -174,9 +174,14 @@ namespace gl
 			int m_numMissing;
 		};
 		
+		extern LoadTest var_ARB_draw_instanced;
+		extern LoadTest var_ARB_instanced_arrays;
+		
 	} //namespace exts
 	enum
 	{
+		VERTEX_ATTRIB_ARRAY_DIVISOR_ARB  = 0x88FE,
+		
 		_2D                              = 0x0600,
 		_2_BYTES                         = 0x1407,
 		_3D                              = 0x0601,
@@ -1268,6 +1273,16 @@ namespace gl
 		VERTEX_ATTRIB_ARRAY_INTEGER      = 0x88FD,
 		
 	};
+	
+	namespace _detail
+	{
+	} //namespace _detail
+	
+	extern void (CODEGEN_FUNCPTR *DrawArraysInstancedARB)(GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+	extern void (CODEGEN_FUNCPTR *DrawElementsInstancedARB)(GLenum mode, GLsizei count, GLenum type, const void * indices, GLsizei primcount);
+	
+	extern void (CODEGEN_FUNCPTR *VertexAttribDivisorARB)(GLuint index, GLuint divisor);
+	
 	extern void (CODEGEN_FUNCPTR *Accum)(GLenum op, GLfloat value);
 	extern void (CODEGEN_FUNCPTR *AlphaFunc)(GLenum func, GLfloat ref);
 	extern void (CODEGEN_FUNCPTR *Begin)(GLenum mode);
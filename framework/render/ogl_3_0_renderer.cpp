@@ -2,8 +2,14 @@
 #include "framework/logger.h"
 #include "framework/image.h"
 #include "framework/palette.h"
+#include "framework/spritelist.h"
+#include "framework/tilevolume.h"
 #include <memory>
 #include <array>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 #include "framework/render/gl_3_0.cpp"
 
@@ -134,58 +140,6 @@ class SpriteProgram : public Program
 		GLuint texLoc;
 		GLuint flipYLoc;
 };
-const char* RGBProgram_vertexSource = {
-	"#version 130\n"
-	"in vec2 position;\n"
-	"uniform vec2 size;\n"
-	"uniform vec2 offset;\n"
-	"out vec2 texcoord;\n"
-	"uniform vec2 screenSize;\n"
-	"uniform bool flipY;\n"
-	"void main() {\n"
-	"  texcoord = position;\n"
-	"  vec2 tmpPos = position;\n"
-	"  tmpPos *= size;\n"
-	"  tmpPos += offset;\n"
-	"  tmpPos /= screenSize;\n"
-	"  tmpPos -= vec2(0.5,0.5);\n"
-	"  if (flipY) gl_Position = vec4((tmpPos.x*2), -(tmpPos.y*2),0,1);\n"
-	"  else gl_Position = vec4((tmpPos.x*2), (tmpPos.y*2),0,1);\n"
-	"}\n"
-};
-const char* RGBProgram_fragmentSource = {
-	"#version 130\n"
-	"in vec2 texcoord;\n"
-	"uniform sampler2D tex;\n"
-	"out vec4 out_colour;\n"
-	"void main() {\n"
-	" out_colour = texture2D(tex, texcoord);\n"
-	"}\n"
-};
-class RGBProgram : public SpriteProgram
-{
-	private:
-		
-	public:
-		RGBProgram()
-			: SpriteProgram(RGBProgram_vertexSource, RGBProgram_fragmentSource)
-			{
-				this->posLoc = gl::GetAttribLocation(this->prog, "position");
-				this->sizeLoc = gl::GetUniformLocation(this->prog, "size");
-				this->offsetLoc = gl::GetUniformLocation(this->prog, "offset");
-				this->screenSizeLoc = gl::GetUniformLocation(this->prog, "screenSize");
-				this->texLoc = gl::GetUniformLocation(this->prog, "tex");
-				this->flipYLoc = gl::GetUniformLocation(this->prog, "flipY");
-			}
-		void setUniforms(Vec2<float> offset, Vec2<float> size, Vec2<int> screenSize, bool flipY, GLint texUnit = 0)
-		{
-			this->Uniform(this->offsetLoc, offset);
-			this->Uniform(this->sizeLoc, size);
-			this->Uniform(this->screenSizeLoc, screenSize);
-			this->Uniform(this->texLoc, texUnit);
-			this->Uniform(this->flipYLoc, flipY);
-		}
-};
 const char* PaletteProgram_vertexSource = {
 	"#version 130\n"
 	"in vec2 position;\n"
@@ -242,151 +196,247 @@ class PaletteProgram : public SpriteProgram
 		}
 };
 
-const char* PaletteSetProgram_vertexSource = {
+//Each sprite is a quad at 'position' with edges 'axisX' and 'axisY', expanded
+//by 'corner'. source_in holds the atlas layer in the low 16 bits and where
+//the colour comes from (a BatchSource) above that: the vertex colour alone,
+//a paletted atlas sprite or an RGBA texture, both multiplied by the vertex
+//colour. Texture coordinates are in texels for both. Filtered texture
+//samples are kept half a texel inside the texture's part of the texture,
+//so a surface never bleeds in its neighbours on a shared page. 'depth' is only
+//used when depth testing is enabled, with 0 the nearest. 'offset' moves
+//every sprite, so a static buffer of sprites can be scrolled
+const char* SpriteBatchProgram_vertexSource = {
 	"#version 130\n"
+	"in vec2 corner;\n"
 	"in vec2 position;\n"
-	"in vec2 texcoord_in;\n"
-	"in int sprite_in;\n"
+	"in vec2 axisX;\n"
+	"in vec2 axisY;\n"
+	"in vec2 texOffset;\n"
+	"in vec2 texSize;\n"
+	"in vec4 colour_in;\n"
+	"in int source_in;\n"
+	"in float depth;\n"
 	"out vec2 texcoord;\n"
-	"flat out int sprite;\n"
+	"out vec4 colour;\n"
+	"flat out int layer;\n"
+	"flat out int source;\n"
+	"flat out vec4 texBounds;\n"
 	"uniform vec2 screenSize;\n"
+	"uniform vec2 offset;\n"
 	"uniform bool flipY;\n"
 	"void main() {\n"
-	"  texcoord = texcoord_in;\n"
-	"  sprite = sprite_in;\n"
-	"  vec2 tmpPos = position;\n"
+	"  texcoord = texOffset + corner * texSize;\n"
+	"  texBounds = vec4(texOffset + 0.5, max(texOffset + 0.5, texOffset + texSize - 0.5));\n"
+	"  colour = colour_in;\n"
+	"  layer = source_in & 0xffff;\n"
+	"  source = source_in >> 16;\n"
+	"  vec2 tmpPos = position + offset + corner.x * axisX + corner.y * axisY;\n"
 	"  tmpPos /= screenSize;\n"
 	"  tmpPos -= vec2(0.5,0.5);\n"
-	"  if (flipY) gl_Position = vec4((tmpPos.x*2), -(tmpPos.y*2),0,1);\n"
-	"  else gl_Position = vec4((tmpPos.x*2), (tmpPos.y*2),0,1);\n"
+	"  if (flipY) gl_Position = vec4((tmpPos.x*2), -(tmpPos.y*2),depth*2-1,1);\n"
+	"  else gl_Position = vec4((tmpPos.x*2), (tmpPos.y*2),depth*2-1,1);\n"
 	"}\n"
 };
-const char* PaletteSetProgram_fragmentSource = {
+//Fully transparent pixels are always dropped, so they never write depth.
+//Opaque depth-tested sprites raise minAlpha to 1 to drop their blended
+//edges too
+const char* SpriteBatchProgram_fragmentSource = {
 	"#version 130\n"
 	"in vec2 texcoord;\n"
-	"flat in int sprite;\n"
-	"uniform isampler2DArray tex;\n"
+	"in vec4 colour;\n"
+	"flat in int layer;\n"
+	"flat in int source;\n"
+	"flat in vec4 texBounds;\n"
+	"uniform isampler2DArray atlas;\n"
 	"uniform sampler2D pal;\n"
+	"uniform sampler2D tex;\n"
+	"uniform float minAlpha;\n"
 	"out vec4 out_colour;\n"
 	"void main() {\n"
-	" int idx = texelFetch(tex, ivec3(texcoord.x, texcoord.y, sprite), 0).r;\n"
-	" out_colour = texelFetch(pal, ivec2(idx,0), 0);\n"
+	" if (source == 1) {\n"
+	"  int idx = texelFetch(atlas, ivec3(texcoord.x, texcoord.y, layer), 0).r;\n"
+	"  out_colour = texelFetch(pal, ivec2(idx,0), 0) * colour;\n"
+	" }\n"
+	" else if (source == 2)\n"
+	"  out_colour = textureLod(tex, clamp(texcoord, texBounds.xy, texBounds.zw) / vec2(textureSize(tex, 0)), 0) * colour;\n"
+	" else\n"
+	"  out_colour = colour;\n"
+	" if (out_colour.a == 0 || out_colour.a < minAlpha)\n"
+	"  discard;\n"
 	"}\n"
 };
-class PaletteSetProgram : public Program
+class SpriteBatchProgram : public Program
 {
 	private:
 		
 		
 	public:
+		GLuint cornerLoc;
 		GLuint posLoc;
-		GLuint texcoordLoc;
-		GLuint spriteLoc;
+		GLuint axisXLoc;
+		GLuint axisYLoc;
+		GLuint texOffsetLoc;
+		GLuint texSizeLoc;
+		GLuint colourLoc;
+		GLuint sourceLoc;
+		GLuint depthLoc;
 		GLuint screenSizeLoc;
-		GLuint texLoc;
+		GLuint atlasLoc;
 		GLuint palLoc;
+		GLuint texLoc;
 		GLuint flipYLoc;
-		PaletteSetProgram()
-			: Program(PaletteSetProgram_vertexSource, PaletteSetProgram_fragmentSource)
+		GLuint minAlphaLoc;
+		GLuint offsetLoc;
+		SpriteBatchProgram()
+			: Program(SpriteBatchProgram_vertexSource, SpriteBatchProgram_fragmentSource)
 			{
+				this->cornerLoc = gl::GetAttribLocation(this->prog, "corner");
 				this->posLoc = gl::GetAttribLocation(this->prog, "position");
-				this->texcoordLoc = gl::GetAttribLocation(this->prog, "texcoord_in");
-				this->spriteLoc = gl::GetAttribLocation(this->prog, "sprite_in");
+				this->axisXLoc = gl::GetAttribLocation(this->prog, "axisX");
+				this->axisYLoc = gl::GetAttribLocation(this->prog, "axisY");
+				this->texOffsetLoc = gl::GetAttribLocation(this->prog, "texOffset");
+				this->texSizeLoc = gl::GetAttribLocation(this->prog, "texSize");
+				this->colourLoc = gl::GetAttribLocation(this->prog, "colour_in");
+				this->sourceLoc = gl::GetAttribLocation(this->prog, "source_in");
+				this->depthLoc = gl::GetAttribLocation(this->prog, "depth");
 
 				this->screenSizeLoc = gl::GetUniformLocation(this->prog, "screenSize");
-				this->texLoc = gl::GetUniformLocation(this->prog, "tex");
+				this->atlasLoc = gl::GetUniformLocation(this->prog, "atlas");
 				this->palLoc = gl::GetUniformLocation(this->prog, "pal");
+				this->texLoc = gl::GetUniformLocation(this->prog, "tex");
 				this->flipYLoc = gl::GetUniformLocation(this->prog, "flipY");
+				this->minAlphaLoc = gl::GetUniformLocation(this->prog, "minAlpha");
+				this->offsetLoc = gl::GetUniformLocation(this->prog, "offset");
 			}
-		void setUniforms(Vec2<int> screenSize, bool flipY, GLint texUnit = 0, GLint palUnit = 1)
+		void setUniforms(Vec2<int> screenSize, bool flipY, float minAlpha, Vec2<float> offset, GLint atlasUnit = 0, GLint palUnit = 1, GLint texUnit = 2)
 		{
+			this->Uniform(this->minAlphaLoc, minAlpha);
+			this->Uniform(this->offsetLoc, offset);
 			this->Uniform(this->screenSizeLoc, screenSize);
-			this->Uniform(this->texLoc, texUnit);
+			this->Uniform(this->atlasLoc, atlasUnit);
 			this->Uniform(this->palLoc, palUnit);
+			this->Uniform(this->texLoc, texUnit);
 			this->Uniform(this->flipYLoc, flipY);
 		}
-		class VertexDef
-		{
-		public:
-			VertexDef(Vec2<float> pos, Vec2<float> texcoords, int sprite)
-				: pos(pos), texcoords(texcoords), sprite(sprite){}
-			VertexDef(){}
-
-			Vec2<float> pos;
-			Vec2<float> texcoords;
-			int sprite;
-		};
-		static_assert(sizeof(VertexDef) == 20, "VertexDef should be tightly packed");
-		class SpriteDef
-		{
-		public:
-			SpriteDef(Vec2<float> offset, Vec2<float> size, int sprite)
-			{
-				v[0] = { offset, Vec2<float>{0, 0}, sprite };
-				v[1] = { offset + size * Vec2<float>{0, 1}, Vec2<float>{0, 1}, sprite };
-				v[2] = { offset + size * Vec2<float>{1, 0}, Vec2<float>{1, 0}, sprite };
-				v[3] = { offset + size * Vec2<float>{1, 0}, Vec2<float>{1, 0}, sprite };
-			}
-
-			VertexDef v[4];
-		};
-		static_assert(sizeof(SpriteDef) == sizeof(VertexDef)*4, "SpriteDef should be tightly packed");
 };
 
-const char* SolidColourProgram_vertexSource = {
+//Draws a TileVolume with one instance per tile, placed the way TileView
+//places tiles. Each tile's ID comes from the 3D 'ids' texture and indexes
+//'table', which holds two texels per ID (wrapped every 256 IDs): where the
+//sprite is in the atlas and its size, then where it's drawn relative to
+//the tile and its atlas layer and page. Tiles that are empty, or on
+//another page than the one being drawn, are moved outside the clip volume
+const char* TileVolumeProgram_vertexSource = {
 	"#version 130\n"
-	"in vec2 position;\n"
-	"uniform vec2 size;\n"
+	"#extension GL_ARB_draw_instanced : require\n"
+	"in vec2 corner;\n"
+	"out vec2 texcoord;\n"
+	"flat out int layer;\n"
+	"uniform usampler3D ids;\n"
+	"uniform isampler2D table;\n"
+	"uniform ivec3 mapSize;\n"
+	"uniform vec3 tileSize;\n"
+	"uniform int slots;\n"
+	"uniform int page;\n"
 	"uniform vec2 offset;\n"
 	"uniform vec2 screenSize;\n"
 	"uniform bool flipY;\n"
 	"void main() {\n"
-	"  vec2 tmpPos = position;\n"
-	"  tmpPos *= size;\n"
-	"  tmpPos += offset;\n"
+	"  int i = gl_InstanceIDARB;\n"
+	"  ivec3 tile = ivec3(i % mapSize.x, (i / mapSize.x) % mapSize.y, i / (mapSize.x * mapSize.y));\n"
+	"  int id = int(texelFetch(ids, tile, 0).r);\n"
+	"  ivec2 entry = ivec2(id % 256, (id / 256) * 2);\n"
+	"  ivec4 sprite = texelFetch(table, entry, 0);\n"
+	"  ivec4 place = texelFetch(table, entry + ivec2(0, 1), 0);\n"
+	"  texcoord = vec2(sprite.xy) + corner * vec2(sprite.zw);\n"
+	"  layer = place.z;\n"
+	"  if (id == 0 || sprite.z == 0 || place.w != page) {\n"
+	"    gl_Position = vec4(2, 2, 2, 1);\n"
+	"    return;\n"
+	"  }\n"
+	"  vec2 tmpPos = vec2((tile.x - tile.y) * tileSize.x / 2, (tile.x + tile.y) * tileSize.y / 2 - tile.z * tileSize.z);\n"
+	"  tmpPos += offset + vec2(place.xy) + corner * vec2(sprite.zw);\n"
+	"  float index = float(((tile.z * mapSize.y + tile.y) * mapSize.x + tile.x) * slots + 1);\n"
+	"  float depth = 1 - (index + 1) / float(mapSize.x * mapSize.y * mapSize.z * slots + 1);\n"
 	"  tmpPos /= screenSize;\n"
 	"  tmpPos -= vec2(0.5,0.5);\n"
-	"  if (flipY) gl_Position = vec4((tmpPos.x*2), -(tmpPos.y*2),0,1);\n"
-	"  else gl_Position = vec4((tmpPos.x*2), (tmpPos.y*2),0,1);\n"
+	"  if (flipY) gl_Position = vec4((tmpPos.x*2), -(tmpPos.y*2),depth*2-1,1);\n"
+	"  else gl_Position = vec4((tmpPos.x*2), (tmpPos.y*2),depth*2-1,1);\n"
 	"}\n"
 };
-const char* SolidColourProgram_fragmentSource = {
+//Pixels outside [minAlpha, maxAlpha) are dropped, so the opaque and
+//translucent passes can each draw their part of every sprite
+const char* TileVolumeProgram_fragmentSource = {
 	"#version 130\n"
-	"uniform vec4 colour;\n"
+	"in vec2 texcoord;\n"
+	"flat in int layer;\n"
+	"uniform isampler2DArray atlas;\n"
+	"uniform sampler2D pal;\n"
+	"uniform float minAlpha;\n"
+	"uniform float maxAlpha;\n"
 	"out vec4 out_colour;\n"
 	"void main() {\n"
-	" out_colour = colour;\n"
+	" int idx = texelFetch(atlas, ivec3(texcoord.x, texcoord.y, layer), 0).r;\n"
+	" out_colour = texelFetch(pal, ivec2(idx,0), 0);\n"
+	" if (out_colour.a == 0 || out_colour.a < minAlpha || out_colour.a >= maxAlpha)\n"
+	"  discard;\n"
 	"}\n"
 };
-class SolidColourProgram : public Program
+class TileVolumeProgram : public Program
 {
-	private:
-		
-		
 	public:
-		GLuint posLoc;
-		GLuint sizeLoc;
+		GLuint cornerLoc;
+		GLuint idsLoc;
+		GLuint tableLoc;
+		GLuint atlasLoc;
+		GLuint palLoc;
+		GLuint mapSizeLoc;
+		GLuint tileSizeLoc;
+		GLuint slotsLoc;
+		GLuint pageLoc;
 		GLuint offsetLoc;
 		GLuint screenSizeLoc;
-		GLuint colourLoc;
 		GLuint flipYLoc;
-		SolidColourProgram()
-			: Program(SolidColourProgram_vertexSource, SolidColourProgram_fragmentSource)
+		GLuint minAlphaLoc;
+		GLuint maxAlphaLoc;
+		TileVolumeProgram()
+			: Program(TileVolumeProgram_vertexSource, TileVolumeProgram_fragmentSource)
 			{
-				this->posLoc = gl::GetAttribLocation(this->prog, "position");
-				this->sizeLoc = gl::GetUniformLocation(this->prog, "size");
+				this->cornerLoc = gl::GetAttribLocation(this->prog, "corner");
+
+				this->idsLoc = gl::GetUniformLocation(this->prog, "ids");
+				this->tableLoc = gl::GetUniformLocation(this->prog, "table");
+				this->atlasLoc = gl::GetUniformLocation(this->prog, "atlas");
+				this->palLoc = gl::GetUniformLocation(this->prog, "pal");
+				this->mapSizeLoc = gl::GetUniformLocation(this->prog, "mapSize");
+				this->tileSizeLoc = gl::GetUniformLocation(this->prog, "tileSize");
+				this->slotsLoc = gl::GetUniformLocation(this->prog, "slots");
+				this->pageLoc = gl::GetUniformLocation(this->prog, "page");
 				this->offsetLoc = gl::GetUniformLocation(this->prog, "offset");
 				this->screenSizeLoc = gl::GetUniformLocation(this->prog, "screenSize");
-				this->colourLoc = gl::GetUniformLocation(this->prog, "colour");
 				this->flipYLoc = gl::GetUniformLocation(this->prog, "flipY");
+				this->minAlphaLoc = gl::GetUniformLocation(this->prog, "minAlpha");
+				this->maxAlphaLoc = gl::GetUniformLocation(this->prog, "maxAlpha");
 			}
-		void setUniforms(Vec2<float> offset, Vec2<float> size, Vec2<int> screenSize, bool flipY, Colour colour)
+		void setUniforms(Vec3<int> mapSize, Vec3<int> tileSize, Vec2<float> offset, Vec2<int> screenSize, bool flipY,
+			float minAlpha, float maxAlpha, GLint atlasUnit = 0, GLint palUnit = 1, GLint idsUnit = 3, GLint tableUnit = 4)
 		{
+			gl::Uniform3i(this->mapSizeLoc, mapSize.x, mapSize.y, mapSize.z);
+			gl::Uniform3f(this->tileSizeLoc, tileSize.x, tileSize.y, tileSize.z);
+			this->Uniform(this->slotsLoc, TileVolume::SlotsPerTile);
 			this->Uniform(this->offsetLoc, offset);
-			this->Uniform(this->sizeLoc, size);
 			this->Uniform(this->screenSizeLoc, screenSize);
-			this->Uniform(this->colourLoc, colour);
 			this->Uniform(this->flipYLoc, flipY);
+			this->Uniform(this->minAlphaLoc, minAlpha);
+			this->Uniform(this->maxAlphaLoc, maxAlpha);
+			this->Uniform(this->atlasLoc, atlasUnit);
+			this->Uniform(this->palLoc, palUnit);
+			this->Uniform(this->idsLoc, idsUnit);
+			this->Uniform(this->tableLoc, tableUnit);
+		}
+		void setPage(int page)
+		{
+			this->Uniform(this->pageLoc, page);
 		}
 };
 
@@ -408,27 +458,370 @@ public:
 	}
 };
 
-class ActiveTexture
+//Vertex buffer that's filled front to back as batches are drawn. When a
+//batch doesn't fit in the space left the buffer is orphaned, so the driver
+//can hand out fresh storage rather than wait for draws still reading the
+//old contents
+class StreamingBuffer
+{
+	StreamingBuffer(const StreamingBuffer &) = delete;
+public:
+	GLuint buffer;
+	size_t size;
+	size_t offset;
+	StreamingBuffer(size_t size)
+		: size(size), offset(0)
+	{
+		gl::GenBuffers(1, &buffer);
+		gl::BindBuffer(gl::ARRAY_BUFFER, buffer);
+		gl::BufferData(gl::ARRAY_BUFFER, size, NULL, gl::STREAM_DRAW);
+		gl::BindBuffer(gl::ARRAY_BUFFER, 0);
+	}
+	~StreamingBuffer()
+	{
+		gl::DeleteBuffers(1, &buffer);
+	}
+	//Copies 'length' bytes into the buffer, which must be bound to
+	//ARRAY_BUFFER, and returns the offset they were written at
+	size_t upload(const void *data, size_t length)
+	{
+		assert(length <= size);
+		if (offset + length > size)
+		{
+			gl::BufferData(gl::ARRAY_BUFFER, size, NULL, gl::STREAM_DRAW);
+			offset = 0;
+		}
+		size_t start = offset;
+		//Nothing in flight reads past 'offset', so no need to synchronise
+		void *ptr = gl::MapBufferRange(gl::ARRAY_BUFFER, start, length,
+			gl::MAP_WRITE_BIT | gl::MAP_INVALIDATE_RANGE_BIT | gl::MAP_UNSYNCHRONIZED_BIT);
+		if (ptr)
+		{
+			memcpy(ptr, data, length);
+			gl::UnmapBuffer(gl::ARRAY_BUFFER);
+		}
+		else
+		{
+			gl::BufferSubData(gl::ARRAY_BUFFER, start, length, data);
+		}
+		//Keep every batch aligned for the attribute formats
+		offset = (start + length + 15) & ~(size_t)15;
+		return start;
+	}
+};
+
+//Calls made through the gl:: function pointers CountGLCalls() wraps, the
+//way a tracing tool like apitrace would count them
+uint64_t glCallCount = 0;
+
+template <typename FnPtr, FnPtr *Slot>
+class CountedGLCall;
+
+template <typename R, typename... Args, R (CODEGEN_FUNCPTR **Slot)(Args...)>
+class CountedGLCall<R (CODEGEN_FUNCPTR *)(Args...), Slot>
+{
+	static R (CODEGEN_FUNCPTR *real)(Args...);
+	static R CODEGEN_FUNCPTR call(Args... args)
+	{
+		glCallCount++;
+		return real(args...);
+	}
+public:
+	static void install()
+	{
+		real = *Slot;
+		*Slot = &call;
+	}
+};
+
+template <typename R, typename... Args, R (CODEGEN_FUNCPTR **Slot)(Args...)>
+R (CODEGEN_FUNCPTR *CountedGLCall<R (CODEGEN_FUNCPTR *)(Args...), Slot>::real)(Args...) = nullptr;
+
+#define COUNT_GL_CALL(fn) CountedGLCall<decltype(gl::fn), &gl::fn>::install()
+
+//Must be called after the function pointers are loaded. Only wraps them
+//the first time
+static void CountGLCalls()
+{
+	static bool installed = false;
+	if (installed)
+		return;
+	installed = true;
+	COUNT_GL_CALL(ActiveTexture);
+	COUNT_GL_CALL(BindBuffer);
+	COUNT_GL_CALL(BindFramebuffer);
+	COUNT_GL_CALL(BindRenderbuffer);
+	COUNT_GL_CALL(BindTexture);
+	COUNT_GL_CALL(BindVertexArray);
+	COUNT_GL_CALL(BlendFunc);
+	COUNT_GL_CALL(BlitFramebuffer);
+	COUNT_GL_CALL(BufferData);
+	COUNT_GL_CALL(BufferSubData);
+	COUNT_GL_CALL(Clear);
+	COUNT_GL_CALL(ClearColor);
+	COUNT_GL_CALL(DeleteBuffers);
+	COUNT_GL_CALL(DeleteFramebuffers);
+	COUNT_GL_CALL(DeleteRenderbuffers);
+	COUNT_GL_CALL(DepthFunc);
+	COUNT_GL_CALL(DepthMask);
+	COUNT_GL_CALL(DeleteTextures);
+	COUNT_GL_CALL(Disable);
+	COUNT_GL_CALL(DrawArrays);
+	COUNT_GL_CALL(DrawArraysInstancedARB);
+	COUNT_GL_CALL(DrawElements);
+	COUNT_GL_CALL(Enable);
+	COUNT_GL_CALL(EnableVertexAttribArray);
+	COUNT_GL_CALL(FramebufferRenderbuffer);
+	COUNT_GL_CALL(GenBuffers);
+	COUNT_GL_CALL(GenFramebuffers);
+	COUNT_GL_CALL(GenRenderbuffers);
+	COUNT_GL_CALL(GenTextures);
+	COUNT_GL_CALL(GetIntegerv);
+	COUNT_GL_CALL(GetTexParameteriv);
+	COUNT_GL_CALL(MapBufferRange);
+	COUNT_GL_CALL(PixelStorei);
+	COUNT_GL_CALL(RenderbufferStorage);
+	COUNT_GL_CALL(Scissor);
+	COUNT_GL_CALL(TexImage2D);
+	COUNT_GL_CALL(TexImage3D);
+	COUNT_GL_CALL(TexParameteri);
+	COUNT_GL_CALL(TexSubImage3D);
+	COUNT_GL_CALL(Uniform1f);
+	COUNT_GL_CALL(Uniform1i);
+	COUNT_GL_CALL(Uniform2f);
+	COUNT_GL_CALL(Uniform3f);
+	COUNT_GL_CALL(Uniform3i);
+	COUNT_GL_CALL(Uniform4f);
+	COUNT_GL_CALL(UnmapBuffer);
+	COUNT_GL_CALL(UseProgram);
+	COUNT_GL_CALL(VertexAttribDivisorARB);
+	COUNT_GL_CALL(VertexAttribIPointer);
+	COUNT_GL_CALL(VertexAttribPointer);
+	COUNT_GL_CALL(Viewport);
+}
+
+#undef COUNT_GL_CALL
+
+//Shadow copy of the GL state the renderer changes. Everything binding or
+//setting that state goes through here, so redundant changes are skipped and
+//previous values never have to be read back from GL, which can stall until
+//the driver has caught up. State that hasn't been set through the cache yet
+//is unknown, and always gets set.
+class GLStateCache
 {
-	ActiveTexture(const ActiveTexture &) = delete;
+	//Keyed by {unit, target}
+	std::map<std::pair<int, GLenum>, GLuint> textures;
+	//Keyed by texture, then parameter
+	std::map<GLuint, std::map<GLenum, GLint>> texParams;
+	GLenum blendSrc;
+	GLenum blendDst;
 public:
-	GLenum prevUnit;
-	static GLenum getUnitEnum(int unit)
+	//The enum value (TEXTURE0 + unit), as glActiveTexture takes
+	GLenum activeUnit;
+	GLuint program;
+	GLuint drawFramebuffer;
+	GLint unpackAlignment;
+	bool blend;
+	bool depthTest;
+	bool depthWrite;
+	//Calls skipped because the state was already set
+	uint64_t skipped;
+
+	GLStateCache()
+		: skipped(0)
+	{
+		forget();
+	}
+	//Puts the state into known values. Needs a current context
+	void reset()
 	{
-		return gl::TEXTURE0 + unit;
+		forget();
+		gl::ActiveTexture(gl::TEXTURE0);
+		activeUnit = gl::TEXTURE0;
+		gl::UseProgram(0);
+		program = 0;
+		gl::BindFramebuffer(gl::DRAW_FRAMEBUFFER, 0);
+		drawFramebuffer = 0;
+		gl::PixelStorei(gl::UNPACK_ALIGNMENT, 4);
+		unpackAlignment = 4;
+		gl::Disable(gl::BLEND);
+		blend = false;
+		//Later sprites at the same depth draw over earlier ones
+		gl::DepthFunc(gl::LEQUAL);
+		gl::Disable(gl::DEPTH_TEST);
+		depthTest = false;
+		gl::DepthMask(gl::TRUE_);
+		depthWrite = true;
+	}
+	void forget()
+	{
+		textures.clear();
+		texParams.clear();
+		activeUnit = 0;
+		program = -1;
+		drawFramebuffer = -1;
+		unpackAlignment = 0;
+		blend = false;
+		blendSrc = 0;
+		blendDst = 0;
+		depthTest = false;
+		depthWrite = true;
 	}
 
-	ActiveTexture(int unit)
+	void setActiveUnit(GLenum unit)
+	{
+		if (activeUnit == unit)
+		{
+			skipped++;
+			return;
+		}
+		gl::ActiveTexture(unit);
+		activeUnit = unit;
+	}
+	void bindTexture(int unit, GLenum target, GLuint id)
+	{
+		auto key = std::make_pair(unit, target);
+		auto it = textures.find(key);
+		if (it != textures.end() && it->second == id)
+		{
+			skipped++;
+			return;
+		}
+		setActiveUnit(gl::TEXTURE0 + unit);
+		gl::BindTexture(target, id);
+		textures[key] = id;
+	}
+	//Returns false if the binding isn't known
+	bool boundTexture(int unit, GLenum target, GLuint &id) const
+	{
+		auto it = textures.find(std::make_pair(unit, target));
+		if (it == textures.end())
+			return false;
+		id = it->second;
+		return true;
+	}
+	//Sets a parameter of the texture bound to 'target' on the active unit
+	void texParameter(GLenum target, GLenum param, GLint value)
+	{
+		GLuint id;
+		if (!boundTexture(activeUnit - gl::TEXTURE0, target, id))
+		{
+			gl::TexParameteri(target, param, value);
+			return;
+		}
+		auto &params = texParams[id];
+		auto it = params.find(param);
+		if (it != params.end() && it->second == value)
+		{
+			skipped++;
+			return;
+		}
+		gl::TexParameteri(target, param, value);
+		params[param] = value;
+	}
+	//Returns false if the parameter isn't known
+	bool texParameter(GLuint id, GLenum param, GLint &value) const
+	{
+		auto tex = texParams.find(id);
+		if (tex == texParams.end())
+			return false;
+		auto it = tex->second.find(param);
+		if (it == tex->second.end())
+			return false;
+		value = it->second;
+		return true;
+	}
+	void deleteTexture(GLuint id)
+	{
+		gl::DeleteTextures(1, &id);
+		//GL unbinds deleted textures, and the name may be handed out again
+		for (auto &binding : textures)
+		{
+			if (binding.second == id)
+				binding.second = 0;
+		}
+		texParams.erase(id);
+	}
+	void useProgram(GLuint id)
 	{
-		gl::GetIntegerv(gl::ACTIVE_TEXTURE, (GLint*)&prevUnit);
-		gl::ActiveTexture(getUnitEnum(unit));
+		if (program == id)
+		{
+			skipped++;
+			return;
+		}
+		gl::UseProgram(id);
+		program = id;
+	}
+	void bindFramebuffer(GLuint id)
+	{
+		if (drawFramebuffer == id)
+		{
+			skipped++;
+			return;
+		}
+		gl::BindFramebuffer(gl::DRAW_FRAMEBUFFER, id);
+		drawFramebuffer = id;
+	}
+	void deleteFramebuffer(GLuint id)
+	{
+		gl::DeleteFramebuffers(1, &id);
+		if (drawFramebuffer == id)
+			drawFramebuffer = 0;
+	}
+	void setUnpackAlignment(GLint align)
+	{
+		if (unpackAlignment == align)
+		{
+			skipped++;
+			return;
+		}
+		gl::PixelStorei(gl::UNPACK_ALIGNMENT, align);
+		unpackAlignment = align;
+	}
+	void setBlend(bool enable, GLenum src = gl::SRC_ALPHA, GLenum dst = gl::ONE_MINUS_SRC_ALPHA)
+	{
+		if (blend != enable)
+		{
+			if (enable)
+				gl::Enable(gl::BLEND);
+			else
+				gl::Disable(gl::BLEND);
+			blend = enable;
+		}
+		else
+			skipped++;
+		if (enable && (blendSrc != src || blendDst != dst))
+		{
+			gl::BlendFunc(src, dst);
+			blendSrc = src;
+			blendDst = dst;
+		}
 	}
-	~ActiveTexture()
+	void setDepth(bool test, bool write)
 	{
-		gl::ActiveTexture(prevUnit);
+		if (depthTest != test)
+		{
+			if (test)
+				gl::Enable(gl::DEPTH_TEST);
+			else
+				gl::Disable(gl::DEPTH_TEST);
+			depthTest = test;
+		}
+		else
+			skipped++;
+		if (depthWrite != write)
+		{
+			gl::DepthMask(write ? gl::TRUE_ : gl::FALSE_);
+			depthWrite = write;
+		}
+		else
+			skipped++;
 	}
 };
 
+//There's only ever one GL context
+GLStateCache glState;
+
 class UnpackAlignment
 {
 	UnpackAlignment(const UnpackAlignment &) = delete;
@@ -436,12 +829,12 @@ public:
 	GLint prevAlign;
 	UnpackAlignment(int align)
 	{
-		gl::GetIntegerv(gl::UNPACK_ALIGNMENT, &prevAlign);
-		gl::PixelStorei(gl::UNPACK_ALIGNMENT, align);
+		prevAlign = glState.unpackAlignment;
+		glState.setUnpackAlignment(align);
 	}
 	~UnpackAlignment()
 	{
-		gl::PixelStorei(gl::UNPACK_ALIGNMENT, prevAlign);
+		glState.setUnpackAlignment(prevAlign);
 	}
 };
 
@@ -451,30 +844,20 @@ class BindTexture
 public:
 	GLenum bind;
 	GLuint prevID;
+	bool prevKnown;
 	int unit;
-	static GLenum getBindEnum(GLenum e)
-	{
-		switch (e) {
-			case gl::TEXTURE_1D: return gl::TEXTURE_BINDING_1D;
-			case gl::TEXTURE_2D: return gl::TEXTURE_BINDING_2D;
-			case gl::TEXTURE_3D: return gl::TEXTURE_BINDING_3D;
-			case gl::TEXTURE_2D_ARRAY: return gl::TEXTURE_BINDING_2D_ARRAY;
-			default:
-				LogError("Unknown texture enum %d", (int)e);
-				return gl::TEXTURE_BINDING_2D;
-		}
-	}
 	BindTexture(GLuint id, GLint unit = 0, GLenum bind = gl::TEXTURE_2D)
 		: bind(bind), unit(unit) 
 	{
-		ActiveTexture a(unit);
-		gl::GetIntegerv(getBindEnum(bind), (GLint*)&prevID);
-		gl::BindTexture(bind, id);
+		prevKnown = glState.boundTexture(unit, bind, prevID);
+		glState.bindTexture(unit, bind, id);
+		//So calls on the bound texture that follow act on this one
+		glState.setActiveUnit(gl::TEXTURE0 + unit);
 	}
 	~BindTexture()
 	{
-		ActiveTexture a(unit);
-		gl::BindTexture(bind, prevID);
+		if (prevKnown)
+			glState.bindTexture(unit, bind, prevID);
 	}
 };
 
@@ -484,6 +867,7 @@ class TexParam
 	TexParam(const TexParam&) = delete;
 public:
 	GLint prevValue;
+	bool prevKnown;
 	GLuint id;
 	GLenum type;
 
@@ -491,13 +875,15 @@ public:
 		: id(id), type(type)
 	{
 		BindTexture b(id, 0, type);
-		gl::GetTexParameteriv(type, param, &prevValue);
-		gl::TexParameteri(type, param, value);
+		prevKnown = glState.texParameter(id, param, prevValue);
+		glState.texParameter(type, param, value);
 	}
 	~TexParam()
 	{
+		if (!prevKnown)
+			return;
 		BindTexture b(id, 0, type);
-		gl::TexParameteri(type, param, prevValue);
+		glState.texParameter(type, param, prevValue);
 	}
 };
 
@@ -508,13 +894,103 @@ public:
 	GLuint prevID;
 	BindFramebuffer(GLuint id)
 	{
-		gl::GetIntegerv(gl::DRAW_FRAMEBUFFER_BINDING, (GLint*)&prevID);
-		gl::BindFramebuffer(gl::DRAW_FRAMEBUFFER, id);
+		prevID = glState.drawFramebuffer;
+		glState.bindFramebuffer(id);
 
 	}
 	~BindFramebuffer()
 	{
-		gl::BindFramebuffer(gl::DRAW_FRAMEBUFFER, prevID);
+		glState.bindFramebuffer(prevID);
+	}
+};
+
+//Creates an RGBA texture of 'size' with a framebuffer object drawing to it
+static void CreateRenderTarget(Vec2<int> size, GLuint &fbo, GLuint &tex)
+{
+	gl::GenTextures(1, &tex);
+	BindTexture b(tex);
+	gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA8, size.x, size.y, 0, gl::RGBA, gl::UNSIGNED_BYTE, NULL);
+	glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+	glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+	gl::GenFramebuffers(1, &fbo);
+	BindFramebuffer f(fbo);
+
+	gl::FramebufferTexture2D(gl::DRAW_FRAMEBUFFER, gl::COLOR_ATTACHMENT0, gl::TEXTURE_2D, tex, 0);
+	assert(gl::CheckFramebufferStatus(gl::DRAW_FRAMEBUFFER) == gl::FRAMEBUFFER_COMPLETE);
+}
+
+//Creates a depth buffer of 'size' and attaches it to 'fbo'. Its contents
+//are undefined until cleared
+static GLuint CreateDepthBuffer(GLuint fbo, Vec2<int> size)
+{
+	GLuint depth;
+	gl::GenRenderbuffers(1, &depth);
+	gl::BindRenderbuffer(gl::RENDERBUFFER, depth);
+	gl::RenderbufferStorage(gl::RENDERBUFFER, gl::DEPTH_COMPONENT24, size.x, size.y);
+	gl::BindRenderbuffer(gl::RENDERBUFFER, 0);
+	BindFramebuffer f(fbo);
+	gl::FramebufferRenderbuffer(gl::DRAW_FRAMEBUFFER, gl::DEPTH_ATTACHMENT, gl::RENDERBUFFER, depth);
+	assert(gl::CheckFramebufferStatus(gl::DRAW_FRAMEBUFFER) == gl::FRAMEBUFFER_COMPLETE);
+	return depth;
+}
+
+//A single render target split into a grid of equally sized slots, each of
+//which can back a small surface
+class SurfacePage
+{
+	SurfacePage(const SurfacePage &) = delete;
+public:
+	GLuint fbo;
+	GLuint tex;
+	//Attached the first time a surface on the page draws with depth
+	GLuint depth;
+	Vec2<int> pageSize;
+	Vec2<int> slotSize;
+	unsigned slotsPerRow;
+	unsigned numSlots;
+	std::vector<unsigned> freeSlots;
+
+	SurfacePage(Vec2<int> pageSize, Vec2<int> slotSize)
+		: depth(0), pageSize(pageSize), slotSize(slotSize),
+		slotsPerRow(pageSize.x / slotSize.x),
+		numSlots(slotsPerRow * (pageSize.y / slotSize.y))
+	{
+		assert(numSlots > 0);
+		CreateRenderTarget(pageSize, fbo, tex);
+		//Hand out the slots in order
+		for (unsigned i = numSlots; i > 0; i--)
+			freeSlots.push_back(i - 1);
+	}
+	~SurfacePage()
+	{
+		glState.deleteTexture(tex);
+		glState.deleteFramebuffer(fbo);
+		if (depth)
+			gl::DeleteRenderbuffers(1, &depth);
+	}
+	bool full() const
+	{
+		return freeSlots.empty();
+	}
+	bool unused() const
+	{
+		return freeSlots.size() == numSlots;
+	}
+	unsigned acquire()
+	{
+		assert(!full());
+		unsigned slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+	void release(unsigned slot)
+	{
+		assert(slot < numSlots);
+		freeSlots.push_back(slot);
+	}
+	Vec2<int> slotOffset(unsigned slot) const
+	{
+		return Vec2<int>{(int)(slot % slotsPerRow) * slotSize.x, (int)(slot / slotsPerRow) * slotSize.y};
 	}
 };
 
@@ -524,34 +1000,117 @@ public:
 	GLuint fbo;
 	GLuint tex;
 	Vec2<float> size;
+	//Where the surface lives within 'tex', and the size of the whole of 'tex'
+	Vec2<int> offset;
+	Vec2<int> texSize;
+	//If set, this surface is leasing a slot from a shared page, which
+	//owns the fbo and texture
+	std::shared_ptr<SurfacePage> page;
+	unsigned slot;
+	//Depth buffers are only attached to surfaces that draw with depth.
+	//'depth' is only set if this surface owns the buffer - not for the
+	//default surface, or one leasing a slot
+	GLuint depth;
+	bool hasDepth;
 	//Constructor /only/ to be used for default surface (FBO ID == 0)
-	FBOData(GLuint fbo)
+	FBOData(GLuint fbo, bool hasDepth)
 		//FIXME: Check FBO == 0
 		//FIXME: Warn if trying to texture from FBO 0
-		: fbo(fbo), tex(-1), size(0,0){}
+		: fbo(fbo), tex(-1), size(0,0), offset(0,0), texSize(0,0), slot(0), depth(0), hasDepth(hasDepth){}
 
 	FBOData(Vec2<int> size)
-		:size(size.x, size.y)
+		:size(size.x, size.y), offset(0,0), texSize(size), slot(0), depth(0), hasDepth(false)
 	{
-		gl::GenTextures(1, &this->tex);
-		BindTexture b(this->tex);
-		gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA8, size.x, size.y, 0, gl::RGBA, gl::UNSIGNED_BYTE, NULL);
-		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
-		gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
-		gl::GenFramebuffers(1, &this->fbo);
-		BindFramebuffer f(this->fbo);
-
-		gl::FramebufferTexture2D(gl::DRAW_FRAMEBUFFER, gl::COLOR_ATTACHMENT0, gl::TEXTURE_2D, this->tex, 0);
-		assert(gl::CheckFramebufferStatus(gl::DRAW_FRAMEBUFFER) == gl::FRAMEBUFFER_COMPLETE);
-
+		CreateRenderTarget(size, this->fbo, this->tex);
+	}
 
+	FBOData(std::shared_ptr<SurfacePage> page, Vec2<int> size)
+		: fbo(page->fbo), tex(page->tex), size(size.x, size.y), texSize(page->pageSize), page(page), depth(0), hasDepth(false)
+	{
+		this->slot = page->acquire();
+		this->offset = page->slotOffset(this->slot);
 	}
 	virtual ~FBOData()
 	{
+		if (page)
+		{
+			page->release(slot);
+			return;
+		}
+		if (depth)
+			gl::DeleteRenderbuffers(1, &depth);
 		if (tex)
-			gl::DeleteTextures(1, &tex);
+			glState.deleteTexture(tex);
 		if (fbo)
-			gl::DeleteFramebuffers(1, &fbo);
+			glState.deleteFramebuffer(fbo);
+	}
+};
+
+//Hands out render targets for surfaces. Small surfaces are rounded up to a
+//power-of-two bucket and lease a slot in a page shared with other surfaces
+//of the same bucket, so a form full of controls only needs a handful of
+//FBOs. Anything too big to share a page gets a dedicated FBO.
+class SurfacePool
+{
+	SurfacePool(const SurfacePool &) = delete;
+	static const int minSlotSize = 16;
+	static const int slotsPerSide = 8;
+	int maxPageSize;
+	std::map<std::pair<int,int>, std::vector<std::shared_ptr<SurfacePage>>> pages;
+
+	static int roundUp(int v)
+	{
+		int r = minSlotSize;
+		while (r < v)
+			r *= 2;
+		return r;
+	}
+	//Drops every page nobody is leasing from, other than one in 'keep'
+	void trim(std::pair<int,int> keep)
+	{
+		for (auto &bucket : pages)
+		{
+			bool keptOne = (bucket.first != keep);
+			auto &list = bucket.second;
+			for (auto it = list.begin(); it != list.end();)
+			{
+				if ((*it)->unused())
+				{
+					if (keptOne)
+					{
+						it = list.erase(it);
+						continue;
+					}
+					keptOne = true;
+				}
+				++it;
+			}
+		}
+	}
+public:
+	SurfacePool(int maxPageSize)
+		: maxPageSize(maxPageSize){}
+
+	//Never gives a slot on 'avoid', if set
+	FBOData *allocate(Vec2<int> size, std::shared_ptr<SurfacePage> avoid = nullptr)
+	{
+		Vec2<int> slotSize{roundUp(size.x), roundUp(size.y)};
+		Vec2<int> pageSize{std::min(slotSize.x * slotsPerSide, maxPageSize),
+			std::min(slotSize.y * slotsPerSide, maxPageSize)};
+		if ((pageSize.x / slotSize.x) * (pageSize.y / slotSize.y) < 2)
+			return new FBOData(size);
+
+		auto key = std::make_pair(slotSize.x, slotSize.y);
+		trim(key);
+		auto &bucket = pages[key];
+		for (auto &page : bucket)
+		{
+			if (!page->full() && page != avoid)
+				return new FBOData(page, size);
+		}
+		auto page = std::make_shared<SurfacePage>(pageSize, slotSize);
+		bucket.push_back(page);
+		return new FBOData(page, size);
 	}
 };
 
@@ -567,14 +1126,14 @@ class GLRGBImage : public RendererImageData
 			RGBImageLock l(parent, ImageLockUse::Read);
 			gl::GenTextures(1, &this->texID);
 			BindTexture b(this->texID);
-			gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
-			gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
 			gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA, parent->size.x, parent->size.y, 0, gl::RGBA, gl::UNSIGNED_BYTE, l.getData());
 
 		}
 		virtual ~GLRGBImage()
 		{
-			gl::DeleteTextures(1, &this->texID);
+			glState.deleteTexture(this->texID);
 		}
 };
 
@@ -589,14 +1148,14 @@ class GLPalette : public RendererImageData
 		{
 			gl::GenTextures(1, &this->texID);
 			BindTexture b(this->texID);
-			gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
-			gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
 			gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA, parent->colours.size(), 1, 0, gl::RGBA, gl::UNSIGNED_BYTE, parent->colours.data());
 
 		}
 		virtual ~GLPalette()
 		{
-			gl::DeleteTextures(1, &this->texID);
+			glState.deleteTexture(this->texID);
 		}
 };
 
@@ -613,54 +1172,277 @@ class GLPaletteImage : public RendererImageData
 			gl::GenTextures(1, &this->texID);
 			BindTexture b(this->texID);
 			UnpackAlignment align(1);
-			gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
-			gl::TexParameteri(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
 			gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RED, parent->size.x, parent->size.y, 0, gl::RED, gl::UNSIGNED_BYTE, l.getData());
 
 		}
 		virtual ~GLPaletteImage()
 		{
-			gl::DeleteTextures(1, &this->texID);
+			glState.deleteTexture(this->texID);
 		}
 };
 
-class GLPaletteSpritesheet : public RendererImageData
+//Fills the layers of a texture array with shelves of sprites, left to right
+//and top to bottom
+class ShelfPacker
 {
-	public:
-		std::weak_ptr<ImageSet> parent;
-		Vec2<int> maxSize;
-		unsigned numSprites;
-		GLuint texID;
-		GLPaletteSpritesheet(std::shared_ptr<ImageSet> parent)
-			: parent(parent), maxSize(parent->maxSize), numSprites(parent->images.size())
-		{
-			gl::GenTextures(1, &this->texID);
-			BindTexture b(this->texID, 0, gl::TEXTURE_2D_ARRAY);
-			UnpackAlignment align(1);
-			gl::TexParameteri(gl::TEXTURE_2D_ARRAY, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
-			gl::TexParameteri(gl::TEXTURE_2D_ARRAY, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
-			gl::TexImage3D(gl::TEXTURE_2D_ARRAY, 0, gl::R8UI, maxSize.x, maxSize.y, numSprites, 0, gl::RED_INTEGER, gl::UNSIGNED_BYTE, NULL);
+public:
+	int layerSize;
+	int numLayers;
+	int layer;
+	Vec2<int> shelfPos;
+	int shelfHeight;
+	ShelfPacker(int layerSize, int numLayers)
+		: layerSize(layerSize), numLayers(numLayers)
+	{
+		reset();
+	}
+	void reset()
+	{
+		layer = 0;
+		shelfPos = Vec2<int>{0, 0};
+		shelfHeight = 0;
+	}
+	bool allocate(Vec2<int> size, int &outLayer, Vec2<int> &outOffset)
+	{
+		if (size.x > layerSize || size.y > layerSize)
+			return false;
+		if (shelfPos.x + size.x > layerSize)
+		{
+			shelfPos = Vec2<int>{0, shelfPos.y + shelfHeight};
+			shelfHeight = 0;
+		}
+		if (shelfPos.y + size.y > layerSize)
+		{
+			layer++;
+			shelfPos = Vec2<int>{0, 0};
+			shelfHeight = 0;
+		}
+		if (layer >= numLayers)
+			return false;
+		outLayer = layer;
+		outOffset = shelfPos;
+		shelfPos.x += size.x;
+		shelfHeight = std::max(shelfHeight, size.y);
+		return true;
+	}
+};
 
-			std::unique_ptr<char[]> zeros(new char[maxSize.x * maxSize.y]);
-			memset(zeros.get(), 1, maxSize.x * maxSize.y);
+//A texture array shared by the sprites of many ImageSets, so a batch can mix
+//sprites from any of them. Space is only reclaimed once no ImageSet is using
+//the page
+class SpriteAtlasPage
+{
+	SpriteAtlasPage(const SpriteAtlasPage &) = delete;
+public:
+	GLuint texID;
+	ShelfPacker packer;
+	unsigned users;
+	SpriteAtlasPage(int layerSize, int numLayers)
+		: packer(layerSize, numLayers), users(0)
+	{
+		gl::GenTextures(1, &this->texID);
+		BindTexture b(this->texID, 0, gl::TEXTURE_2D_ARRAY);
+		glState.texParameter(gl::TEXTURE_2D_ARRAY, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+		glState.texParameter(gl::TEXTURE_2D_ARRAY, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+		gl::TexImage3D(gl::TEXTURE_2D_ARRAY, 0, gl::R8UI, layerSize, layerSize, numLayers, 0, gl::RED_INTEGER, gl::UNSIGNED_BYTE, NULL);
+	}
+	~SpriteAtlasPage()
+	{
+		glState.deleteTexture(this->texID);
+	}
+	void addUser()
+	{
+		users++;
+	}
+	void removeUser()
+	{
+		assert(users > 0);
+		if (--users == 0)
+			packer.reset();
+	}
+};
 
-			for (unsigned int i = 0; i < numSprites; i++)
+class SpriteAtlas
+{
+	SpriteAtlas(const SpriteAtlas &) = delete;
+	int layerSize;
+	int layersPerPage;
+	std::vector<std::shared_ptr<SpriteAtlasPage>> pages;
+
+	//Drops every page nobody is using, other than the first
+	void trim()
+	{
+		bool keptOne = false;
+		for (auto it = pages.begin(); it != pages.end();)
+		{
+			if ((*it)->users == 0)
 			{
-				std::shared_ptr<PaletteImage> img =
-					std::dynamic_pointer_cast<PaletteImage>(parent->images[i]);
-				//FIXME: HACK - better way of clearing undefined portions to '0'?
-				gl::TexSubImage3D(gl::TEXTURE_2D_ARRAY, 0, 0, 0, i, maxSize.x, maxSize.y, 1, gl::RED_INTEGER, gl::UNSIGNED_BYTE, zeros.get());
+				if (keptOne)
+				{
+					it = pages.erase(it);
+					continue;
+				}
+				keptOne = true;
+			}
+			++it;
+		}
+	}
+public:
+	SpriteAtlas(int layerSize, int layersPerPage)
+		: layerSize(layerSize), layersPerPage(layersPerPage){}
+
+	bool fits(Vec2<int> size) const
+	{
+		return size.x <= layerSize && size.y <= layerSize;
+	}
 
-				PaletteImageLock l(img, ImageLockUse::Read);
+	//Returns a page with room for every one of 'sizes' (which must all
+	//fit() a page), or nullptr if there's none and a new page couldn't hold
+	//them all either
+	std::shared_ptr<SpriteAtlasPage> findPage(const std::vector<Vec2<int>> &sizes)
+	{
+		trim();
+		for (auto &page : pages)
+		{
+			ShelfPacker trial = page->packer;
+			int layer;
+			Vec2<int> offset;
+			bool allFit = true;
+			for (auto &size : sizes)
+			{
+				if (!trial.allocate(size, layer, offset))
+				{
+					allFit = false;
+					break;
+				}
+			}
+			if (allFit)
+				return page;
+		}
+		return nullptr;
+	}
 
-				gl::TexSubImage3D(gl::TEXTURE_2D_ARRAY, 0, 0, 0, i, img->size.x, img->size.y, 1, gl::RED_INTEGER, gl::UNSIGNED_BYTE, l.getData());
+	std::shared_ptr<SpriteAtlasPage> newPage()
+	{
+		auto page = std::make_shared<SpriteAtlasPage>(layerSize, layersPerPage);
+		pages.push_back(page);
+		return page;
+	}
+};
 
+//Where each image of an ImageSet lives in the atlas. Only the opaque part
+//of each image is stored, as most sprites (city tiles especially) are mostly
+//transparent
+class GLAtlasSpriteSet : public RendererImageData
+{
+	public:
+		class Sprite
+		{
+		public:
+			//nullptr if the image couldn't be put in the atlas
+			std::shared_ptr<SpriteAtlasPage> page;
+			int layer;
+			Vec2<int> offset;
+			//The part of the image stored at 'offset'. Empty if the image
+			//is entirely transparent, in which case nothing is stored
+			Rect<int> bounds;
+		};
+		std::vector<Sprite> sprites;
+		//Each page this set uses, once
+		std::vector<std::shared_ptr<SpriteAtlasPage>> pages;
+
+		GLAtlasSpriteSet(SpriteAtlas &atlas, std::shared_ptr<ImageSet> parent)
+		{
+			std::vector<std::shared_ptr<PaletteImage>> images;
+			std::vector<Rect<int>> bounds;
+			std::vector<Vec2<int>> sizes;
+			uint64_t fullTexels = 0, trimmedTexels = 0;
+			for (auto &image : parent->images)
+			{
+				auto img = std::dynamic_pointer_cast<PaletteImage>(image);
+				Rect<int> imgBounds;
+				if (img)
+				{
+					imgBounds = img->getOpaqueBounds();
+					if (!atlas.fits(imgBounds.size()))
+					{
+						LogWarning("Image %dx%d too large for the sprite atlas - using the 'slow' path", img->size.x, img->size.y);
+						img = nullptr;
+					}
+				}
+				images.push_back(img);
+				bounds.push_back(imgBounds);
+				if (img)
+				{
+					fullTexels += img->size.x * img->size.y;
+					trimmedTexels += imgBounds.size().x * imgBounds.size().y;
+					if (imgBounds.size().x > 0)
+						sizes.push_back(imgBounds.size());
+				}
 			}
+			LogInfo("Packing %u images into the sprite atlas, %llu texels trimmed to %llu",
+				(unsigned)images.size(), (unsigned long long)fullTexels, (unsigned long long)trimmedTexels);
+
+			//Keep the whole set on one page if we can, so it never breaks a
+			//batch against itself
+			auto page = atlas.findPage(sizes);
+			if (!page)
+				page = atlas.newPage();
+			usePage(page);
 
+			UnpackAlignment align(1);
+			std::unique_ptr<BindTexture> bind(new BindTexture(page->texID, 0, gl::TEXTURE_2D_ARRAY));
+			std::vector<uint8_t> trimmed;
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				auto &img = images[i];
+				Sprite sprite;
+				sprite.layer = 0;
+				sprite.bounds = bounds[i];
+				Vec2<int> size = sprite.bounds.size();
+				if (img && size.x == 0)
+				{
+					//Nothing to store, but still drawn (as nothing) by the
+					//batch path
+					sprite.page = page;
+				}
+				else if (img)
+				{
+					if (!page->packer.allocate(size, sprite.layer, sprite.offset))
+					{
+						//Too big for one page - carry on in a fresh one
+						page = atlas.newPage();
+						usePage(page);
+						bind.reset();
+						bind.reset(new BindTexture(page->texID, 0, gl::TEXTURE_2D_ARRAY));
+						page->packer.allocate(size, sprite.layer, sprite.offset);
+					}
+					sprite.page = page;
+					PaletteImageLock l(img, ImageLockUse::Read);
+					const uint8_t *data = static_cast<const uint8_t*>(l.getData());
+					trimmed.resize(size.x * size.y);
+					for (int y = 0; y < size.y; y++)
+					{
+						memcpy(&trimmed[y * size.x],
+							&data[(sprite.bounds.p0.y + y) * img->size.x + sprite.bounds.p0.x], size.x);
+					}
+					gl::TexSubImage3D(gl::TEXTURE_2D_ARRAY, 0, sprite.offset.x, sprite.offset.y, sprite.layer,
+						size.x, size.y, 1, gl::RED_INTEGER, gl::UNSIGNED_BYTE, trimmed.data());
+				}
+				sprites.push_back(sprite);
+			}
+		}
+		void usePage(std::shared_ptr<SpriteAtlasPage> page)
+		{
+			page->addUser();
+			pages.push_back(page);
 		}
-		virtual ~GLPaletteSpritesheet()
+		virtual ~GLAtlasSpriteSet()
 		{
-			gl::DeleteTextures(1, &this->texID);
+			for (auto &page : pages)
+				page->removeUser();
 		}
 };
 
@@ -670,15 +1452,13 @@ private:
 	enum class RendererState
 	{
 		Idle,
-		BatchingSpritesheet,
+		Batching,
 	};
 	RendererState state;
-	std::shared_ptr<RGBProgram> rgbProgram;
-	std::shared_ptr<SolidColourProgram> colourProgram;
 	std::shared_ptr<PaletteProgram> paletteProgram;
-	std::shared_ptr<PaletteSetProgram> paletteSetProgram;
-	GLuint currentBoundProgram;
-	GLuint currentBoundFBO;
+	std::shared_ptr<SpriteBatchProgram> spriteBatchProgram;
+	//Only with instancing, as it draws a quad per tile
+	std::shared_ptr<TileVolumeProgram> tileVolumeProgram;
 
 	std::shared_ptr<Surface> currentSurface;
 	std::shared_ptr<Palette> currentPalette;
@@ -689,18 +1469,20 @@ private:
 		this->flush();
 		this->currentSurface = s;
 		if (!s->rendererPrivateData)
-			s->rendererPrivateData.reset(new FBOData(s->size));
+			s->rendererPrivateData.reset(surfacePool->allocate(s->size));
 
 		FBOData *fbo = static_cast<FBOData*>(s->rendererPrivateData.get());
-		gl::BindFramebuffer(gl::FRAMEBUFFER, fbo->fbo);
-		this->currentBoundFBO = fbo->fbo;
-		gl::Viewport(0, 0, s->size.x, s->size.y);
+		//Surfaces sharing a page don't need a framebuffer switch
+		glState.bindFramebuffer(fbo->fbo);
+		gl::Viewport(fbo->offset.x, fbo->offset.y, s->size.x, s->size.y);
+		gl::Scissor(fbo->offset.x, fbo->offset.y, s->size.x, s->size.y);
 	};
 	virtual std::shared_ptr<Surface> getSurface()
 	{
 		return currentSurface;
 	};
 	std::shared_ptr<Surface> defaultSurface;
+	std::unique_ptr<SurfacePool> surfacePool;
 public:
 	OGL30Renderer();
 	virtual ~OGL30Renderer();
@@ -709,39 +1491,39 @@ public:
 	{
 		if (!p->rendererPrivateData)
 			p->rendererPrivateData.reset(new GLPalette(p));
+		//Atlas sprites already in the batch were drawn with the old palette
+		if (p != this->currentPalette && this->boundAtlasPage)
+			this->flush();
 		this->currentPalette = p;
 	}
 	
-	virtual void draw(std::shared_ptr<Image> i, Vec2<float> position);
+	virtual void draw(std::shared_ptr<Image> i, Vec2<float> position)
+	{
+		this->drawScaled(i, position, i->size, Scaler::Nearest);
+	};
 	virtual void drawRotated(std::shared_ptr<Image> i, Vec2<float> center, Vec2<float> position, float angle)
 	{
-		LogError("Unimplemented function");
-		std::ignore = i;
-		std::ignore = center;
-		std::ignore = position;
-		std::ignore = angle;
+		SubmitTimer timer(*this);
+		float c = cosf(angle);
+		float s = sinf(angle);
+		Vec2<float> axisX{i->size.x * c, i->size.x * s};
+		Vec2<float> axisY{-i->size.y * s, i->size.y * c};
+		//'center' is the point of the image that ends up at 'position'
+		Vec2<float> origin{position.x - (center.x * c - center.y * s), position.y - (center.x * s + center.y * c)};
+		if (!BatchImage(i, origin, axisX, axisY, Scaler::Linear, Colour{255,255,255}))
+			LogError("Unsupported image type for rotated drawing");
 	};
 	virtual void drawScaled(std::shared_ptr<Image> image, Vec2<float> position, Vec2<float> size, Scaler scaler = Scaler::Linear)
 	{
-
-		if (this->state != RendererState::Idle)
-			this->flush();
-		std::shared_ptr<RGBImage> rgbImage = std::dynamic_pointer_cast<RGBImage>(image);
-		if (rgbImage)
-		{
-			GLRGBImage *img = dynamic_cast<GLRGBImage*>(rgbImage->rendererPrivateData.get());
-			if (!img)
-			{
-				img = new GLRGBImage(rgbImage);
-				image->rendererPrivateData.reset(img);
-			}
-			DrawRGB(*img, position, size, scaler);
+		SubmitTimer timer(*this);
+		if (BatchImage(image, position, Vec2<float>{size.x, 0}, Vec2<float>{0, size.y}, scaler, Colour{255,255,255}))
 			return;
-		}
 
+		//Paletted images outside an ImageSet aren't in the atlas
 		std::shared_ptr<PaletteImage> paletteImage = std::dynamic_pointer_cast<PaletteImage>(image);
 		if (paletteImage)
 		{
+			this->flush();
 			GLPaletteImage *img = dynamic_cast<GLPaletteImage*>(paletteImage->rendererPrivateData.get());
 			if (!img)
 			{
@@ -757,29 +1539,134 @@ public:
 			DrawPalette(*img, position, size);
 			return;
 		}
-
-		std::shared_ptr<Surface> surface = std::dynamic_pointer_cast<Surface>(image);
-		if (surface)
+		LogError("Unsupported image type");
+	};
+	virtual void drawTinted(std::shared_ptr<Image> i, Vec2<float> position, Colour tint)
+	{
+		SubmitTimer timer(*this);
+		if (!BatchImage(i, position, Vec2<float>{(float)i->size.x, 0}, Vec2<float>{0, (float)i->size.y}, Scaler::Nearest, tint))
+			LogError("Unsupported image type for tinted drawing");
+	};
+	virtual void drawDepth(std::shared_ptr<Image> i, Vec2<float> position, float depth, bool translucent = false)
+	{
+		SubmitTimer timer(*this);
+		if (!EnsureDepth())
 		{
-			FBOData *fbo = dynamic_cast<FBOData*>(surface->rendererPrivateData.get());
-			if (!fbo)
-			{
-				fbo = new FBOData(image->size);
-				image->rendererPrivateData.reset(fbo);
-			}
-			DrawSurface(*fbo, position, size, scaler);
+			this->draw(i, position);
 			return;
 		}
-		LogError("Unsupported image type");
+		if (!BatchImage(i, position, Vec2<float>{(float)i->size.x, 0}, Vec2<float>{0, (float)i->size.y}, Scaler::Nearest,
+				Colour{255,255,255}, translucent ? DepthMode::Translucent : DepthMode::Opaque, depth))
+			LogError("Unsupported image type for depth drawing");
 	};
-	virtual void drawTinted(std::shared_ptr<Image> i, Vec2<float> position, Colour tint)
+	virtual void drawSpriteList(std::shared_ptr<SpriteList> list, Vec2<float> offset, bool translucent)
 	{
-		LogError("Unimplemented function");
-		std::ignore = i;
-		std::ignore = position;
-		std::ignore = tint;
+		SubmitTimer timer(*this);
+		if (!EnsureDepth())
+		{
+			Renderer::drawSpriteList(list, offset, translucent);
+			return;
+		}
+		GLSpriteList *data = dynamic_cast<GLSpriteList*>(list->rendererPrivateData.get());
+		if (!data)
+		{
+			data = new GLSpriteList(*this, *list);
+			list->rendererPrivateData.reset(data);
+		}
+		this->flush();
+
+		gl::BindVertexArray(this->spriteVAO);
+		gl::BindBuffer(gl::ARRAY_BUFFER, data->buffer);
+		for (auto &run : data->runs)
+		{
+			if (run.translucent != translucent)
+				continue;
+			BindSpriteState(run.page, run.texture, run.filter, translucent ? DepthMode::Translucent : DepthMode::Opaque, offset);
+			SetSpriteAttribs(run.first * sizeof(BatchedSprite) * (useInstancing ? 1 : 4));
+			DrawSprites(run.count);
+		}
+		gl::BindVertexArray(0);
+		gl::BindBuffer(gl::ARRAY_BUFFER, 0);
+
+		for (auto i : data->unbatched)
+		{
+			auto &sprite = list->sprites[i];
+			if (sprite.translucent == translucent)
+				this->draw(sprite.image, Vec2<float>{sprite.position.x + offset.x, sprite.position.y + offset.y});
+		}
+	}
+	virtual void drawTileVolume(std::shared_ptr<TileVolume> volume, Vec2<float> offset, int maxZ, bool translucent)
+	{
+		SubmitTimer timer(*this);
+		if (!useInstancing || !EnsureDepth())
+		{
+			Renderer::drawTileVolume(volume, offset, maxZ, translucent);
+			return;
+		}
+		GLTileVolume *data = GetTileVolume(*volume);
+		if (!data->complete)
+		{
+			Renderer::drawTileVolume(volume, offset, maxZ, translucent);
+			return;
+		}
+		data->update(*volume);
+		this->flush();
+
+		maxZ = std::min(maxZ, volume->size.z);
+		if (maxZ <= 0)
+			return;
+		BindProgram(tileVolumeProgram);
+		bool flipY = false;
+		if (glState.drawFramebuffer == 0)
+			flipY = true;
+		//The opaque pass takes the fully opaque pixels, the translucent
+		//pass everything else
+		if (translucent)
+		{
+			glState.setDepth(true, false);
+			tileVolumeProgram->setUniforms(volume->size, volume->tileSize, offset, this->currentSurface->size, flipY, 0.0f, 1.0f);
+		}
+		else
+		{
+			glState.setDepth(true, true);
+			tileVolumeProgram->setUniforms(volume->size, volume->tileSize, offset, this->currentSurface->size, flipY, 1.0f, 2.0f);
+		}
+		glState.bindTexture(1, gl::TEXTURE_2D, static_cast<GLPalette*>(this->currentPalette->rendererPrivateData.get())->texID);
+		glState.bindTexture(3, gl::TEXTURE_3D, data->idTexture);
+		glState.bindTexture(4, gl::TEXTURE_2D, data->tableTexture);
+		gl::BindVertexArray(this->tileVolumeVAO);
+		//Tiles on other pages are thrown away by the vertex shader, so each
+		//page is one draw of the whole volume
+		GLsizei count = volume->size.x * volume->size.y * maxZ;
+		for (size_t i = 0; i < data->pages.size(); i++)
+		{
+			glState.bindTexture(0, gl::TEXTURE_2D_ARRAY, data->pages[i]->texID);
+			tileVolumeProgram->setPage(i);
+			gl::DrawArraysInstancedARB(gl::TRIANGLE_STRIP, 0, 4, count);
+			this->stats.drawCalls++;
+			this->stats.batches++;
+			this->stats.batchedSprites += count;
+		}
+		gl::BindVertexArray(0);
+	}
+	virtual bool canDrawTileVolume(std::shared_ptr<TileVolume> volume)
+	{
+		if (!useInstancing || !hasDepthBuffer())
+			return false;
+		return GetTileVolume(*volume)->complete;
+	}
+	virtual bool hasDepthBuffer()
+	{
+		FBOData *fbo = static_cast<FBOData*>(this->currentSurface->rendererPrivateData.get());
+		//Other surfaces get one when first needed
+		return fbo->fbo != 0 || fbo->hasDepth;
+	}
+	virtual void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c)
+	{
+		SubmitTimer timer(*this);
+		BatchSprite(BatchedSprite(position, Vec2<float>{size.x, 0}, Vec2<float>{0, size.y},
+			Vec2<uint16_t>{0,0}, Vec2<uint16_t>{0,0}, c, BatchSource::Colour));
 	};
-	virtual void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c);
 	virtual void drawRect(Vec2<float> position, Vec2<float> size, Colour c, float thickness = 1.0)
 	{
 		this->drawLine(position, Vec2<float>{position.x + size.x, position.y}, c, thickness);
@@ -789,7 +1676,8 @@ public:
 	};
 	virtual void drawLine(Vec2<float> p1, Vec2<float> p2, Colour c, float thickness = 1.0)
 	{
-		//FIXME: Hack - allow axis-aligned lines to be drawn using the drawFilledRect() fn
+		//Axis-aligned lines keep to the right of/below the points, so
+		//they line up with rects drawn at the same coordinates
 		if (p1.x == p2.x)
 		{
 			if (p1.y > p2.y)
@@ -804,7 +1692,13 @@ public:
 		}
 		else
 		{
-			LogError("Unimplemented function {%f,%f},{%f,%f}", p1.x, p1.y, p2.x, p2.y);
+			SubmitTimer timer(*this);
+			//Any other line is a quad centred on it, 'thickness' wide
+			Vec2<float> dir{p2.x - p1.x, p2.y - p1.y};
+			float length = sqrtf(dir.x * dir.x + dir.y * dir.y);
+			Vec2<float> normal{-dir.y / length * thickness, dir.x / length * thickness};
+			BatchSprite(BatchedSprite(Vec2<float>{p1.x - normal.x / 2, p1.y - normal.y / 2}, dir, normal,
+				Vec2<uint16_t>{0,0}, Vec2<uint16_t>{0,0}, c, BatchSource::Colour));
 		}
 	};
 	virtual void flush();
@@ -816,213 +1710,765 @@ public:
 
 	void BindProgram(std::shared_ptr<Program> p)
 	{
-		if (this->currentBoundProgram == p->prog)
-			return;
-		gl::UseProgram(p->prog);
-		this->currentBoundProgram = p->prog;
+		glState.useProgram(p->prog);
 	}
 
 
-	void DrawRGB(GLRGBImage &img, Vec2<float> offset, Vec2<float> size, Scaler scaler)
-	{
-		GLenum filter;
-		switch (scaler)
-		{
-			case Scaler::Linear:
-				filter = gl::LINEAR;
-				break;
-			case Scaler::Nearest:
-				filter = gl::NEAREST;
-				break;
-			default:
-				LogError("Unknown scaler requested");
-				filter = gl::NEAREST;
-				break;
-		}
-		BindProgram(rgbProgram);
-		bool flipY = false;
-		if (currentBoundFBO == 0)
-			flipY = true;
-		rgbProgram->setUniforms(offset, size, this->currentSurface->size, flipY);
-		BindTexture t(img.texID);
-		TexParam<gl::TEXTURE_MAG_FILTER> mag(img.texID, filter);
-		TexParam<gl::TEXTURE_MIN_FILTER> min(img.texID, filter);
-		IdentityQuad::draw(rgbProgram->posLoc);
-	}
-
 	void DrawPalette(GLPaletteImage &img, Vec2<float> offset, Vec2<float> size)
 	{
 		BindProgram(paletteProgram);
 		bool flipY = false;
-		if (currentBoundFBO == 0)
+		if (glState.drawFramebuffer == 0)
 			flipY = true;
 		paletteProgram->setUniforms(offset, size, this->currentSurface->size, flipY);
-		BindTexture t(img.texID, 0);
-
-		BindTexture p(static_cast<GLPalette*>(this->currentPalette->rendererPrivateData.get())->texID, 1);
+		glState.setDepth(false, false);
+		//Every draw binds what it samples, so there's nothing to restore
+		glState.bindTexture(0, gl::TEXTURE_2D, img.texID);
+		glState.bindTexture(1, gl::TEXTURE_2D, static_cast<GLPalette*>(this->currentPalette->rendererPrivateData.get())->texID);
 
 		IdentityQuad::draw(paletteProgram->posLoc);
+		this->stats.drawCalls++;
 	}
 
-	void DrawSurface(FBOData &fbo, Vec2<float> offset, Vec2<float> size, Scaler scaler)
+	//Where a batched sprite's colour comes from - matches the values
+	//tested in SpriteBatchProgram's fragment shader
+	enum class BatchSource
+	{
+		Colour = 0,
+		Atlas = 1,
+		Texture = 2,
+	};
+
+	//How a batch uses the depth buffer. Opaque sprites drop any pixel
+	//that isn't fully opaque and write depth, translucent ones blend as
+	//usual but only test depth
+	enum class DepthMode
+	{
+		Off,
+		Opaque,
+		Translucent,
+	};
+
+	//One sprite of a batch. With instancing this is per-instance data
+	//expanded to a quad by the vertex shader, otherwise it's repeated for
+	//each of the quad's 4 vertices
+	class BatchedSprite
+	{
+	public:
+		Vec2<float> position;
+		Vec2<float> axisX;
+		Vec2<float> axisY;
+		Vec2<uint16_t> texOffset;
+		Vec2<uint16_t> texSize;
+		Colour colour;
+		int32_t source;
+		float depth;
+		BatchedSprite()
+			{
+			}
+		BatchedSprite(Vec2<float> position, Vec2<float> axisX, Vec2<float> axisY, Vec2<uint16_t> texOffset, Vec2<uint16_t> texSize, Colour colour, BatchSource source, int layer = 0, float depth = 0)
+			: position(position), axisX(axisX), axisY(axisY), texOffset(texOffset), texSize(texSize), colour(colour), source(((int32_t)source << 16) | layer), depth(depth)
+			{
+			}
+	};
+	static_assert(sizeof(BatchedSprite) == 44, "BatchedSprite unexpected size");
+
+	std::vector<BatchedSprite> batchedSprites;
+	//Only used without instancing, for batchedSprites with each sprite
+	//written out 4 times
+	std::vector<BatchedSprite> expandedSprites;
+	unsigned maxBatchedSprites;
+	std::unique_ptr<SpriteAtlas> spriteAtlas;
+	//The atlas page and RGBA texture sampled by the sprites in the current
+	//batch, if any. A batch can use one of each, so solid quads, paletted
+	//sprites and RGB images mix freely until one of those changes
+	std::shared_ptr<SpriteAtlasPage> boundAtlasPage;
+	GLuint boundTexture;
+	GLenum boundTextureFilter;
+	//Keeps the image owning boundTexture alive until the batch is drawn
+	std::shared_ptr<Image> boundTextureImage;
+	//Every sprite in a batch uses the same depth state
+	DepthMode batchDepthMode;
+
+	bool useInstancing;
+	std::unique_ptr<StreamingBuffer> spriteBuffer;
+	GLuint spriteVAO;
+	//Quad corners - 4 for instancing, or 4 per sprite in a batch otherwise
+	GLuint cornerBuffer;
+	//Without instancing, the 2 triangles of each sprite's quad
+	GLuint indexBuffer;
+	//cornerBuffer as tileVolumeProgram's corners
+	GLuint tileVolumeVAO;
+
+	Stats stats;
+	//The draw functions call each other, only the outermost one is timed
+	unsigned submitDepth;
+	std::chrono::steady_clock::time_point submitStart;
+	class SubmitTimer
+	{
+		OGL30Renderer &r;
+	public:
+		SubmitTimer(OGL30Renderer &r)
+			: r(r)
+		{
+			if (r.submitDepth++ == 0)
+				r.submitStart = std::chrono::steady_clock::now();
+		}
+		~SubmitTimer()
+		{
+			if (--r.submitDepth == 0)
+				r.stats.submitTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - r.submitStart).count();
+		}
+	};
+
+	static GLenum GetFilter(Scaler scaler)
 	{
-		GLenum filter;
 		switch (scaler)
 		{
 			case Scaler::Linear:
-				filter = gl::LINEAR;
-				break;
+				return gl::LINEAR;
 			case Scaler::Nearest:
-				filter = gl::NEAREST;
-				break;
+				return gl::NEAREST;
 			default:
 				LogError("Unknown scaler requested");
-				filter = gl::NEAREST;
-				break;
+				return gl::NEAREST;
 		}
-		BindProgram(rgbProgram);
-		bool flipY = false;
-		if (currentBoundFBO == 0)
-			flipY = true;
-		rgbProgram->setUniforms(offset, size, this->currentSurface->size, flipY);
-		BindTexture t(fbo.tex);
-		TexParam<gl::TEXTURE_MAG_FILTER> mag(fbo.tex, filter);
-		TexParam<gl::TEXTURE_MIN_FILTER> min(fbo.tex, filter);
-		IdentityQuad::draw(rgbProgram->posLoc);
 	}
 
-	void DrawRect(Vec2<float> offset, Vec2<float> size, Colour c)
+	//Adds a sprite to the batch, drawing what's already batched first if it
+	//samples a different atlas page or texture, or uses depth differently
+	void BatchSprite(const BatchedSprite &sprite, std::shared_ptr<SpriteAtlasPage> page = nullptr,
+		GLuint texture = 0, GLenum filter = gl::NEAREST, std::shared_ptr<Image> textureImage = nullptr,
+		DepthMode depthMode = DepthMode::Off)
 	{
-		BindProgram(colourProgram);
-		bool flipY = false;
-		if (currentBoundFBO == 0)
-			flipY = true;
-		colourProgram->setUniforms(offset, size, this->currentSurface->size, flipY, c);
-		IdentityQuad::draw(colourProgram->posLoc);
+		if (this->state == RendererState::Batching)
+		{
+			if ((page && this->boundAtlasPage && page != this->boundAtlasPage) ||
+			    (texture && this->boundTexture && (texture != this->boundTexture || filter != this->boundTextureFilter)) ||
+			    depthMode != this->batchDepthMode ||
+			    this->batchedSprites.size() >= this->maxBatchedSprites)
+			{
+				this->flush();
+			}
+		}
+		this->batchDepthMode = depthMode;
+		if (page)
+			this->boundAtlasPage = page;
+		if (texture)
+		{
+			this->boundTexture = texture;
+			this->boundTextureFilter = filter;
+			this->boundTextureImage = textureImage;
+		}
+		this->state = RendererState::Batching;
+		this->batchedSprites.push_back(sprite);
 	}
 
-	class BatchedVertex
+	//A batched sprite showing an image, and what it samples
+	class ImageSprite
 	{
 	public:
-		Vec2<float> position;
-		Vec2<float> texCoord;
-		int spriteIdx;
-		BatchedVertex()
-		{}
-		BatchedVertex(Vec2<float> p, Vec2<float> tc, int i)
-			: position(p), texCoord(tc), spriteIdx(i)
+		BatchedSprite sprite;
+		std::shared_ptr<SpriteAtlasPage> page;
+		GLuint texture;
+		GLenum filter;
+		std::shared_ptr<Image> textureImage;
+		//The image is entirely transparent, so there's nothing to draw
+		bool empty;
+		ImageSprite()
+			: texture(0), filter(gl::NEAREST), empty(false)
 			{
 			}
 	};
-	static_assert(sizeof(BatchedVertex) == 20, "BatchedVertex unexpected size");
 
-	class BatchedSprite
+	//A SpriteList's sprites in a static vertex buffer, split into runs that
+	//can each be drawn with one call. The opaque sprites are grouped by what
+	//they sample, the translucent ones stay in the list's order
+	class GLSpriteList : public RendererImageData
 	{
 	public:
-		std::array<BatchedVertex, 4> vertices;
-		BatchedSprite(Vec2<float> screenPosition, Vec2<float> spriteSize,
-			int spriteIdx)
-		{
-			Vec2<float> maxTexCoords = spriteSize;
-			Vec2<float> maxPosition = screenPosition + spriteSize;
-			vertices[0] = BatchedVertex{
-				screenPosition,
-				Vec2<float>{0,0},
-				spriteIdx
-			};
-			vertices[1] = BatchedVertex{
-				Vec2<float>{screenPosition.x, maxPosition.y},
-				Vec2<float>{0,maxTexCoords.y},
-				spriteIdx
-			};
-			vertices[2] = BatchedVertex{
-				Vec2<float>{maxPosition.x, screenPosition.y},
-				Vec2<float>{maxTexCoords.x,0},
-				spriteIdx
-			};
-			vertices[3] = BatchedVertex{
-				maxPosition,
-				maxTexCoords,
-				spriteIdx
+		class Run
+		{
+		public:
+			std::shared_ptr<SpriteAtlasPage> page;
+			GLuint texture;
+			GLenum filter;
+			bool translucent;
+			//In sprites
+			unsigned first;
+			unsigned count;
+		};
+		GLuint buffer;
+		std::vector<Run> runs;
+		//Sprites that can't be batched, drawn one by one without depth
+		std::vector<size_t> unbatched;
+		//Keeps the atlas space and textures the runs sample from being
+		//reused
+		std::vector<std::shared_ptr<ImageSet>> sets;
+		std::vector<std::shared_ptr<Image>> textureImages;
+
+		GLSpriteList(OGL30Renderer &r, const SpriteList &list)
+		{
+			class Entry
+			{
+			public:
+				ImageSprite sprite;
+				bool translucent;
+				size_t index;
 			};
+			std::vector<Entry> entries;
+			for (size_t i = 0; i < list.sprites.size(); i++)
+			{
+				auto &listSprite = list.sprites[i];
+				Entry e;
+				e.translucent = listSprite.translucent;
+				e.index = i;
+				if (!r.GetImageSprite(listSprite.image, listSprite.position, Vec2<float>{(float)listSprite.image->size.x, 0},
+						Vec2<float>{0, (float)listSprite.image->size.y}, Scaler::Nearest, Colour{255,255,255}, listSprite.depth, e.sprite))
+				{
+					unbatched.push_back(i);
+					continue;
+				}
+				if (e.sprite.empty)
+					continue;
+				auto set = listSprite.image->owningSet.lock();
+				if (e.sprite.page && std::find(sets.begin(), sets.end(), set) == sets.end())
+					sets.push_back(set);
+				if (e.sprite.textureImage)
+					textureImages.push_back(e.sprite.textureImage);
+				entries.push_back(e);
+			}
+			if (!unbatched.empty())
+				LogWarning("%u sprites in the list can't be batched, drawing them without depth", (unsigned)unbatched.size());
+
+			//Opaque sprites first, grouped by what they sample
+			std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+			{
+				if (a.translucent != b.translucent)
+					return !a.translucent;
+				if (a.translucent)
+					return false;
+				if (a.sprite.page != b.sprite.page)
+					return a.sprite.page < b.sprite.page;
+				if (a.sprite.texture != b.sprite.texture)
+					return a.sprite.texture < b.sprite.texture;
+				return a.sprite.filter < b.sprite.filter;
+			});
+
+			std::vector<BatchedSprite> vertices;
+			for (auto &e : entries)
+			{
+				//The same rules as BatchSprite() - a run may use one atlas
+				//page and one texture
+				Run *run = runs.empty() ? nullptr : &runs.back();
+				if (!run || run->translucent != e.translucent || run->count >= r.maxBatchedSprites ||
+				    (e.sprite.page && run->page && e.sprite.page != run->page) ||
+				    (e.sprite.texture && run->texture && (e.sprite.texture != run->texture || e.sprite.filter != run->filter)))
+				{
+					runs.push_back(Run{nullptr, 0, gl::NEAREST, e.translucent, (unsigned)(vertices.size() / (r.useInstancing ? 1 : 4)), 0});
+					run = &runs.back();
+				}
+				if (e.sprite.page)
+					run->page = e.sprite.page;
+				if (e.sprite.texture)
+				{
+					run->texture = e.sprite.texture;
+					run->filter = e.sprite.filter;
+				}
+				run->count++;
+				vertices.insert(vertices.end(), r.useInstancing ? 1 : 4, e.sprite.sprite);
+			}
+
+			gl::GenBuffers(1, &buffer);
+			gl::BindBuffer(gl::ARRAY_BUFFER, buffer);
+			gl::BufferData(gl::ARRAY_BUFFER, vertices.size() * sizeof(BatchedSprite), vertices.data(), gl::STATIC_DRAW);
+			gl::BindBuffer(gl::ARRAY_BUFFER, 0);
+		}
+		virtual ~GLSpriteList()
+		{
+			gl::DeleteBuffers(1, &buffer);
 		}
 	};
-	static_assert(sizeof(BatchedSprite) == sizeof(BatchedVertex) * 4, "BatchedSprite unexpected size");
 
-	std::vector<BatchedSprite> batchedSprites;
-	unsigned maxBatchedSprites;
-	unsigned maxSpritesheetSize;
-	std::shared_ptr<GLPaletteSpritesheet> boundSpritesheet;
+	//A TileVolume's IDs in a 3D texture, and where each of its tile set's
+	//images is in the atlas, as TileVolumeProgram reads them
+	class GLTileVolume : public RendererImageData
+	{
+	public:
+		GLuint idTexture;
+		GLuint tableTexture;
+		//The atlas pages the tiles are on, in the order the table numbers
+		//them
+		std::vector<std::shared_ptr<SpriteAtlasPage>> pages;
+		//False if any image of the set isn't in the atlas, so the volume
+		//has to be drawn some other way
+		bool complete;
+		//Keeps the atlas space the table points at from being reused
+		std::shared_ptr<ImageSet> set;
+
+		GLTileVolume(OGL30Renderer &r, const TileVolume &volume)
+			: complete(true), set(volume.tiles)
+		{
+			GLAtlasSpriteSet *spriteSet = r.GetAtlasSpriteSet(set);
+			pages = spriteSet->pages;
+			int rows = ((int)set->images.size() + 255) / 256;
+			std::vector<int16_t> table(256 * rows * 2 * 4, 0);
+			for (size_t i = 0; i < set->images.size(); i++)
+			{
+				if (i >= spriteSet->sprites.size() || !spriteSet->sprites[i].page)
+				{
+					complete = false;
+					continue;
+				}
+				auto &sprite = spriteSet->sprites[i];
+				int16_t *entry = &table[((i / 256) * 2 * 256 + i % 256) * 4];
+				int16_t *place = entry + 256 * 4;
+				Vec2<int> size = sprite.bounds.size();
+				entry[0] = sprite.offset.x;
+				entry[1] = sprite.offset.y;
+				entry[2] = size.x;
+				entry[3] = size.y;
+				place[0] = sprite.bounds.p0.x;
+				place[1] = sprite.bounds.p0.y;
+				place[2] = sprite.layer;
+				place[3] = std::find(pages.begin(), pages.end(), sprite.page) - pages.begin();
+			}
+			if (!complete)
+				LogWarning("Tile set not entirely in the sprite atlas, drawing the tile volume sprite by sprite");
 
-	std::unique_ptr<GLint[]> firstList;
-	std::unique_ptr<GLsizei[]> countList;
+			UnpackAlignment align(2);
+			gl::GenTextures(1, &this->tableTexture);
+			{
+				BindTexture b(this->tableTexture);
+				glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+				glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+				gl::TexImage2D(gl::TEXTURE_2D, 0, gl::RGBA16I, 256, rows * 2, 0, gl::RGBA_INTEGER, gl::SHORT, table.data());
+			}
+			gl::GenTextures(1, &this->idTexture);
+			BindTexture b(this->idTexture, 0, gl::TEXTURE_3D);
+			glState.texParameter(gl::TEXTURE_3D, gl::TEXTURE_MIN_FILTER, gl::NEAREST);
+			glState.texParameter(gl::TEXTURE_3D, gl::TEXTURE_MAG_FILTER, gl::NEAREST);
+			gl::TexImage3D(gl::TEXTURE_3D, 0, gl::R16UI, volume.size.x, volume.size.y, volume.size.z, 0,
+				gl::RED_INTEGER, gl::UNSIGNED_SHORT, volume.ids.data());
+		}
+		//Uploads the IDs again if they've changed
+		void update(TileVolume &volume)
+		{
+			if (!volume.dirty)
+				return;
+			UnpackAlignment align(2);
+			BindTexture b(this->idTexture, 0, gl::TEXTURE_3D);
+			gl::TexSubImage3D(gl::TEXTURE_3D, 0, 0, 0, 0, volume.size.x, volume.size.y, volume.size.z,
+				gl::RED_INTEGER, gl::UNSIGNED_SHORT, volume.ids.data());
+			volume.dirty = false;
+		}
+		virtual ~GLTileVolume()
+		{
+			glState.deleteTexture(this->idTexture);
+			glState.deleteTexture(this->tableTexture);
+		}
+	};
+
+	GLTileVolume *GetTileVolume(TileVolume &volume)
+	{
+		GLTileVolume *data = dynamic_cast<GLTileVolume*>(volume.rendererPrivateData.get());
+		if (!data)
+		{
+			data = new GLTileVolume(*this, volume);
+			volume.rendererPrivateData.reset(data);
+		}
+		return data;
+	}
+
+	GLAtlasSpriteSet *GetAtlasSpriteSet(std::shared_ptr<ImageSet> set)
+	{
+		GLAtlasSpriteSet *spriteSet = dynamic_cast<GLAtlasSpriteSet*>(set->rendererPrivateData.get());
+		if (!spriteSet)
+		{
+			spriteSet = new GLAtlasSpriteSet(*this->spriteAtlas, set);
+			set->rendererPrivateData.reset(spriteSet);
+		}
+		return spriteSet;
+	}
+
+	//Sets up 'out' to draw 'image' as the quad at 'position' with edges
+	//'axisX' and 'axisY', its colour multiplied by 'tint'. Returns false if
+	//the image can't be batched - a paletted image outside any ImageSet, or
+	//one added to its set after the set was packed
+	bool GetImageSprite(std::shared_ptr<Image> image, Vec2<float> position, Vec2<float> axisX, Vec2<float> axisY, Scaler scaler, Colour tint,
+		float depth, ImageSprite &out)
+	{
+		std::shared_ptr<ImageSet> owningSet = image->owningSet.lock();
+		if (owningSet)
+		{
+			GLAtlasSpriteSet *spriteSet = GetAtlasSpriteSet(owningSet);
+			if (image->indexInSet < spriteSet->sprites.size() &&
+			    spriteSet->sprites[image->indexInSet].page)
+			{
+				auto &sprite = spriteSet->sprites[image->indexInSet];
+				Vec2<int> trimSize = sprite.bounds.size();
+				if (trimSize.x == 0)
+				{
+					out.empty = true;
+					return true;
+				}
+				//Shrink the quad to the stored part of the image
+				Vec2<float> trimStart{(float)sprite.bounds.p0.x / image->size.x, (float)sprite.bounds.p0.y / image->size.y};
+				Vec2<float> trimScale{(float)trimSize.x / image->size.x, (float)trimSize.y / image->size.y};
+				Vec2<float> trimPosition{position.x + axisX.x * trimStart.x + axisY.x * trimStart.y,
+					position.y + axisX.y * trimStart.x + axisY.y * trimStart.y};
+				out.sprite = BatchedSprite(trimPosition,
+					Vec2<float>{axisX.x * trimScale.x, axisX.y * trimScale.x},
+					Vec2<float>{axisY.x * trimScale.y, axisY.y * trimScale.y},
+					Vec2<uint16_t>(sprite.offset.x, sprite.offset.y), Vec2<uint16_t>(trimSize.x, trimSize.y),
+					tint, BatchSource::Atlas, sprite.layer, depth);
+				out.page = sprite.page;
+				return true;
+			}
+		}
+
+		std::shared_ptr<RGBImage> rgbImage = std::dynamic_pointer_cast<RGBImage>(image);
+		if (rgbImage)
+		{
+			GLRGBImage *img = dynamic_cast<GLRGBImage*>(rgbImage->rendererPrivateData.get());
+			if (!img)
+			{
+				img = new GLRGBImage(rgbImage);
+				image->rendererPrivateData.reset(img);
+			}
+			out.sprite = BatchedSprite(position, axisX, axisY,
+				Vec2<uint16_t>{0,0}, Vec2<uint16_t>(image->size.x, image->size.y), tint, BatchSource::Texture, 0, depth);
+			out.texture = img->texID;
+			out.filter = GetFilter(scaler);
+			out.textureImage = image;
+			return true;
+		}
+
+		std::shared_ptr<Surface> surface = std::dynamic_pointer_cast<Surface>(image);
+		if (surface)
+		{
+			FBOData *fbo = dynamic_cast<FBOData*>(surface->rendererPrivateData.get());
+			if (!fbo)
+			{
+				fbo = surfacePool->allocate(image->size);
+				image->rendererPrivateData.reset(fbo);
+			}
+			FBOData *target = static_cast<FBOData*>(this->currentSurface->rendererPrivateData.get());
+			if (fbo->page && fbo->page == target->page && surface != this->currentSurface)
+				fbo = MoveSurface(surface);
+			out.sprite = BatchedSprite(position, axisX, axisY,
+				Vec2<uint16_t>(fbo->offset.x, fbo->offset.y), Vec2<uint16_t>(fbo->size.x, fbo->size.y),
+				tint, BatchSource::Texture, 0, depth);
+			out.texture = fbo->tex;
+			out.filter = GetFilter(scaler);
+			out.textureImage = image;
+			return true;
+		}
+		return false;
+	}
 
-	void DrawBatchedSpritesheet()
+	//Sampling a texture that's attached to the framebuffer being drawn to
+	//is undefined, even in another part of it. A surface drawn into one on
+	//the same page (as a control into its parent) is moved to another
+	//page, contents and all. It stays there, so this happens once per pair
+	FBOData *MoveSurface(std::shared_ptr<Surface> surface)
 	{
-		BindProgram(paletteSetProgram);
+		FBOData *fbo = static_cast<FBOData*>(surface->rendererPrivateData.get());
+		this->flush();
+		FBOData *moved = surfacePool->allocate(surface->size, fbo->page);
+		{
+			BindFramebuffer f(moved->fbo);
+			gl::BindFramebuffer(gl::READ_FRAMEBUFFER, fbo->fbo);
+			//The scissor rect is the current surface's
+			gl::Disable(gl::SCISSOR_TEST);
+			gl::BlitFramebuffer(fbo->offset.x, fbo->offset.y, fbo->offset.x + surface->size.x, fbo->offset.y + surface->size.y,
+				moved->offset.x, moved->offset.y, moved->offset.x + surface->size.x, moved->offset.y + surface->size.y,
+				gl::COLOR_BUFFER_BIT, gl::NEAREST);
+			gl::Enable(gl::SCISSOR_TEST);
+			gl::BindFramebuffer(gl::READ_FRAMEBUFFER, 0);
+		}
+		//Releases the old slot
+		surface->rendererPrivateData.reset(moved);
+		return moved;
+	}
+
+	//Batches 'image' as GetImageSprite() describes. Returns false if the
+	//image can't be batched
+	bool BatchImage(std::shared_ptr<Image> image, Vec2<float> position, Vec2<float> axisX, Vec2<float> axisY, Scaler scaler, Colour tint,
+		DepthMode depthMode = DepthMode::Off, float depth = 0)
+	{
+		ImageSprite sprite;
+		if (!GetImageSprite(image, position, axisX, axisY, scaler, tint, depth, sprite))
+			return false;
+		if (!sprite.empty)
+			BatchSprite(sprite.sprite, sprite.page, sprite.texture, sprite.filter, sprite.textureImage, depthMode);
+		return true;
+	}
+
+	void CreateSpriteBuffers()
+	{
+		useInstancing = gl::exts::var_ARB_draw_instanced && gl::exts::var_ARB_instanced_arrays;
+		LogInfo("Sprite batches %s instancing", useInstancing ? "using" : "not using");
+
+		//In triangle strip order
+		static const uint8_t quadCorners[] = {0,0, 0,1, 1,0, 1,1};
+		unsigned quads = useInstancing ? 1 : this->maxBatchedSprites;
+		std::vector<uint8_t> corners;
+		std::vector<GLuint> indices;
+		for (unsigned i = 0; i < quads; i++)
+		{
+			corners.insert(corners.end(), std::begin(quadCorners), std::end(quadCorners));
+			GLuint base = i * 4;
+			for (GLuint idx : {base, base + 1, base + 2, base + 2, base + 1, base + 3})
+				indices.push_back(idx);
+		}
+
+		size_t batchBytes = this->maxBatchedSprites * sizeof(BatchedSprite) * (useInstancing ? 1 : 4);
+		this->spriteBuffer.reset(new StreamingBuffer(batchBytes * 4));
+
+		gl::GenVertexArrays(1, &this->spriteVAO);
+		gl::BindVertexArray(this->spriteVAO);
+
+		gl::GenBuffers(1, &this->cornerBuffer);
+		gl::BindBuffer(gl::ARRAY_BUFFER, this->cornerBuffer);
+		gl::BufferData(gl::ARRAY_BUFFER, corners.size(), corners.data(), gl::STATIC_DRAW);
+		gl::EnableVertexAttribArray(spriteBatchProgram->cornerLoc);
+		gl::VertexAttribPointer(spriteBatchProgram->cornerLoc, 2, gl::UNSIGNED_BYTE, gl::FALSE_, 0, 0);
+
+		this->indexBuffer = 0;
+		if (!useInstancing)
+		{
+			gl::GenBuffers(1, &this->indexBuffer);
+			gl::BindBuffer(gl::ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+			gl::BufferData(gl::ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), gl::STATIC_DRAW);
+		}
+
+		for (GLuint loc : {spriteBatchProgram->posLoc, spriteBatchProgram->axisXLoc, spriteBatchProgram->axisYLoc,
+		                   spriteBatchProgram->texOffsetLoc, spriteBatchProgram->texSizeLoc,
+		                   spriteBatchProgram->colourLoc, spriteBatchProgram->sourceLoc, spriteBatchProgram->depthLoc})
+		{
+			gl::EnableVertexAttribArray(loc);
+			if (useInstancing)
+				gl::VertexAttribDivisorARB(loc, 1);
+		}
+
+		this->tileVolumeVAO = 0;
+		if (useInstancing)
+		{
+			tileVolumeProgram.reset(new TileVolumeProgram());
+			gl::GenVertexArrays(1, &this->tileVolumeVAO);
+			gl::BindVertexArray(this->tileVolumeVAO);
+			gl::BindBuffer(gl::ARRAY_BUFFER, this->cornerBuffer);
+			gl::EnableVertexAttribArray(tileVolumeProgram->cornerLoc);
+			gl::VertexAttribPointer(tileVolumeProgram->cornerLoc, 2, gl::UNSIGNED_BYTE, gl::FALSE_, 0, 0);
+		}
+
+		//Leave the default VAO bound for the client-side arrays used by
+		//IdentityQuad
+		gl::BindVertexArray(0);
+		gl::BindBuffer(gl::ARRAY_BUFFER, 0);
+	}
+
+	//Sets up the program, textures and depth state for drawing sprites that
+	//sample 'page' and 'texture' (either may be unused), moved by 'offset'
+	void BindSpriteState(std::shared_ptr<SpriteAtlasPage> page, GLuint texture, GLenum filter, DepthMode depthMode, Vec2<float> offset)
+	{
+		BindProgram(spriteBatchProgram);
 		bool flipY = false;
-		if (currentBoundFBO == 0)
+		if (glState.drawFramebuffer == 0)
 			flipY = true;
-		paletteSetProgram->setUniforms(this->currentSurface->size, flipY);
-		BindTexture t(this->boundSpritesheet->texID, 0, gl::TEXTURE_2D_ARRAY);
-		BindTexture p(static_cast<GLPalette*>(this->currentPalette->rendererPrivateData.get())->texID, 1);
+		switch (depthMode)
+		{
+			case DepthMode::Off:
+				glState.setDepth(false, false);
+				spriteBatchProgram->setUniforms(this->currentSurface->size, flipY, 0.0f, offset);
+				break;
+			case DepthMode::Opaque:
+				glState.setDepth(true, true);
+				spriteBatchProgram->setUniforms(this->currentSurface->size, flipY, 1.0f, offset);
+				break;
+			case DepthMode::Translucent:
+				glState.setDepth(true, false);
+				spriteBatchProgram->setUniforms(this->currentSurface->size, flipY, 0.0f, offset);
+				break;
+		}
+		//Every draw binds what it samples, so there's nothing to restore
+		if (page)
+		{
+			glState.bindTexture(0, gl::TEXTURE_2D_ARRAY, page->texID);
+			glState.bindTexture(1, gl::TEXTURE_2D, static_cast<GLPalette*>(this->currentPalette->rendererPrivateData.get())->texID);
+		}
+		if (texture)
+		{
+			glState.bindTexture(2, gl::TEXTURE_2D, texture);
+			glState.setActiveUnit(gl::TEXTURE2);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MAG_FILTER, filter);
+			glState.texParameter(gl::TEXTURE_2D, gl::TEXTURE_MIN_FILTER, filter);
+		}
+	}
+
+	//Points the sprite attributes at the BatchedSprites 'offset' bytes into
+	//the buffer bound to ARRAY_BUFFER. spriteVAO must be bound
+	void SetSpriteAttribs(size_t offset)
+	{
+		gl::VertexAttribPointer(spriteBatchProgram->posLoc, 2, gl::FLOAT, gl::FALSE_, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, position)));
+		gl::VertexAttribPointer(spriteBatchProgram->axisXLoc, 2, gl::FLOAT, gl::FALSE_, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, axisX)));
+		gl::VertexAttribPointer(spriteBatchProgram->axisYLoc, 2, gl::FLOAT, gl::FALSE_, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, axisY)));
+		gl::VertexAttribPointer(spriteBatchProgram->texOffsetLoc, 2, gl::UNSIGNED_SHORT, gl::FALSE_, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, texOffset)));
+		gl::VertexAttribPointer(spriteBatchProgram->texSizeLoc, 2, gl::UNSIGNED_SHORT, gl::FALSE_, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, texSize)));
+		gl::VertexAttribPointer(spriteBatchProgram->colourLoc, 4, gl::UNSIGNED_BYTE, gl::TRUE_, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, colour)));
+		gl::VertexAttribIPointer(spriteBatchProgram->sourceLoc, 1, gl::INT, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, source)));
+		gl::VertexAttribPointer(spriteBatchProgram->depthLoc, 1, gl::FLOAT, gl::FALSE_, sizeof(BatchedSprite), (const GLvoid*)(offset + offsetof(BatchedSprite, depth)));
+	}
+
+	//Draws 'count' sprites (at most maxBatchedSprites) from the attributes
+	//SetSpriteAttribs() set
+	void DrawSprites(GLsizei count)
+	{
+		assert((unsigned)count <= this->maxBatchedSprites);
+		if (useInstancing)
+			gl::DrawArraysInstancedARB(gl::TRIANGLE_STRIP, 0, 4, count);
+		else
+			gl::DrawElements(gl::TRIANGLES, count * 6, gl::UNSIGNED_INT, 0);
+
+		this->stats.drawCalls++;
+		this->stats.batches++;
+		this->stats.batchedSprites += count;
+	}
 
-		gl::EnableVertexAttribArray(paletteSetProgram->posLoc);
-		gl::EnableVertexAttribArray(paletteSetProgram->texcoordLoc);
-		gl::EnableVertexAttribArray(paletteSetProgram->spriteLoc);
+	void DrawBatchedSprites()
+	{
+		BindSpriteState(this->boundAtlasPage, this->boundTexture, this->boundTextureFilter, this->batchDepthMode, Vec2<float>{0, 0});
 
-		const char* vertexPtr = (const char*)this->batchedSprites.data();
+		gl::BindVertexArray(this->spriteVAO);
+		gl::BindBuffer(gl::ARRAY_BUFFER, this->spriteBuffer->buffer);
 
-		gl::VertexAttribPointer(paletteSetProgram->posLoc, 2, gl::FLOAT, gl::FALSE_, sizeof(BatchedVertex), vertexPtr + offsetof(BatchedVertex, position));
-		gl::VertexAttribPointer(paletteSetProgram->texcoordLoc, 2, gl::FLOAT, gl::FALSE_, sizeof(BatchedVertex), vertexPtr + offsetof(BatchedVertex, texCoord));
-		gl::VertexAttribIPointer(paletteSetProgram->spriteLoc, 1, gl::INT, sizeof(BatchedVertex), vertexPtr + offsetof(BatchedVertex, spriteIdx));
+		GLsizei count = this->batchedSprites.size();
+		const std::vector<BatchedSprite> *upload = &this->batchedSprites;
+		if (!useInstancing)
+		{
+			this->expandedSprites.clear();
+			for (auto &sprite : this->batchedSprites)
+				this->expandedSprites.insert(this->expandedSprites.end(), 4, sprite);
+			upload = &this->expandedSprites;
+		}
+		size_t offset = this->spriteBuffer->upload(upload->data(), upload->size() * sizeof(BatchedSprite));
+		SetSpriteAttribs(offset);
+		DrawSprites(count);
 
-		gl::MultiDrawArrays(gl::TRIANGLE_STRIP, this->firstList.get(), this->countList.get(), this->batchedSprites.size());
+		gl::BindVertexArray(0);
+		gl::BindBuffer(gl::ARRAY_BUFFER, 0);
 
 		this->batchedSprites.clear();
+		this->boundAtlasPage = nullptr;
+		this->boundTexture = 0;
+		this->boundTextureImage = nullptr;
+		this->batchDepthMode = DepthMode::Off;
 		this->state = RendererState::Idle;
 
 	}
 
+	//Makes sure the current surface has a depth buffer, clearing it if it's
+	//new to the surface. Returns false if there isn't one to be had
+	bool EnsureDepth()
+	{
+		FBOData *fbo = static_cast<FBOData*>(this->currentSurface->rendererPrivateData.get());
+		if (fbo->hasDepth)
+			return true;
+		if (fbo->fbo == 0)
+			return false;
+		if (fbo->page)
+		{
+			if (!fbo->page->depth)
+				fbo->page->depth = CreateDepthBuffer(fbo->fbo, fbo->page->pageSize);
+		}
+		else
+			fbo->depth = CreateDepthBuffer(fbo->fbo, fbo->texSize);
+		fbo->hasDepth = true;
+		//A slot's part of a page's buffer may hold whatever a previous
+		//surface left there. The scissor rect limits this to the surface
+		this->flush();
+		glState.setDepth(false, true);
+		gl::Clear(gl::DEPTH_BUFFER_BIT);
+		return true;
+	}
+
+	virtual void countAPICalls()
+	{
+		CountGLCalls();
+	}
+
+	virtual Stats getStats()
+	{
+		this->stats.glCalls = glCallCount;
+		this->stats.stateChangesSkipped = glState.skipped;
+		return this->stats;
+	}
+
 };
 
 
 OGL30Renderer::OGL30Renderer()
-	: state(RendererState::Idle), rgbProgram(new RGBProgram()), colourProgram(new SolidColourProgram()), paletteProgram(new PaletteProgram()), paletteSetProgram(new PaletteSetProgram()), currentBoundProgram(0)
+	: state(RendererState::Idle), paletteProgram(new PaletteProgram()), spriteBatchProgram(new SpriteBatchProgram()), boundTexture(0), boundTextureFilter(gl::NEAREST), batchDepthMode(DepthMode::Off), submitDepth(0)
 {
+	//Whatever state the context was created with, the cache starts off
+	//knowing it
+	glState.reset();
 	GLint viewport[4];
 	gl::GetIntegerv(gl::VIEWPORT, viewport);
 	LogInfo("Viewport {%d,%d,%d,%d}", viewport[0], viewport[1], viewport[2], viewport[3]);
 	assert(viewport[0] == 0 && viewport[1] == 0);
 	this->defaultSurface = std::make_shared<Surface>(Vec2<int>{viewport[2], viewport[3]});
-	this->defaultSurface->rendererPrivateData.reset(new FBOData(0));
+	//Allegro is asked for a depth buffer, but may not have got one
+	GLint depthType = 0, depthBits = 0;
+	gl::GetFramebufferAttachmentParameteriv(gl::FRAMEBUFFER, gl::DEPTH, gl::FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &depthType);
+	if (depthType == gl::FRAMEBUFFER_DEFAULT)
+		gl::GetFramebufferAttachmentParameteriv(gl::FRAMEBUFFER, gl::DEPTH, gl::FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depthBits);
+	LogInfo("Default surface depth bits: %d", depthBits);
+	this->defaultSurface->rendererPrivateData.reset(new FBOData(0, depthBits > 0));
 	this->currentSurface = this->defaultSurface;
+	//Surfaces may only be part of their FBO, so clear() is limited to the
+	//current surface by the scissor rect set in setSurface()
+	gl::Enable(gl::SCISSOR_TEST);
+	gl::Scissor(0, 0, viewport[2], viewport[3]);
+
+	GLint maxTexSize;
+	gl::GetIntegerv(gl::MAX_TEXTURE_SIZE, &maxTexSize);
+	LogInfo("MAX_TEXTURE_SIZE: %d", maxTexSize);
+	this->surfacePool.reset(new SurfacePool(std::min(maxTexSize, 2048)));
 
 	GLint maxTexArrayLayers;
 	gl::GetIntegerv(gl::MAX_ARRAY_TEXTURE_LAYERS, &maxTexArrayLayers);
 	LogInfo("MAX_ARRAY_TEXTURE_LAYERS: %d", maxTexArrayLayers);
-	this->maxBatchedSprites = 256;
-	this->maxSpritesheetSize = maxTexArrayLayers;
-
-	this->firstList.reset(new GLint[this->maxBatchedSprites]);
-	this->countList.reset(new GLsizei[this->maxBatchedSprites]);
-
-	for (unsigned int i = 0; i < this->maxBatchedSprites; i++)
-	{
-		this->firstList[i] = 4*i;
-		this->countList[i] = 4;
-	}
+	this->maxBatchedSprites = 16384;
+	//Every ImageSet is packed into these pages, so a batch of paletted
+	//sprites only breaks when it moves to a sprite on a different page
+	this->spriteAtlas.reset(new SpriteAtlas(std::min(maxTexSize, 1024), std::min(maxTexArrayLayers, 16)));
+	this->batchedSprites.reserve(this->maxBatchedSprites);
+	CreateSpriteBuffers();
+
+	this->stats.drawCalls = 0;
+	this->stats.batchedSprites = 0;
+	this->stats.batches = 0;
+	this->stats.submitTimeUs = 0;
+	this->stats.glCalls = 0;
+	this->stats.stateChangesSkipped = 0;
 
 	GLint maxTexUnits;
 	gl::GetIntegerv(gl::MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTexUnits);
 	LogInfo("MAX_COMBINED_TEXTURE_IMAGE_UNITS: %d", maxTexUnits);
-	gl::Enable(gl::BLEND);
-	gl::BlendFunc(gl::SRC_ALPHA, gl::ONE_MINUS_SRC_ALPHA);
+	glState.setBlend(true, gl::SRC_ALPHA, gl::ONE_MINUS_SRC_ALPHA);
 }
 
 OGL30Renderer::~OGL30Renderer()
 {
-
+	gl::DeleteVertexArrays(1, &this->spriteVAO);
+	if (this->tileVolumeVAO)
+		gl::DeleteVertexArrays(1, &this->tileVolumeVAO);
+	gl::DeleteBuffers(1, &this->cornerBuffer);
+	if (this->indexBuffer)
+		gl::DeleteBuffers(1, &this->indexBuffer);
 }
 
 void
@@ -1030,70 +2476,26 @@ OGL30Renderer::clear(Colour c)
 {
 	this->flush();
 	gl::ClearColor(c.r/255.0f, c.g/255.0f, c.b/255.0f, c.a/255.0f);
-	gl::Clear(gl::COLOR_BUFFER_BIT);
-}
-
-void OGL30Renderer::draw(std::shared_ptr<Image> image, Vec2<float> position)
-{
-	std::shared_ptr<ImageSet> owningSet = image->owningSet.lock();
-	if (owningSet)
+	FBOData *fbo = static_cast<FBOData*>(this->currentSurface->rendererPrivateData.get());
+	if (fbo->hasDepth)
 	{
-		if (owningSet->images.size() > maxSpritesheetSize)
-		{
-			static bool warnonce = false;
-			if (!warnonce)
-			{
-				warnonce = true;
-				LogError("Spritesheet size %d would be over max array size %d - falling back to 'slow' path", owningSet->images.size(), maxSpritesheetSize);
-			}
-		}
-		else
-		{
-			std::shared_ptr<GLPaletteSpritesheet> ss = std::dynamic_pointer_cast<GLPaletteSpritesheet>(owningSet->rendererPrivateData);
-			if (!ss)
-			{
-				ss = std::make_shared<GLPaletteSpritesheet>(owningSet);
-				owningSet->rendererPrivateData = ss;
-			}
-			switch (this->state)
-			{
-				default:
-					this->flush();
-				case RendererState::BatchingSpritesheet:
-					if (ss != this->boundSpritesheet ||
-					    this->batchedSprites.size() >= this->maxBatchedSprites)
-					{
-						this->flush();
-					}
-				case RendererState::Idle:
-					break;
-			}
-			this->boundSpritesheet = ss;
-			this->state = RendererState::BatchingSpritesheet;
-			this->batchedSprites.emplace_back(
-					position, Vec2<float>(image->size.x, image->size.y),
-					image->indexInSet
-				);
-			return;
-		}
+		glState.setDepth(false, true);
+		gl::Clear(gl::COLOR_BUFFER_BIT | gl::DEPTH_BUFFER_BIT);
 	}
-	drawScaled(image, position, image->size, Scaler::Nearest);
-}
-void OGL30Renderer::drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c)
-{
-	this->flush();
-	DrawRect(position, size, c);
+	else
+		gl::Clear(gl::COLOR_BUFFER_BIT);
 }
 
 void
 OGL30Renderer::flush()
 {
+	SubmitTimer timer(*this);
 	switch (this->state)
 	{
 		case RendererState::Idle:
 			break;
-		case RendererState::BatchingSpritesheet:
-			this->DrawBatchedSpritesheet();
+		case RendererState::Batching:
+			this->DrawBatchedSprites();
 			break;
 	}
 	this->state = RendererState::Idle;
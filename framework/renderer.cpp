@@ -1,4 +1,8 @@
 #include "framework/renderer.h"
+#include "framework/spritelist.h"
+#include "framework/tilevolume.h"
+#include "framework/image.h"
+#include "game/tileview/tilerange.h"
 
 namespace OpenApoc {
 
@@ -17,6 +21,95 @@ Renderer::~Renderer()
 {
 }
 
+void
+Renderer::drawDepth(std::shared_ptr<Image> i, Vec2<float> position, float depth, bool translucent)
+{
+	std::ignore = depth;
+	std::ignore = translucent;
+	this->draw(i, position);
+}
+
+void
+Renderer::countAPICalls()
+{
+}
+
+bool
+Renderer::hasDepthBuffer()
+{
+	return false;
+}
+
+void
+Renderer::drawSpriteList(std::shared_ptr<SpriteList> list, Vec2<float> offset, bool translucent)
+{
+	for (auto &sprite : list->sprites)
+	{
+		if (sprite.translucent == translucent)
+			this->drawDepth(sprite.image, Vec2<float>{sprite.position.x + offset.x, sprite.position.y + offset.y},
+				sprite.depth, sprite.translucent);
+	}
+}
+
+void
+Renderer::drawTileVolume(std::shared_ptr<TileVolume> volume, Vec2<float> offset, int maxZ, bool translucent)
+{
+	//Without a depth buffer drawDepth() is a plain draw, so drawing in both
+	//passes would blend the translucent pixels twice. The tiles are walked
+	//in painter's order, so drawing them all in the translucent pass alone
+	//is right
+	if (!translucent && !this->hasDepthBuffer())
+		return;
+	maxZ = std::min(maxZ, volume->size.z);
+	auto surface = this->getSurface();
+	Vec2<int> windowSize{(int)surface->size.x, (int)surface->size.y};
+	for (int z = 0; z < maxZ; z++)
+	{
+		//Only the tiles on screen, with the same margin TileView uses
+		VisibleTileRange range(volume->tileSize, Vec2<int>{volume->size.x, volume->size.y}, windowSize,
+			Vec2<int>{(int)offset.x, (int)offset.y - z * volume->tileSize.z},
+			Vec2<int>{volume->tileSize.x, volume->tileSize.y});
+		if (range.empty())
+			continue;
+		for (int y = range.yMin; y <= range.yMax; y++)
+		{
+			for (int x = range.xMin(y); x <= range.xMax(y); x++)
+			{
+				uint16_t id = volume->get(Vec3<int>{x, y, z});
+				if (id == 0 || id >= volume->tiles->images.size())
+					continue;
+				Vec2<float> position{offset.x + (x - y) * volume->tileSize.x / 2.0f,
+					offset.y + (x + y) * volume->tileSize.y / 2.0f - z * volume->tileSize.z};
+				//With depth, the translucent pass draws the opaque pixels again
+				//at the depth they wrote. Being fully opaque, they blend to the
+				//colour already there
+				this->drawDepth(volume->tiles->images[id], position,
+					TileVolume::tileDepth(volume->size, Vec3<int>{x, y, z}, 1), translucent);
+			}
+		}
+	}
+}
+
+bool
+Renderer::canDrawTileVolume(std::shared_ptr<TileVolume> volume)
+{
+	std::ignore = volume;
+	return false;
+}
+
+Renderer::Stats
+Renderer::getStats()
+{
+	Stats s;
+	s.drawCalls = 0;
+	s.batchedSprites = 0;
+	s.batches = 0;
+	s.submitTimeUs = 0;
+	s.glCalls = 0;
+	s.stateChangesSkipped = 0;
+	return s;
+}
+
 RendererImageData::~RendererImageData()
 {
 }
@@ -2,12 +2,15 @@
 #include "library/vec.h"
 #include "library/colour.h"
 #include <memory>
+#include <cstdint>
 
 namespace OpenApoc {
 
 class Image;
 class Palette;
 class Surface;
+class SpriteList;
+class TileVolume;
 
 class RendererImageData
 {
@@ -38,9 +41,54 @@ class Renderer
 		virtual void drawFilledRect(Vec2<float> position, Vec2<float> size, Colour c) = 0;
 		virtual void drawRect(Vec2<float> position, Vec2<float> size, Colour c, float thickness = 1.0) = 0;
 		virtual void drawLine(Vec2<float> p1, Vec2<float> p2, Colour c, float thickness = 1.0) = 0;
+		//Draws with a depth value, 0 nearest and 1 farthest. Opaque draws
+		//drop any pixel that isn't fully opaque and write depth, so they may
+		//be issued in any order. Translucent draws only test depth, and must
+		//be issued back to front after the opaque ones. Without a depth
+		//buffer this is a plain draw() and painter's order applies
+		virtual void drawDepth(std::shared_ptr<Image> i, Vec2<float> position, float depth, bool translucent = false);
+		//True if the current surface has a depth buffer for drawDepth()
+		virtual bool hasDepthBuffer();
+		//drawDepth()s either the opaque or the translucent sprites of the
+		//list, moved by 'offset'. The same rules apply - the translucent
+		//sprites of every list drawn go after the opaque ones
+		virtual void drawSpriteList(std::shared_ptr<SpriteList> list, Vec2<float> offset, bool translucent);
+		//Draws the tiles of the volume below level maxZ, with tile {0,0,0}
+		//at 'offset'. The opaque pass draws every fully opaque pixel and
+		//writes depth, the translucent pass blends in the rest back to
+		//front. Without a depth buffer the opaque pass draws nothing and
+		//the translucent pass draws every tile in painter's order
+		virtual void drawTileVolume(std::shared_ptr<TileVolume> volume, Vec2<float> offset, int maxZ, bool translucent);
+		//True if the renderer draws the volume itself. Otherwise
+		//drawTileVolume() falls back on drawing the tiles on screen one by
+		//one, and callers with a quicker way should use that instead
+		virtual bool canDrawTileVolume(std::shared_ptr<TileVolume> volume);
 		virtual void flush() = 0;
 		virtual UString getName() = 0;
 
+		//Running totals since the renderer was created
+		struct Stats
+		{
+			//Draw calls issued to the underlying API
+			uint64_t drawCalls;
+			//Sprites drawn through batches, and the number of batches
+			uint64_t batchedSprites;
+			uint64_t batches;
+			//Time spent in the draw functions (including flushing), in
+			//microseconds
+			uint64_t submitTimeUs;
+			//Calls made to the underlying API (only counted after
+			//countAPICalls()), and state changes skipped because the state
+			//was already set
+			uint64_t glCalls;
+			uint64_t stateChangesSkipped;
+		};
+		//Renderers that don't keep stats return all zeros
+		virtual Stats getStats();
+		//Also count every call made to the underlying API. That puts a
+		//little overhead on each call, so it's only for stats logging
+		virtual void countAPICalls();
+
 		virtual std::shared_ptr<Surface> getDefaultSurface() = 0;
 };
 
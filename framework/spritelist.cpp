@@ -0,0 +1,43 @@
+#include "framework/spritelist.h"
+#include "framework/image.h"
+
+namespace OpenApoc {
+
+SpriteList::SpriteList()
+	: bounds{0, 0, 0, 0}
+{
+}
+
+SpriteList::~SpriteList()
+{
+}
+
+void
+SpriteList::add(std::shared_ptr<Image> image, Vec2<float> position, float depth, bool translucent)
+{
+	Rect<float> spriteBounds{position.x, position.y, position.x + image->size.x, position.y + image->size.y};
+	if (this->sprites.empty())
+		this->bounds = spriteBounds;
+	else
+		this->bounds = Rect<float>{std::min(bounds.p0.x, spriteBounds.p0.x), std::min(bounds.p0.y, spriteBounds.p0.y),
+			std::max(bounds.p1.x, spriteBounds.p1.x), std::max(bounds.p1.y, spriteBounds.p1.y)};
+	this->sprites.push_back(Sprite{image, position, depth, translucent});
+	//Any copy the renderer made is out of date
+	this->rendererPrivateData.reset();
+}
+
+void
+SpriteList::clear()
+{
+	this->sprites.clear();
+	this->bounds = Rect<float>{0, 0, 0, 0};
+	this->rendererPrivateData.reset();
+}
+
+bool
+SpriteList::empty() const
+{
+	return this->sprites.empty();
+}
+
+}; //namespace OpenApoc
@@ -0,0 +1,39 @@
+
+#pragma once
+
+#include "framework/includes.h"
+#include "renderer.h"
+
+namespace OpenApoc {
+
+class Image;
+
+//A list of sprites drawn with depth (see Renderer::drawDepth()) that's
+//expected to be drawn many times unchanged, like the static parts of a map.
+//Renderers may keep a copy of the list on the GPU, built the first time
+//it's drawn, so drawing it again costs a few calls however long it is.
+class SpriteList
+{
+	public:
+		class Sprite
+		{
+			public:
+				std::shared_ptr<Image> image;
+				Vec2<float> position;
+				float depth;
+				bool translucent;
+		};
+		std::vector<Sprite> sprites;
+		//Screen area the sprites cover, relative to the list's position
+		Rect<float> bounds;
+		std::unique_ptr<RendererImageData> rendererPrivateData;
+
+		SpriteList();
+		~SpriteList();
+
+		void add(std::shared_ptr<Image> image, Vec2<float> position, float depth, bool translucent);
+		void clear();
+		bool empty() const;
+};
+
+}; //namespace OpenApoc
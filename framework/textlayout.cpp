@@ -0,0 +1,71 @@
+#include "framework/textlayout.h"
+
+namespace OpenApoc {
+
+std::vector<UString>
+wrapParagraph(const UString &Paragraph, int MaxWidth, std::function<int(UniChar)> GlyphWidth)
+{
+	const UniChar space = UString::u8Char(' ');
+	std::vector<UniChar> chars;
+	std::vector<int> widths;
+	for (UniChar c : Paragraph)
+	{
+		chars.push_back(c);
+		widths.push_back(GlyphWidth(c));
+	}
+	const size_t count = chars.size();
+
+	std::vector<UString> lines;
+	size_t start = 0;
+	while (start < count)
+	{
+		int width = 0;
+		size_t end = start;
+		//Last space that follows a word, so breaking there leaves text on
+		//this line
+		size_t lastBreak = start;
+		while (end < count && width + widths[end] <= MaxWidth)
+		{
+			if (chars[end] == space && end > start && chars[end-1] != space)
+				lastBreak = end;
+			width += widths[end];
+			end++;
+		}
+		if (end == count)
+		{
+			lines.push_back(Paragraph.substr(start));
+			break;
+		}
+
+		size_t lineEnd, next;
+		if (chars[end] == space)
+		{
+			lineEnd = end;
+			next = end;
+		}
+		else if (lastBreak > start)
+		{
+			lineEnd = lastBreak;
+			next = lastBreak;
+		}
+		else
+		{
+			//No space to break at - split the word, but always take at
+			//least one character so we make progress
+			lineEnd = std::max(end, start + 1);
+			next = lineEnd;
+		}
+		while (lineEnd > start && chars[lineEnd-1] == space)
+			lineEnd--;
+		lines.push_back(Paragraph.substr(start, lineEnd - start));
+
+		start = next;
+		while (start < count && chars[start] == space)
+			start++;
+	}
+	if (lines.empty())
+		lines.push_back(UString());
+	return lines;
+}
+
+}; //namespace OpenApoc
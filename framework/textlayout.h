@@ -0,0 +1,16 @@
+#pragma once
+
+#include "library/strings.h"
+#include <functional>
+#include <vector>
+
+namespace OpenApoc {
+
+//Breaks a paragraph (text with no newlines) into lines no wider than
+//MaxWidth, as measured by GlyphWidth. Lines break at spaces, and the spaces
+//at a break are dropped. A word wider than MaxWidth is split between
+//characters. Always returns at least one (possibly empty) line.
+std::vector<UString> wrapParagraph(const UString &Paragraph, int MaxWidth,
+	std::function<int(UniChar)> GlyphWidth);
+
+}; //namespace OpenApoc
@@ -0,0 +1,42 @@
+#include "framework/tilevolume.h"
+#include "framework/image.h"
+
+#include <cassert>
+
+namespace OpenApoc {
+
+TileVolume::TileVolume(Vec3<int> size, Vec3<int> tileSize, std::shared_ptr<ImageSet> tiles)
+	: size(size), tileSize(tileSize), tiles(tiles), ids(size.x * size.y * size.z, 0), dirty(true)
+{
+}
+
+TileVolume::~TileVolume()
+{
+}
+
+uint16_t
+TileVolume::get(Vec3<int> pos) const
+{
+	assert(pos.x >= 0 && pos.x < size.x && pos.y >= 0 && pos.y < size.y && pos.z >= 0 && pos.z < size.z);
+	return this->ids[(pos.z * size.y + pos.y) * size.x + pos.x];
+}
+
+void
+TileVolume::set(Vec3<int> pos, uint16_t id)
+{
+	assert(pos.x >= 0 && pos.x < size.x && pos.y >= 0 && pos.y < size.y && pos.z >= 0 && pos.z < size.z);
+	assert(id < tiles->images.size());
+	this->ids[(pos.z * size.y + pos.y) * size.x + pos.x] = id;
+	this->dirty = true;
+}
+
+float
+TileVolume::tileDepth(Vec3<int> mapSize, Vec3<int> pos, int slot)
+{
+	double total = (double)mapSize.x * mapSize.y * mapSize.z * SlotsPerTile;
+	double index = (((double)pos.z * mapSize.y + pos.y) * mapSize.x + pos.x) * SlotsPerTile
+		+ std::min(slot, SlotsPerTile - 1);
+	return (float)(1.0 - (index + 1) / (total + 1));
+}
+
+}; //namespace OpenApoc
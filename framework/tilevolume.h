@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include "framework/includes.h"
+#include "renderer.h"
+
+namespace OpenApoc {
+
+class ImageSet;
+
+//A 3D grid of tile IDs - the static part of an isometric map - each drawn
+//with that image of 'tiles'. Tile {x,y,z} is drawn at
+//{(x - y) * tileSize.x / 2, (x + y) * tileSize.y / 2 - z * tileSize.z},
+//as TileView places tiles. Renderers may keep the grid on the GPU and place
+//the sprites there, so drawing it costs the CPU next to nothing however
+//large the map is.
+class TileVolume
+{
+	public:
+		//Things drawn in one tile get a depth each. Volume tiles use slot 1
+		static const int SlotsPerTile = 8;
+
+		Vec3<int> size;
+		Vec3<int> tileSize;
+		std::shared_ptr<ImageSet> tiles;
+		//x-major, then y, then z. ID 0 is an empty tile
+		std::vector<uint16_t> ids;
+		//Set by set(), cleared by the renderer once its copy is updated
+		bool dirty;
+		std::unique_ptr<RendererImageData> rendererPrivateData;
+
+		TileVolume(Vec3<int> size, Vec3<int> tileSize, std::shared_ptr<ImageSet> tiles);
+		~TileVolume();
+
+		uint16_t get(Vec3<int> pos) const;
+		void set(Vec3<int> pos, uint16_t id);
+
+		//The depth (see Renderer::drawDepth()) of the 'slot'th thing drawn
+		//in tile 'pos' of a map of 'mapSize', following the order tiles are
+		//painted in - z, then y, then x
+		static float tileDepth(Vec3<int> mapSize, Vec3<int> pos, int slot);
+};
+
+}; //namespace OpenApoc
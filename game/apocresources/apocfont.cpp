@@ -69,6 +69,8 @@ ApocalypseFont::loadFont( Framework &fw, tinyxml2::XMLElement *fontElement)
 	font->name = fontName;
 	font->spacewidth = spacewidth;
 	font->fontheight = height;
+	font->glyphSet = std::make_shared<ImageSet>();
+	font->glyphSet->maxSize = Vec2<unsigned int>{0, 0};
 
 	for (auto *glyphNode = fontElement->FirstChildElement(); glyphNode; glyphNode = glyphNode->NextSiblingElement())
 	{
@@ -115,15 +117,14 @@ ApocalypseFont::loadFont( Framework &fw, tinyxml2::XMLElement *fontElement)
 		auto glyphImage = std::make_shared<PaletteImage>(Vec2<int>(width,height));	
 		{
 			PaletteImageLock imgLock(glyphImage, ImageLockUse::Write);
-
+			uint8_t *indices = static_cast<uint8_t*>(imgLock.getData());
+			file.read((char*)indices, glyphSize);
 
 			for (int y = 0; y < height; y++)
 			{
 				for (int x = 0; x < width; x++)
 				{
-					uint8_t idx;
-					file.read((char*)&idx, 1);
-					imgLock.set(Vec2<int>{x,y}, idx);
+					uint8_t idx = indices[y*width + x];
 					if (idx != 0 && glyphWidth < x)
 						glyphWidth = x;
 				}
@@ -132,12 +133,14 @@ ApocalypseFont::loadFont( Framework &fw, tinyxml2::XMLElement *fontElement)
 		auto trimmedGlyph = std::make_shared<PaletteImage>(Vec2<int>{glyphWidth + 2, height});
 		PaletteImage::blit(glyphImage, Vec2<int>{0,0}, trimmedGlyph);
 		font->fontbitmaps[c] = trimmedGlyph;
+		font->addToGlyphSet(trimmedGlyph);
 	}
 
 	//FIXME: Bit of a hack to handle spaces?
 	auto spaceImage = std::make_shared<PaletteImage>(Vec2<int>{spacewidth,height});
 	//Defaults to transparent (0)
 	font->fontbitmaps[UString::u8Char(' ')] = spaceImage;
+	font->addToGlyphSet(spaceImage);
 
 	return font;
 }
@@ -155,6 +158,16 @@ ApocalypseFont::getGlyph(UniChar codepoint)
 	return fontbitmaps[codepoint];
 }
 
+void
+ApocalypseFont::addToGlyphSet(std::shared_ptr<PaletteImage> glyph)
+{
+	glyph->owningSet = glyphSet;
+	glyph->indexInSet = glyphSet->images.size();
+	glyphSet->images.push_back(glyph);
+	glyphSet->maxSize.x = std::max(glyphSet->maxSize.x, glyph->size.x);
+	glyphSet->maxSize.y = std::max(glyphSet->maxSize.y, glyph->size.y);
+}
+
 ApocalypseFont::~ApocalypseFont()
 {
 }
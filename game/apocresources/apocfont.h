@@ -11,6 +11,7 @@ class Palette;
 class Framework;
 class Image;
 class Renderer;
+class ImageSet;
 
 class ApocalypseFont : public BitmapFont
 {
@@ -18,10 +19,14 @@ class ApocalypseFont : public BitmapFont
 	private:
 		ApocalypseFont(){};
 		std::map<UniChar, std::shared_ptr<PaletteImage> > fontbitmaps;
+		//Every glyph is in this set, so the renderer can batch them from one spritesheet
+		std::shared_ptr<ImageSet> glyphSet;
 		int spacewidth;
 		int fontheight;
 		UString name;
 
+		void addToGlyphSet(std::shared_ptr<PaletteImage> glyph);
+
 	public:
 		static std::shared_ptr<ApocalypseFont> loadFont(Framework &fw, tinyxml2::XMLElement *fontElement);
 		virtual ~ApocalypseFont();
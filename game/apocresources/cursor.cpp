@@ -17,22 +17,18 @@ ApocCursor::ApocCursor( Framework &fw, std::shared_ptr<Palette> pal )
 
 	auto cursorCount = f.size() / 576;
 
-	while( images.size() < cursorCount )
+	auto palSet = std::make_shared<ImageSet>();
+	palSet->maxSize = Vec2<unsigned int>{24,24};
+	while( palSet->images.size() < cursorCount )
 	{
 		auto palImg = std::make_shared<PaletteImage>(Vec2<int>{24,24});
 		PaletteImageLock l(palImg, ImageLockUse::Write);
-		for( int y = 0; y < 24; y++ )
-		{
-			for( int x = 0; x < 24; x++ )
-			{
-				char palidx;
-				f.read(&palidx, 1);
-				l.set(Vec2<int>{x,y}, palidx);
-			}
-		}
-		images.push_back(palImg->toRGBImage(pal));
+		f.read(static_cast<char*>(l.getData()), 24*24);
+		palSet->images.push_back(palImg);
 	}
 
+	images = PaletteImage::toRGBImageSet(palSet, pal)->images;
+
 	CurrentType = ApocCursor::Normal;
 }
 
@@ -3,6 +3,8 @@
 #include "game/city/organisation.h"
 #include "game/city/buildingtile.h"
 #include "framework/framework.h"
+#include "framework/tilevolume.h"
+#include "framework/image.h"
 #include "game/resources/gamecore.h"
 #include <random>
 
@@ -20,6 +22,11 @@ City::City(Framework &fw, UString mapName)
 
 	this->buildings = loadBuildingsFromBld(fw, mapName + ".bld", this->organisations, Building::defaultNames);
 	this->cityTiles = CityTile::loadTilesFromFile(fw);
+	std::shared_ptr<ImageSet> tileSet;
+	if (!this->cityTiles.empty())
+		tileSet = this->cityTiles[0].sprite->owningSet.lock();
+	if (tileSet)
+		this->tileVolume = std::make_shared<TileVolume>(this->size, Vec3<int>{CITY_TILE_X, CITY_TILE_Y, CITY_TILE_Z}, tileSet);
 
 	for (int z = 0; z < this->size.z; z++)
 	{
@@ -55,6 +62,8 @@ City::City(Framework &fw, UString mapName)
 					else
 					{
 						tile.objects.push_back(std::make_shared<BuildingSection>(&tile, this->cityTiles[tileID], Vec3<int>{x,y,z}, bld));
+						if (this->tileVolume)
+							this->tileVolume->set(Vec3<int>{x,y,z}, tileID);
 					}
 				}
 			}
@@ -96,4 +105,10 @@ City::~City()
 
 }
 
+std::shared_ptr<TileVolume>
+City::getTileVolume()
+{
+	return this->tileVolume;
+}
+
 }; //namespace OpenApoc
@@ -25,9 +25,12 @@ class City : public TileMap
 		std::vector<Organisation> organisations;
 		std::vector<CityTile> cityTiles;
 		std::vector<std::shared_ptr<Vehicle>> vehicles;
+		//Every tile's building section, by cityTiles index
+		std::shared_ptr<TileVolume> tileVolume;
 	public:
 		City(Framework &fw, UString mapName);
 		~City();
+		virtual std::shared_ptr<TileVolume> getTileVolume();
 
 };
 
@@ -8,6 +8,15 @@ namespace OpenApoc {
 		: Stage(fw)
 	{
 		menuform = fw.gamecore->GetForm("FORM_DEBUG_MENU");
+
+		handlers.Bind("BUTTON_QUIT", FormEventType::ButtonClick, [this](Event*)
+		{
+			stageCmd.cmd = StageCmd::Command::POP;
+		});
+		handlers.Bind("BUTTON_DUMPPCK", FormEventType::ButtonClick, [this](Event*)
+		{
+			BulkExportPCKs();
+		});
 	}
 
 	DebugMenu::~DebugMenu()
@@ -44,19 +53,7 @@ namespace OpenApoc {
 			}
 		}
 
-		if (e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::ButtonClick)
-		{
-			if (e->Data.Forms.RaisedBy->Name == "BUTTON_QUIT")
-			{
-				stageCmd.cmd = StageCmd::Command::POP;
-				return;
-			}
-			else if (e->Data.Forms.RaisedBy->Name == "BUTTON_DUMPPCK")
-			{
-				BulkExportPCKs();
-				return;
-			}
-		}
+		handlers.Dispatch(e);
 	}
 
 	void DebugMenu::Update(StageCmd * const cmd)
@@ -160,6 +157,7 @@ namespace OpenApoc {
 
 						LogInfo( UString("Saving ") + outputname );
 						bi->saveBitmap( outputname );
+						fw.data->file_written( outputname );
 
 					}
 					else if( PaletteImage* pi = dynamic_cast<PaletteImage*>(curimg.get()) )
@@ -170,6 +168,7 @@ namespace OpenApoc {
 							outputname = UString("Extracted/") + pckname + UString("/") + Strings::FromInteger(idx) + UString(".#") + Strings::FromInteger(palidx) + UString(".PNG");
 							LogInfo( UString("Saving ") + outputname );
 							pi->toRGBImage( PaletteList.at(palidx) )->saveBitmap( outputname );
+							fw.data->file_written( outputname );
 						}
 
 					}
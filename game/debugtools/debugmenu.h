@@ -15,6 +15,7 @@ class DebugMenu : public Stage
 	private:
 		Form* menuform;
 		StageCmd stageCmd;
+		FormEventHandlers handlers;
 
 		void BulkExportPCKs();
 
@@ -11,6 +11,17 @@ DifficultyMenu::DifficultyMenu(Framework &fw)
 {
 	difficultymenuform = fw.gamecore->GetForm("FORM_DIFFICULTYMENU");
 	assert(difficultymenuform);
+
+	const char *buttonNames[] = {"BUTTON_DIFFICULTY1", "BUTTON_DIFFICULTY2", "BUTTON_DIFFICULTY3", "BUTTON_DIFFICULTY4", "BUTTON_DIFFICULTY5"};
+	const char *citymapNames[] = {"CITYMAP1", "CITYMAP2", "CITYMAP3", "CITYMAP4", "CITYMAP5"};
+	for (int i = 0; i < 5; i++)
+	{
+		UString citymapName = citymapNames[i];
+		handlers.Bind( buttonNames[i], FormEventType::ButtonClick, [this, citymapName](Event*)
+		{
+			StartGame(citymapName);
+		});
+	}
 }
 
 DifficultyMenu::~DifficultyMenu()
@@ -47,42 +58,19 @@ void DifficultyMenu::EventOccurred(Event *e)
 		}
 	}
 
-	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::ButtonClick )
+	if( !handlers.Dispatch( e ) && e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::ButtonClick )
 	{
-		UString citymapName;
-		if (e->Data.Forms.RaisedBy->Name.compare("BUTTON_DIFFICULTY1") == 0)
-		{
-			citymapName = "CITYMAP1";
-		}
-		else if (e->Data.Forms.RaisedBy->Name.compare("BUTTON_DIFFICULTY2") == 0)
-		{
-			citymapName = "CITYMAP2";
-		}
-		else if (e->Data.Forms.RaisedBy->Name.compare("BUTTON_DIFFICULTY3") == 0)
-		{
-			citymapName = "CITYMAP3";
-		}
-		else if (e->Data.Forms.RaisedBy->Name.compare("BUTTON_DIFFICULTY4") == 0)
-		{
-			citymapName = "CITYMAP4";
-		}
-		else if (e->Data.Forms.RaisedBy->Name.compare("BUTTON_DIFFICULTY5") == 0)
-		{
-			citymapName = "CITYMAP5";
-		}
-		else
-		{
-			LogWarning("Unknown button pressed: %s", e->Data.Forms.RaisedBy->Name.str().c_str());
-			citymapName = "CITYMAP1";
-			return;
-		}
-		fw.state.city.reset(new City(fw, citymapName));
-		stageCmd.cmd = StageCmd::Command::REPLACE;
-		stageCmd.nextStage = std::make_shared<TileView>(fw, *fw.state.city, Vec3<int>{CITY_TILE_X, CITY_TILE_Y, CITY_TILE_Z});
-		return;
+		LogWarning("Unknown button pressed: %s", e->Data.Forms.RaisedBy->Name.str().c_str());
 	}
 }
 
+void DifficultyMenu::StartGame(UString citymapName)
+{
+	fw.state.city.reset(new City(fw, citymapName));
+	stageCmd.cmd = StageCmd::Command::REPLACE;
+	stageCmd.nextStage = std::make_shared<TileView>(fw, *fw.state.city, Vec3<int>{CITY_TILE_X, CITY_TILE_Y, CITY_TILE_Z});
+}
+
 void DifficultyMenu::Update(StageCmd * const cmd)
 {
 	difficultymenuform->Update();
@@ -15,6 +15,9 @@ class DifficultyMenu : public Stage
 	private:
 		Form* difficultymenuform;
 		StageCmd stageCmd;
+		FormEventHandlers handlers;
+
+		void StartGame(UString citymapName);
 
 	public:
 		DifficultyMenu(Framework &fw);
@@ -12,6 +12,25 @@ MainMenu::MainMenu(Framework &fw)
 	: Stage(fw)
 {
 	mainmenuform = fw.gamecore->GetForm("FORM_MAINMENU");
+
+	handlers.Bind( "BUTTON_OPTIONS", FormEventType::ButtonClick, [this](Event*)
+	{
+		stageCmd.cmd = StageCmd::Command::PUSH;
+		stageCmd.nextStage = std::make_shared<OptionsMenu>(this->fw);
+	});
+	handlers.Bind( "BUTTON_QUIT", FormEventType::ButtonClick, [this](Event*)
+	{
+		stageCmd.cmd = StageCmd::Command::QUIT;
+	});
+	handlers.Bind( "BUTTON_NEWGAME", FormEventType::ButtonClick, [this](Event*)
+	{
+		stageCmd.cmd = StageCmd::Command::PUSH;
+		stageCmd.nextStage = std::make_shared<DifficultyMenu>(this->fw);
+	});
+	handlers.Bind( "CHECK_DEBUGMODE", FormEventType::CheckBoxChange, [this](Event* e)
+	{
+		this->fw.gamecore->DebugModeEnabled = ((CheckBox*)e->Data.Forms.RaisedBy)->Checked;
+	});
 }
 
 MainMenu::~MainMenu()
@@ -49,35 +68,7 @@ void MainMenu::EventOccurred(Event *e)
 		}
 	}
 
-	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::ButtonClick )
-	{
-		if( e->Data.Forms.RaisedBy->Name == "BUTTON_OPTIONS" )
-		{
-			stageCmd.cmd = StageCmd::Command::PUSH;
-			stageCmd.nextStage = std::make_shared<OptionsMenu>(fw);
-			return;
-		}
-		if( e->Data.Forms.RaisedBy->Name == "BUTTON_QUIT" )
-		{
-			stageCmd.cmd = StageCmd::Command::QUIT;
-			return;
-		}
-		if( e->Data.Forms.RaisedBy->Name == "BUTTON_NEWGAME" )
-		{
-			stageCmd.cmd = StageCmd::Command::PUSH;
-			stageCmd.nextStage = std::make_shared<DifficultyMenu>(fw);
-			return;
-		}
-	}
-
-	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::CheckBoxChange )
-	{
-		if( e->Data.Forms.RaisedBy->Name == "CHECK_DEBUGMODE" )
-		{
-			fw.gamecore->DebugModeEnabled = ((CheckBox*)e->Data.Forms.RaisedBy)->Checked;
-		}
-	}
-
+	handlers.Dispatch( e );
 }
 
 void MainMenu::Update(StageCmd * const cmd)
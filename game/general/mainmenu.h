@@ -15,6 +15,7 @@ class MainMenu : public Stage
 	private:
 		Form* mainmenuform;
 		StageCmd stageCmd;
+		FormEventHandlers handlers;
 
 	public:
 		MainMenu(Framework &fw);
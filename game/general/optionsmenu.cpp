@@ -11,6 +11,22 @@ OptionsMenu::OptionsMenu(Framework &fw)
 	: Stage(fw)
 {
 	menuform = fw.gamecore->GetForm("FORM_OPTIONSMENU");
+
+	handlers.Bind( "BUTTON_TEST_XCOMBASE", FormEventType::ButtonClick, [this](Event*)
+	{
+		stageCmd.cmd = StageCmd::Command::PUSH;
+		stageCmd.nextStage = std::make_shared<BaseScreen>(this->fw);
+	});
+	handlers.Bind( "BUTTON_TEST_UFOPAEDIA", FormEventType::ButtonClick, [this](Event*)
+	{
+		stageCmd.cmd = StageCmd::Command::PUSH;
+		stageCmd.nextStage = std::make_shared<Ufopaedia>(this->fw);
+	});
+	handlers.Bind( "BUTTON_DEBUGGING", FormEventType::ButtonClick, [this](Event*)
+	{
+		stageCmd.cmd = StageCmd::Command::PUSH;
+		stageCmd.nextStage = std::make_shared<DebugMenu>(this->fw);
+	});
 }
 
 OptionsMenu::~OptionsMenu()
@@ -47,27 +63,7 @@ void OptionsMenu::EventOccurred(Event *e)
 		}
 	}
 
-	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::ButtonClick )
-	{
-		if( e->Data.Forms.RaisedBy->Name == "BUTTON_TEST_XCOMBASE" )
-		{
-			stageCmd.cmd = StageCmd::Command::PUSH;
-			stageCmd.nextStage = std::make_shared<BaseScreen>(fw);
-			return;
-		}
-		if( e->Data.Forms.RaisedBy->Name == "BUTTON_TEST_UFOPAEDIA" )
-		{
-			stageCmd.cmd = StageCmd::Command::PUSH;
-			stageCmd.nextStage = std::make_shared<Ufopaedia>(fw);
-			return;
-		}
-		if( e->Data.Forms.RaisedBy->Name == "BUTTON_DEBUGGING" )
-		{
-			stageCmd.cmd = StageCmd::Command::PUSH;
-			stageCmd.nextStage = std::make_shared<DebugMenu>(fw);
-			return;
-		}
-	}
+	handlers.Dispatch( e );
 }
 
 void OptionsMenu::Update(StageCmd * const cmd)
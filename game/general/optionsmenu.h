@@ -15,6 +15,7 @@ class OptionsMenu : public Stage
 	private:
 		Form* menuform;
 		StageCmd stageCmd;
+		FormEventHandlers handlers;
 
 
 	public:
@@ -2,6 +2,8 @@
 #include "game/resources/gamecore.h"
 #include "framework/framework.h"
 
+#include <physfs.h>
+
 namespace OpenApoc {
 
 GameCore::GameCore(Framework &fw)
@@ -16,6 +18,12 @@ void GameCore::Load(UString CoreXMLFilename, UString Language)
 	language = Language;
 	ParseXMLDoc( CoreXMLFilename );
 	DebugModeEnabled = false;
+	LogInfo("Loaded %d strings for language \"%s\"", (int)languagetext.size(), language.str().c_str());
+
+	if( fw.Settings->getBool("Language.SaveStringTable") )
+	{
+		SaveStringTable( UString("strings_") + language + UString(".bin") );
+	}
 
 	MouseCursor = new ApocCursor( fw, fw.gamecore->GetPalette( "xcom3/tacdata/TACTICAL.PAL" ) );
 
@@ -33,29 +41,30 @@ void GameCore::ParseXMLDoc( UString XMLFilename )
 {
 	tinyxml2::XMLDocument doc;
 	tinyxml2::XMLElement* node;
-	UString systemPath;
 	{
 		auto file = fw.data->load_file(XMLFilename);
 		if (!file)
 		{
 			LogError("Failed to open XML file \"%s\"", XMLFilename.str().c_str());
+			return;
 		}
-		systemPath = file.systemPath();
-	}
+		LogInfo("Loading XML file \"%s\" - found at \"%s\"", XMLFilename.str().c_str(), file.systemPath().str().c_str());
 
-	if (systemPath == "")
-	{
-		LogError("Failed to read XML file \"%s\"", XMLFilename.str().c_str());
-		return;
+		auto fileSize = file.size();
+		std::unique_ptr<char[]> xmlText(new char[fileSize]);
+		file.read(xmlText.get(), fileSize);
+		if (!file)
+		{
+			LogError("Failed to read XML file \"%s\"", XMLFilename.str().c_str());
+			return;
+		}
+		doc.Parse( xmlText.get(), fileSize );
 	}
-	LogInfo("Loading XML file \"%s\" - found at \"%s\"", XMLFilename.str().c_str(), systemPath.str().c_str());
-
-	doc.LoadFile( systemPath.str().c_str() );
 	node = doc.RootElement();
 
 	if (!node)
 	{
-		LogError("Failed to parse XML file \"%s\"", systemPath.str().c_str());
+		LogError("Failed to parse XML file \"%s\"", XMLFilename.str().c_str());
 		return;
 	}
 
@@ -132,6 +141,16 @@ void GameCore::ParseGameXML( tinyxml2::XMLElement* Source )
 		{
 			ParseXMLDoc( node->GetText() );
 		}
+		if( nodename == "stringtable" )
+		{
+			//Precompiled strings for one language - saves parsing the
+			//<string> elements for every language at startup
+			const char* tableLanguage = node->Attribute("language");
+			if( tableLanguage != nullptr && language == tableLanguage )
+			{
+				LoadStringTable( node->GetText() );
+			}
+		}
 	}
 }
 
@@ -140,31 +159,111 @@ void GameCore::ParseStringXML( tinyxml2::XMLElement* Source )
 	UString nodename = Source->Name();
 	if( nodename == "string" )
 	{
-		if( Source->FirstChildElement(language.str().c_str()) != nullptr )
+		tinyxml2::XMLElement* text = Source->FirstChildElement(language.str().c_str());
+		if( text != nullptr && text->GetText() != nullptr )
 		{
-			languagetext[Source->Attribute("id")] = Source->FirstChildElement(language.str().c_str())->GetText();
+			languagetext.add( Source->Attribute("id"), text->GetText() );
 		}
 	}
 }
 
+void GameCore::LoadStringTable( UString Path )
+{
+	auto file = fw.data->load_file(Path);
+	if (!file)
+	{
+		LogError("Failed to open string table \"%s\"", Path.str().c_str());
+		return;
+	}
+	auto fileSize = file.size();
+	std::unique_ptr<char[]> data(new char[fileSize]);
+	file.read(data.get(), fileSize);
+	if (!file)
+	{
+		LogError("Failed to read string table \"%s\"", Path.str().c_str());
+		return;
+	}
+
+	if (languagetext.size() == 0)
+	{
+		if (!languagetext.deserialise(data.get(), fileSize))
+			LogError("Invalid string table \"%s\"", Path.str().c_str());
+		return;
+	}
+	//Strings already defined are overridden, as if the table's <string>
+	//elements were parsed here
+	StringTable table;
+	if (!table.deserialise(data.get(), fileSize))
+	{
+		LogError("Invalid string table \"%s\"", Path.str().c_str());
+		return;
+	}
+	languagetext.merge(table);
+}
+
+void GameCore::SaveStringTable( UString Path )
+{
+	std::string data = languagetext.serialise();
+	PHYSFS_File* file = PHYSFS_openWrite(Path.str().c_str());
+	if (!file)
+	{
+		LogError("Failed to open \"%s\" for writing: %s", Path.str().c_str(), PHYSFS_getLastError());
+		return;
+	}
+	if (PHYSFS_writeBytes(file, data.data(), data.size()) != (PHYSFS_sint64)data.size())
+	{
+		LogError("Failed to write string table \"%s\": %s", Path.str().c_str(), PHYSFS_getLastError());
+	}
+	PHYSFS_close(file);
+	fw.data->file_written(Path);
+	LogInfo("Saved string table \"%s\"", Path.str().c_str());
+}
+
 void GameCore::ParseFormXML( tinyxml2::XMLElement* Source )
 {
-	forms[Source->Attribute("id")] = new Form( fw, Source );
+	UString id = Source->Attribute("id");
+	tinyxml2::XMLPrinter printer( nullptr, true );
+	Source->Accept( &printer );
+	formDefinitions[id] = printer.CStr();
 }
 
-UString GameCore::GetString(UString ID)
+UString GameCore::GetString(const UString &ID)
 {
-	UString s = languagetext[ID];
-	if( s == "" )
+	const char* s = languagetext.lookup(ID);
+	if( s == nullptr || s[0] == '\0' )
 	{
-		s = ID;
+		return ID;
 	}
 	return s;
 }
 
 Form* GameCore::GetForm(UString ID)
 {
-	return forms[ID];
+	auto form = forms.find( ID );
+	if( form != forms.end() )
+	{
+		return form->second;
+	}
+
+	auto definition = formDefinitions.find( ID );
+	if( definition == formDefinitions.end() )
+	{
+		LogError("Missing form \"%s\"", ID.str().c_str());
+		return nullptr;
+	}
+
+	tinyxml2::XMLDocument doc;
+	doc.Parse( definition->second.c_str(), definition->second.length() );
+	if( doc.RootElement() == nullptr )
+	{
+		LogError("Failed to parse form \"%s\"", ID.str().c_str());
+		return nullptr;
+	}
+	Form* f = new Form( fw, doc.RootElement() );
+	forms[ID] = f;
+	//The text is only needed to build the form once
+	formDefinitions.erase( definition );
+	return f;
 }
 
 std::shared_ptr<Image> GameCore::GetImage(UString ImageData)
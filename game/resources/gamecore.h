@@ -5,6 +5,7 @@
 #include "framework/font.h"
 #include "forms/forms.h"
 #include "vehiclefactory.h"
+#include "library/stringtable.h"
 
 namespace OpenApoc {
 
@@ -16,13 +17,18 @@ class GameCore
 		UString language;
 
 		std::map<UString, UString> supportedlanguages;
-		std::map<UString, UString> languagetext;
+		StringTable languagetext;
 		std::map<UString, std::shared_ptr<BitmapFont>> fonts;
+		//Forms are only built on first GetForm(). Until then they're kept
+		//as the (compact) text of their <form> element
+		std::map<UString, std::string> formDefinitions;
 		std::map<UString, Form*> forms;
 
 		void ParseXMLDoc( UString XMLFilename );
 		void ParseGameXML( tinyxml2::XMLElement* Source );
 		void ParseStringXML( tinyxml2::XMLElement* Source );
+		void LoadStringTable( UString Path );
+		void SaveStringTable( UString Path );
 		void ParseFormXML( tinyxml2::XMLElement* Source );
 
 		// void ParseAlienXML( tinyxml2::XMLElement* Source );
@@ -47,7 +53,7 @@ class GameCore
 		void Load(UString CoreXMLFilename, UString Language);
 		~GameCore();
 
-		UString GetString(UString ID);
+		UString GetString(const UString &ID);
 		Form* GetForm(UString ID);
 		std::shared_ptr<Image> GetImage(UString ImageData);
 		std::shared_ptr<BitmapFont> GetFont(UString FontData);
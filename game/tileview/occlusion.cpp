@@ -0,0 +1,127 @@
+#include "game/tileview/occlusion.h"
+#include "framework/image.h"
+#include "framework/palette.h"
+
+#include <climits>
+
+namespace OpenApoc {
+
+SpriteCoverage::SpriteCoverage(std::shared_ptr<Image> image, std::shared_ptr<Palette> palette)
+	: translucent(true)
+{
+	auto paletteImage = std::dynamic_pointer_cast<PaletteImage>(image);
+	if (!paletteImage || !palette)
+	{
+		bounds = Rect<int>{0, 0, (int)image->size.x, (int)image->size.y};
+		rowSpans.assign(image->size.y, std::make_pair(0, 0));
+		return;
+	}
+
+	bounds = paletteImage->getOpaqueBounds();
+	translucent = false;
+	rowSpans.resize(image->size.y, std::make_pair(0, 0));
+	PaletteImageLock l(paletteImage, ImageLockUse::Read);
+	const uint8_t *data = static_cast<const uint8_t*>(l.getData());
+	for (unsigned int y = 0; y < image->size.y; y++)
+	{
+		const uint8_t *row = &data[y * image->size.x];
+		auto &best = rowSpans[y];
+		int start = -1;
+		for (unsigned int x = 0; x <= image->size.x; x++)
+		{
+			bool opaque = x < image->size.x && row[x] != 0 &&
+				row[x] < palette->colours.size() && palette->colours[row[x]].a == 255;
+			if (x < image->size.x && row[x] != 0 && !opaque &&
+			    (row[x] >= palette->colours.size() || palette->colours[row[x]].a != 0))
+				translucent = true;
+			if (opaque && start < 0)
+				start = x;
+			else if (!opaque && start >= 0)
+			{
+				if ((int)x - start > best.second - best.first)
+					best = std::make_pair(start, (int)x);
+				start = -1;
+			}
+		}
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer(Vec2<int> screenSize)
+{
+	reset(screenSize);
+}
+
+void
+OcclusionBuffer::reset(Vec2<int> screenSize)
+{
+	this->screenSize = screenSize;
+	this->size = Vec2<int>{(screenSize.x + BlockSize - 1) / BlockSize, (screenSize.y + BlockSize - 1) / BlockSize};
+	this->hidden.assign(size.x * size.y, 0);
+}
+
+bool
+OcclusionBuffer::isHidden(const SpriteCoverage &coverage, Vec2<float> position) const
+{
+	int x0 = std::max(0, (int)floorf(position.x + coverage.bounds.p0.x));
+	int y0 = std::max(0, (int)floorf(position.y + coverage.bounds.p0.y));
+	int x1 = std::min(screenSize.x, (int)ceilf(position.x + coverage.bounds.p1.x));
+	int y1 = std::min(screenSize.y, (int)ceilf(position.y + coverage.bounds.p1.y));
+	if (x0 >= x1 || y0 >= y1)
+		return true;
+
+	for (int by = y0 / BlockSize; by <= (y1 - 1) / BlockSize; by++)
+	{
+		for (int bx = x0 / BlockSize; bx <= (x1 - 1) / BlockSize; bx++)
+		{
+			if (!hidden[by * size.x + bx])
+				return false;
+		}
+	}
+	return true;
+}
+
+void
+OcclusionBuffer::occlude(const SpriteCoverage &coverage, Vec2<float> position)
+{
+	//A sprite between pixels is blended over its edges
+	if (position.x != floorf(position.x) || position.y != floorf(position.y))
+		return;
+	Vec2<int> pos{(int)position.x, (int)position.y};
+
+	int y0 = pos.y + coverage.bounds.p0.y;
+	int y1 = pos.y + coverage.bounds.p1.y;
+	//Only blocks with every row inside the sprite
+	for (int by = (std::max(y0, 0) + BlockSize - 1) / BlockSize;
+	     by < size.y && (by + 1) * BlockSize <= y1; by++)
+	{
+		//The run of columns that's opaque on every row of the block
+		int left = 0, right = INT_MAX;
+		for (int y = by * BlockSize; y < (by + 1) * BlockSize; y++)
+		{
+			auto &span = coverage.rowSpans[y - pos.y];
+			left = std::max(left, span.first);
+			right = std::min(right, span.second);
+		}
+		left += pos.x;
+		right += pos.x;
+		for (int bx = (std::max(left, 0) + BlockSize - 1) / BlockSize;
+		     bx < size.x && (bx + 1) * BlockSize <= right; bx++)
+		{
+			hidden[by * size.x + bx] = 1;
+		}
+	}
+}
+
+int
+OcclusionBuffer::visibleArea(const SpriteCoverage &coverage, Vec2<float> position) const
+{
+	int x0 = std::max(0, (int)floorf(position.x + coverage.bounds.p0.x));
+	int y0 = std::max(0, (int)floorf(position.y + coverage.bounds.p0.y));
+	int x1 = std::min(screenSize.x, (int)ceilf(position.x + coverage.bounds.p1.x));
+	int y1 = std::min(screenSize.y, (int)ceilf(position.y + coverage.bounds.p1.y));
+	if (x0 >= x1 || y0 >= y1)
+		return 0;
+	return (x1 - x0) * (y1 - y0);
+}
+
+}; //namespace OpenApoc
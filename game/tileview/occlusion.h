@@ -0,0 +1,55 @@
+#pragma once
+
+#include "framework/includes.h"
+
+namespace OpenApoc {
+
+class Image;
+class Palette;
+
+//Which parts of a sprite are certainly opaque when drawn
+class SpriteCoverage
+{
+	public:
+		//Bounds of every pixel that might be drawn
+		Rect<int> bounds;
+		//For each row of the image, a run [first, second) of fully opaque
+		//pixels (the longest in the row) - empty if there's none
+		std::vector<std::pair<int,int>> rowSpans;
+		//True if any pixel is only partly transparent, so drawing it
+		//depends on what's behind it
+		bool translucent;
+
+		//PaletteImage pixels are opaque if their palette colour has full
+		//alpha. Any other image is assumed to be translucent, hide nothing,
+		//and might draw anywhere in its area
+		SpriteCoverage(std::shared_ptr<Image> image, std::shared_ptr<Palette> palette);
+};
+
+//Coarse screen-space record of which blocks are completely hidden by the
+//sprites drawn in front of them. Offering sprites front to back, anything
+//whose bounds only touch hidden blocks (or fall off the screen) needn't be
+//drawn at all
+class OcclusionBuffer
+{
+	private:
+		Vec2<int> screenSize;
+		//In blocks
+		Vec2<int> size;
+		std::vector<uint8_t> hidden;
+	public:
+		static const int BlockSize = 8;
+
+		OcclusionBuffer(Vec2<int> screenSize = Vec2<int>{0,0});
+		//Marks every block visible again, resizing if needed
+		void reset(Vec2<int> screenSize);
+		//True if a sprite drawn at 'position' would be entirely hidden
+		bool isHidden(const SpriteCoverage &coverage, Vec2<float> position) const;
+		//Marks the blocks a sprite drawn at 'position' fully covers. Only
+		//sprites at whole pixel positions hide anything
+		void occlude(const SpriteCoverage &coverage, Vec2<float> position);
+		//The number of screen pixels the sprite's bounds cover
+		int visibleArea(const SpriteCoverage &coverage, Vec2<float> position) const;
+};
+
+}; //namespace OpenApoc
@@ -1,10 +1,12 @@
 #include "game/tileview/tile.h"
 #include "framework/framework.h"
+#include "framework/tilevolume.h"
+#include "framework/image.h"
 
 namespace OpenApoc {
 
 TileMap::TileMap(Framework &fw, Vec3<int> size)
-	: fw(fw), size(size)
+	: fw(fw), size(size), staticGenerations(size)
 {
 	tiles.reserve(size.z * size.y * size.z);
 	for (int z = 0; z < size.z; z++)
@@ -28,6 +30,40 @@ TileMap::update(unsigned int ticks)
 		object->update(ticks);
 }
 
+void
+TileMap::staticTileChanged(Vec3<int> pos)
+{
+	this->staticGenerations.changed(pos);
+
+	auto volume = this->getTileVolume();
+	if (!volume)
+		return;
+	//The tile's static object, if it's visible and drawn from the volume's
+	//tile set, is the one the volume draws
+	uint16_t id = 0;
+	for (auto &obj : this->getTile(pos).objects)
+	{
+		if (!obj->visible || !obj->getSprite() ||
+		    std::find(activeObjects.begin(), activeObjects.end(), obj) != activeObjects.end())
+			continue;
+		auto sprite = obj->getSprite();
+		if (sprite->owningSet.lock() != volume->tiles)
+		{
+			LogWarning("Static object at %d,%d,%d not in the tile volume's set", pos.x, pos.y, pos.z);
+			continue;
+		}
+		id = sprite->indexInSet;
+		break;
+	}
+	volume->set(pos, id);
+}
+
+std::shared_ptr<TileVolume>
+TileMap::getTileVolume()
+{
+	return nullptr;
+}
+
 Tile&
 TileMap::getTile(int x, int y, int z)
 {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "framework/includes.h"
+#include "game/tileview/tilegenerations.h"
 
 namespace OpenApoc {
 
@@ -8,6 +9,7 @@ class Framework;
 class Image;
 class TileMap;
 class Tile;
+class TileVolume;
 
 class TileObjectCollisionVoxels
 {
@@ -68,6 +70,16 @@ class TileMap
 		Vec3<int> size;
 
 		std::vector<std::shared_ptr<TileObject> > activeObjects;
+		//Changes to the static objects (any not in activeObjects), for
+		//views that cache how tiles look
+		TileGenerations staticGenerations;
+		//Must be called after adding, removing or changing the visibility
+		//or sprite of a static object
+		void staticTileChanged(Vec3<int> pos);
+		//Maps can offer their static objects as a TileVolume, which then
+		//holds the only static object of every tile. staticTileChanged()
+		//keeps it up to date. nullptr if the map doesn't have one
+		virtual std::shared_ptr<TileVolume> getTileVolume();
 
 		TileMap (Framework &fw, Vec3<int> size);
 		~TileMap();
@@ -0,0 +1,43 @@
+#include "game/tileview/tilegenerations.h"
+#include "framework/logger.h"
+#include <cassert>
+
+namespace OpenApoc {
+
+TileGenerations::TileGenerations(Vec3<int> mapSize)
+	: blockCount{(mapSize.x + BlockSize - 1) / BlockSize, (mapSize.y + BlockSize - 1) / BlockSize, mapSize.z}
+{
+	generations.resize(blockCount.x * blockCount.y * blockCount.z, 0);
+}
+
+Vec3<int> TileGenerations::getBlockCount() const
+{
+	return blockCount;
+}
+
+Vec3<int> TileGenerations::blockOf(Vec3<int> pos)
+{
+	return Vec3<int>{pos.x / BlockSize, pos.y / BlockSize, pos.z};
+}
+
+void TileGenerations::changed(Vec3<int> pos)
+{
+	auto block = blockOf(pos);
+	if (pos.x < 0 || pos.y < 0 || pos.z < 0 ||
+	    block.x >= blockCount.x || block.y >= blockCount.y || block.z >= blockCount.z)
+	{
+		LogError("Tile %d,%d,%d outside the map", pos.x, pos.y, pos.z);
+		return;
+	}
+	generations[(block.z * blockCount.y + block.y) * blockCount.x + block.x]++;
+}
+
+uint32_t TileGenerations::get(Vec3<int> block) const
+{
+	assert(block.x >= 0 && block.x < blockCount.x);
+	assert(block.y >= 0 && block.y < blockCount.y);
+	assert(block.z >= 0 && block.z < blockCount.z);
+	return generations[(block.z * blockCount.y + block.y) * blockCount.x + block.x];
+}
+
+}; //namespace OpenApoc
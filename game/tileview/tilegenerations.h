@@ -0,0 +1,31 @@
+#pragma once
+
+#include "framework/includes.h"
+
+namespace OpenApoc {
+
+//Counts the changes made in each block of a map's tiles. Anything caching
+//how a block looks remembers the count it was built at, and rebuilds once
+//it differs - so any number of caches can follow the changes, and the
+//memory used doesn't grow with them
+class TileGenerations
+{
+	private:
+		Vec3<int> blockCount;
+		std::vector<uint32_t> generations;
+
+	public:
+		//Blocks are BlockSize x BlockSize tiles of one z level
+		static const int BlockSize = 16;
+
+		TileGenerations(Vec3<int> mapSize);
+
+		Vec3<int> getBlockCount() const;
+		//The block holding tile 'pos'
+		static Vec3<int> blockOf(Vec3<int> pos);
+
+		void changed(Vec3<int> pos);
+		uint32_t get(Vec3<int> block) const;
+};
+
+}; //namespace OpenApoc
@@ -0,0 +1,56 @@
+#include "game/tileview/tilerange.h"
+
+#include <cassert>
+
+namespace OpenApoc {
+
+namespace {
+
+//Integer division rounding towards -infinity/+infinity, for b > 0
+int floorDiv(int a, int b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+int ceilDiv(int a, int b)
+{
+	return (a >= 0) ? (a + b - 1) / b : -(-a / b);
+}
+
+}; //anonymous namespace
+
+VisibleTileRange::VisibleTileRange(Vec3<int> tileSize, Vec2<int> mapSize, Vec2<int> windowSize, Vec2<int> origin, Vec2<int> margin)
+	: mapSize(mapSize)
+{
+	assert(tileSize.x > 0 && tileSize.y > 0);
+	//Tile {x,y} is drawn at origin + {(x - y) * tileSize.x / 2, (x + y) *
+	//tileSize.y / 2}. Doubling both sides keeps the bounds exact
+	uMin = ceilDiv(-2 * (origin.x + margin.x), tileSize.x);
+	uMax = floorDiv(2 * (windowSize.x + margin.x - origin.x), tileSize.x);
+	vMin = ceilDiv(-2 * (origin.y + margin.y), tileSize.y);
+	vMax = floorDiv(2 * (windowSize.y + margin.y - origin.y), tileSize.y);
+
+	//Where the u and v bounds cross
+	yMin = std::max(0, ceilDiv(vMin - uMax, 2));
+	yMax = std::min(mapSize.y - 1, floorDiv(vMax - uMin, 2));
+}
+
+bool
+VisibleTileRange::empty() const
+{
+	return yMin > yMax;
+}
+
+int
+VisibleTileRange::xMin(int y) const
+{
+	return std::max(0, std::max(uMin + y, vMin - y));
+}
+
+int
+VisibleTileRange::xMax(int y) const
+{
+	return std::min(mapSize.x - 1, std::min(uMax + y, vMax - y));
+}
+
+}; //namespace OpenApoc
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "framework/includes.h"
+
+namespace OpenApoc {
+
+//The tiles of one z level that can be seen in a window onto TileView's
+//isometric projection. In tile space that's a diamond, found by inverting
+//the projection at the window's edges, so it can be walked directly rather
+//than testing every tile of the map
+class VisibleTileRange
+{
+	private:
+		//Bounds on x - y and x + y
+		int uMin, uMax, vMin, vMax;
+		Vec2<int> mapSize;
+	public:
+		//Rows that have any visible tiles
+		int yMin, yMax;
+
+		//'origin' is where tile {0,0} of the level is drawn. A tile counts
+		//as visible if where it's drawn is within 'margin' of the window
+		VisibleTileRange(Vec3<int> tileSize, Vec2<int> mapSize, Vec2<int> windowSize, Vec2<int> origin, Vec2<int> margin);
+		bool empty() const;
+		//The visible tiles in row y, [xMin, xMax]. Empty if xMin > xMax
+		int xMin(int y) const;
+		int xMax(int y) const;
+};
+
+}; //namespace OpenApoc
@@ -4,13 +4,16 @@
 #include "framework/includes.h"
 #include "framework/framework.h"
 #include "framework/image.h"
+#include "framework/spritelist.h"
 #include "game/resources/gamecore.h"
 
+#include <chrono>
 
 namespace OpenApoc {
 
 TileView::TileView(Framework &fw, TileMap &map, Vec3<int> tileSize)
-	: Stage(fw), map(map), tileSize(tileSize), maxZDraw(10), offsetX(0), offsetY(0),
+	: Stage(fw), map(map), tileSize(tileSize), chunkCount(0,0,0), spritesDrawn(0), spritesCulled(0), overdraw(0), renderTimeMs(0),
+	  maxZDraw(10), occlusionCulling(true), depthSorting(true), staticCaching(true), gpuTiles(true), showOverdraw(false), offsetX(0), offsetY(0),
 	  cameraScrollX(0), cameraScrollY(0), selectedTilePosition(0,0,0),
 	  selectedTileImageBack(fw.data->load_image("CITY/SELECTED-CITYTILE-BACK.PNG")),
 	  selectedTileImageFront(fw.data->load_image("CITY/SELECTED-CITYTILE-FRONT.PNG")),
@@ -122,6 +125,38 @@ void TileView::EventOccurred(Event *e)
 			case ALLEGRO_KEY_3:
 				pal = fw.data->load_palette("xcom3/ufodata/PAL_03.DAT");
 				break;
+			case ALLEGRO_KEY_O:
+				if (fw.gamecore->DebugModeEnabled)
+					showOverdraw = !showOverdraw;
+				break;
+			case ALLEGRO_KEY_C:
+				if (fw.gamecore->DebugModeEnabled)
+				{
+					occlusionCulling = !occlusionCulling;
+					LogInfo("Occlusion culling %s", occlusionCulling ? "enabled" : "disabled");
+				}
+				break;
+			case ALLEGRO_KEY_Z:
+				if (fw.gamecore->DebugModeEnabled)
+				{
+					depthSorting = !depthSorting;
+					LogInfo("Depth sorting %s", depthSorting ? "enabled" : "disabled");
+				}
+				break;
+			case ALLEGRO_KEY_B:
+				if (fw.gamecore->DebugModeEnabled)
+				{
+					staticCaching = !staticCaching;
+					LogInfo("Static tile caching %s", staticCaching ? "enabled" : "disabled");
+				}
+				break;
+			case ALLEGRO_KEY_G:
+				if (fw.gamecore->DebugModeEnabled)
+				{
+					gpuTiles = !gpuTiles;
+					LogInfo("Tile volume drawing %s", gpuTiles ? "enabled" : "disabled");
+				}
+				break;
 		}
 	}
 	else if (e->Type == EVENT_MOUSE_DOWN)
@@ -170,18 +205,241 @@ void TileView::Update(StageCmd * const cmd)
 
 }
 
-void TileView::Render()
+const SpriteCoverage &TileView::getCoverage(std::shared_ptr<Image> image)
 {
-	int dpyWidth = fw.Display_GetWidth();
-	int dpyHeight = fw.Display_GetHeight();
-	Renderer &r = *fw.renderer;
-	r.clear();
-	r.setPalette(this->pal);
+	//Which pixels are opaque depends on the palette
+	if (coveragePalette != pal)
+	{
+		coverage.clear();
+		coveragePalette = pal;
+	}
+	auto &entry = coverage[image.get()];
+	if (!entry.second || entry.first.lock() != image)
+	{
+		entry.first = image;
+		entry.second.reset(new SpriteCoverage(image, pal));
+	}
+	return *entry.second;
+}
+
+VisibleTileRange TileView::visibleTiles(int z, int dpyWidth, int dpyHeight)
+{
+	//Tiles are drawn if their origin is within a tile of the screen
+	return VisibleTileRange(tileSize, Vec2<int>{map.size.x, map.size.y}, Vec2<int>{dpyWidth, dpyHeight},
+		Vec2<int>{offsetX, offsetY - z * tileSize.z}, Vec2<int>{tileSize.x, tileSize.y});
+}
+
+float TileView::tileDepth(Vec3<int> tile, int slot)
+{
+	return TileVolume::tileDepth(map.size, tile, slot);
+}
+
+void TileView::bakeChunk(Vec3<int> chunk, const std::vector<TileObject*> &active)
+{
+	auto &c = chunks[(chunk.z * chunkCount.y + chunk.y) * chunkCount.x + chunk.x];
+	if (!c.sprites)
+		c.sprites = std::make_shared<SpriteList>();
+	c.sprites->clear();
+	c.dirty = false;
+	c.generation = map.staticGenerations.get(chunk);
+
+	int z = chunk.z;
+	for (int y = chunk.y * ChunkSize; y < std::min((chunk.y + 1) * ChunkSize, map.size.y); y++)
+	{
+		for (int x = chunk.x * ChunkSize; x < std::min((chunk.x + 1) * ChunkSize, map.size.x); x++)
+		{
+			auto &tile = map.getTile(x, y, z);
+			//Slot 0 is the back of the selection marker
+			int slot = 1;
+			for (auto &obj : tile.objects)
+			{
+				int objSlot = slot++;
+				if (!obj->visible || std::binary_search(active.begin(), active.end(), obj.get()))
+					continue;
+				auto sprite = obj->getSprite();
+				if (!sprite)
+					continue;
+				c.sprites->add(sprite, tileToScreenCoords(obj->getPosition()),
+					tileDepth(Vec3<int>{x, y, z}, objSlot), getCoverage(sprite).translucent);
+			}
+		}
+	}
+}
+
+void TileView::renderCached(Renderer &r, int dpyWidth, int dpyHeight)
+{
+	if (chunkCount.x == 0)
+	{
+		chunkCount = map.staticGenerations.getBlockCount();
+		chunks.resize(chunkCount.x * chunkCount.y * chunkCount.z, Chunk{nullptr, true, 0});
+	}
+	if (chunkPalette != pal)
+	{
+		for (auto &chunk : chunks)
+			chunk.dirty = true;
+		chunkPalette = pal;
+	}
+
+	Vec2<float> offset{(float)offsetX, (float)offsetY};
+	Rect<float> screen{-offset.x, -offset.y, dpyWidth - offset.x, dpyHeight - offset.y};
+	//Sorted, for looking up while baking
+	std::vector<TileObject*> active;
+	bool haveActive = false;
+
+	spritesDrawn = 0;
+	//Nothing here is culled, beyond skipping chunks off screen
+	spritesCulled = -1;
+	//Only the overlay needs the area drawn
+	int64_t drawnArea = 0;
+	if (showOverdraw)
+		occlusion.reset(Vec2<int>{dpyWidth, dpyHeight});
+	visibleChunks.clear();
+	//The volume holds every static object, so the chunks aren't needed -
+	//any changes meanwhile are caught by their generation when they're
+	//next used. Only if the renderer really draws it, as the chunks beat drawing the
+	//tiles one by one
+	auto volume = gpuTiles ? map.getTileVolume() : nullptr;
+	if (volume && !r.canDrawTileVolume(volume))
+		volume = nullptr;
+	for (int z = 0; !volume && z < maxZDraw; z++)
+	{
+		auto range = visibleTiles(z, dpyWidth, dpyHeight);
+		if (range.empty())
+			continue;
+		for (int cy = range.yMin / ChunkSize; cy <= range.yMax / ChunkSize; cy++)
+		{
+			//The columns any of the chunk's visible rows reach
+			int xMin = map.size.x, xMax = -1;
+			for (int y = std::max(cy * ChunkSize, range.yMin); y <= std::min((cy + 1) * ChunkSize - 1, range.yMax); y++)
+			{
+				xMin = std::min(xMin, range.xMin(y));
+				xMax = std::max(xMax, range.xMax(y));
+			}
+			for (int cx = xMin / ChunkSize; xMin <= xMax && cx <= xMax / ChunkSize; cx++)
+			{
+				auto &chunk = chunks[(z * chunkCount.y + cy) * chunkCount.x + cx];
+				if (chunk.dirty || chunk.generation != map.staticGenerations.get(Vec3<int>{cx, cy, z}))
+				{
+					if (!haveActive)
+					{
+						for (auto &obj : map.activeObjects)
+							active.push_back(obj.get());
+						std::sort(active.begin(), active.end());
+						haveActive = true;
+					}
+					bakeChunk(Vec3<int>{cx, cy, z}, active);
+				}
+				if (chunk.sprites->empty() || !chunk.sprites->bounds.intersects(screen))
+					continue;
+				visibleChunks.push_back(&chunk);
+				spritesDrawn += chunk.sprites->sprites.size();
+				if (!showOverdraw)
+					continue;
+				for (auto &sprite : chunk.sprites->sprites)
+					drawnArea += occlusion.visibleArea(getCoverage(sprite.image),
+						Vec2<float>{sprite.position.x + offset.x, sprite.position.y + offset.y});
+			}
+		}
+	}
+	//The renderer walks the volume itself, so for the overlay go over the
+	//same tiles it will
+	for (int z = 0; volume && showOverdraw && z < std::min(maxZDraw, volume->size.z); z++)
+	{
+		auto range = visibleTiles(z, dpyWidth, dpyHeight);
+		for (int y = range.yMin; !range.empty() && y <= range.yMax; y++)
+		{
+			for (int x = range.xMin(y); x <= range.xMax(y); x++)
+			{
+				uint16_t id = volume->get(Vec3<int>{x, y, z});
+				if (id == 0 || id >= volume->tiles->images.size())
+					continue;
+				auto screenPos = tileToScreenCoords(Vec3<float>{(float)x, (float)y, (float)z});
+				drawnArea += occlusion.visibleArea(getCoverage(volume->tiles->images[id]),
+					Vec2<float>{screenPos.x + offset.x, screenPos.y + offset.y});
+				spritesDrawn++;
+			}
+		}
+	}
+
+	//Opaque sprites first, in any order
+	if (volume)
+		r.drawTileVolume(volume, offset, maxZDraw, false);
+	for (auto chunk : visibleChunks)
+		r.drawSpriteList(chunk->sprites, offset, false);
+
+	translucentItems.clear();
+	for (auto &obj : map.activeObjects)
+	{
+		auto &tilePos = obj->owningTile->position;
+		if (!obj->visible || tilePos.z >= maxZDraw)
+			continue;
+		auto sprite = obj->getSprite();
+		if (!sprite)
+			continue;
+		auto screenPos = tileToScreenCoords(obj->getPosition());
+		if (!screen.intersects(Rect<float>{screenPos.x, screenPos.y, screenPos.x + sprite->size.x, screenPos.y + sprite->size.y}))
+			continue;
+		int slot = 1;
+		for (auto &tileObj : obj->owningTile->objects)
+		{
+			if (tileObj == obj)
+				break;
+			slot++;
+		}
+		DepthItem item{sprite, Vec2<float>{screenPos.x + offset.x, screenPos.y + offset.y}, tileDepth(tilePos, slot)};
+		auto &coverage = getCoverage(sprite);
+		if (coverage.translucent)
+			translucentItems.push_back(item);
+		else
+			r.drawDepth(item.image, item.position, item.depth, false);
+		spritesDrawn++;
+		if (showOverdraw)
+			drawnArea += occlusion.visibleArea(coverage, item.position);
+	}
+	if (fw.gamecore->DebugModeEnabled && selectedTilePosition.z < maxZDraw)
+	{
+		auto screenPos = tileToScreenCoords(Vec3<float>{(float)selectedTilePosition.x, (float)selectedTilePosition.y, (float)selectedTilePosition.z});
+		screenPos.x += offset.x;
+		screenPos.y += offset.y;
+		translucentItems.push_back(DepthItem{selectedTileImageBack, screenPos, tileDepth(selectedTilePosition, 0)});
+		translucentItems.push_back(DepthItem{selectedTileImageFront, screenPos, tileDepth(selectedTilePosition, SlotsPerTile - 1)});
+	}
+
+	//Then the translucent ones back to front - a chunk's at a time, so
+	//they're only ordered against the moving objects' by chunk
+	if (volume)
+		r.drawTileVolume(volume, offset, maxZDraw, true);
+	for (auto chunk : visibleChunks)
+		r.drawSpriteList(chunk->sprites, offset, true);
+	std::stable_sort(translucentItems.begin(), translucentItems.end(), [](const DepthItem &a, const DepthItem &b)
+	{
+		return a.depth > b.depth;
+	});
+	for (auto &item : translucentItems)
+		r.drawDepth(item.image, item.position, item.depth, true);
+	overdraw = (float)drawnArea / std::max(1, dpyWidth * dpyHeight);
+}
+
+void TileView::renderTiles(Renderer &r, int dpyWidth, int dpyHeight)
+{
+	drawItems.clear();
+	//Moving one tile along x moves this far on screen
+	Vec2<float> stepX{tileSize.x / 2.0f, tileSize.y / 2.0f};
 	for (int z = 0; z < maxZDraw; z++)
 	{
-		for (int y = 0; y < map.size.y; y++)
+		auto range = visibleTiles(z, dpyWidth, dpyHeight);
+		for (int y = range.yMin; y <= range.yMax; y++)
 		{
-			for (int x = 0; x < map.size.x; x++)
+			int xMin = range.xMin(y);
+			int xMax = range.xMax(y);
+			if (xMin > xMax)
+				continue;
+			auto screenPos = tileToScreenCoords(Vec3<float>{(float)xMin,(float)y,(float)z});
+			screenPos.x += offsetX;
+			screenPos.y += offsetY;
+			//The row's tiles are next to each other in the map
+			Tile *tile = &map.getTile(xMin, y, z);
+			for (int x = xMin; x <= xMax; x++, tile++, screenPos.x += stepX.x, screenPos.y += stepX.y)
 			{
 				bool showSelected =
 					(fw.gamecore->DebugModeEnabled &&
@@ -189,37 +447,123 @@ void TileView::Render()
 					 y == selectedTilePosition.y &&
 					 x == selectedTilePosition.x);
 
-				auto &tile = map.getTile(x, y, z);
-				// Skip over transparent (missing) tiles
-				auto screenPos = tileToScreenCoords(Vec3<float>{(float)x,(float)y,(float)z});
-				screenPos.x += offsetX;
-				screenPos.y += offsetY;
-				//Skip over tiles that would be outside the window
-				if (screenPos.x + tileSize.x < 0 || screenPos.y + tileSize.y < 0
-					|| screenPos.x - tileSize.x > dpyWidth || screenPos.y - tileSize.y > dpyHeight)
-					continue;
-
 				if (showSelected)
-					r.draw(selectedTileImageBack, screenPos);
-				for (auto obj : tile.objects)
+					drawItems.push_back(DrawItem{selectedTileImageBack, screenPos, nullptr});
+				for (auto obj : tile->objects)
 				{
 					if (obj->visible)
 					{
 						auto objScreenPos = tileToScreenCoords(obj->getPosition());
 						objScreenPos.x += offsetX;
 						objScreenPos.y += offsetY;
-						auto img = obj->getSprite();
-						r.draw(img, objScreenPos);
+						drawItems.push_back(DrawItem{obj->getSprite(), objScreenPos, nullptr});
 					}
 
 				}
 
 				if (showSelected)
-					r.draw(selectedTileImageFront, screenPos);
+					drawItems.push_back(DrawItem{selectedTileImageFront, screenPos, nullptr});
+			}
+		}
+	}
+
+	bool useDepth = depthSorting && r.hasDepthBuffer();
+
+	//Walk front to back, dropping anything already covered by what's in
+	//front of it
+	spritesCulled = 0;
+	if (occlusionCulling || showOverdraw || useDepth)
+	{
+		occlusion.reset(Vec2<int>{dpyWidth, dpyHeight});
+		for (auto it = drawItems.rbegin(); it != drawItems.rend(); ++it)
+		{
+			it->coverage = &getCoverage(it->image);
+			if (!occlusionCulling && !showOverdraw)
+				continue;
+			if (occlusionCulling && occlusion.isHidden(*it->coverage, it->position))
+			{
+				it->image = nullptr;
+				spritesCulled++;
+				continue;
 			}
+			occlusion.occlude(*it->coverage, it->position);
 		}
 	}
+
+	spritesDrawn = 0;
+	int64_t drawnArea = 0;
+	if (useDepth)
+	{
+		//drawItems is in tile order, so each item's place in it is its
+		//depth - the last drawn is nearest. Opaque sprites can then go in
+		//any order, so group them by ImageSet (and so atlas page).
+		//Translucent ones still need to go back to front, after them
+		float depthStep = 1.0f / (drawItems.size() + 1);
+		opaqueItems.clear();
+		for (size_t i = 0; i < drawItems.size(); i++)
+		{
+			if (drawItems[i].image && !drawItems[i].coverage->translucent)
+				opaqueItems.push_back(std::make_pair(drawItems[i].image->owningSet.lock().get(), i));
+		}
+		std::sort(opaqueItems.begin(), opaqueItems.end());
+		for (auto &opaque : opaqueItems)
+		{
+			auto &item = drawItems[opaque.second];
+			r.drawDepth(item.image, item.position, 1.0f - (opaque.second + 1) * depthStep, false);
+		}
+		for (size_t i = 0; i < drawItems.size(); i++)
+		{
+			if (drawItems[i].image && drawItems[i].coverage->translucent)
+				r.drawDepth(drawItems[i].image, drawItems[i].position, 1.0f - (i + 1) * depthStep, true);
+		}
+	}
+	for (auto &item : drawItems)
+	{
+		if (!item.image)
+			continue;
+		if (!useDepth)
+			r.draw(item.image, item.position);
+		spritesDrawn++;
+		if (item.coverage)
+			drawnArea += occlusion.visibleArea(*item.coverage, item.position);
+	}
+	overdraw = (float)drawnArea / std::max(1, dpyWidth * dpyHeight);
+}
+
+void TileView::Render()
+{
+	auto startTime = std::chrono::steady_clock::now();
+	int dpyWidth = fw.Display_GetWidth();
+	int dpyHeight = fw.Display_GetHeight();
+	Renderer &r = *fw.renderer;
+	r.clear();
+	r.setPalette(this->pal);
+
+	if (staticCaching && r.hasDepthBuffer())
+		renderCached(r, dpyWidth, dpyHeight);
+	else
+		renderTiles(r, dpyWidth, dpyHeight);
+
+	if (showOverdraw && fw.gamecore->DebugModeEnabled)
+	{
+		char text[128];
+		if (spritesCulled < 0)
+			snprintf(text, sizeof(text), "Sprites %d drawn, culling n/a (cached path) - overdraw %.2fx - %.2fms",
+				spritesDrawn, overdraw, renderTimeMs);
+		else
+			snprintf(text, sizeof(text), "Sprites %d drawn, %d culled - overdraw %.2fx - %.2fms",
+				spritesDrawn, spritesCulled, overdraw, renderTimeMs);
+		auto font = fw.gamecore->GetFont("SMALFONT");
+		r.drawFilledRect(Vec2<float>{0, 0}, Vec2<float>{(float)dpyWidth, (float)font->GetFontHeight() + 4}, Colour{0,0,0,160});
+		font->drawString(r, UString(text), Vec2<float>{2, 2});
+	}
 	fw.gamecore->MouseCursor->Render();
+
+	//Measures the time to submit the frame, which is what culling saves on
+	//the CPU side - the fragment work saved shows up as overdraw
+	float frameMs = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - startTime).count() / 1000.0f;
+	renderTimeMs = renderTimeMs * 0.95f + frameMs * 0.05f;
 }
 
 bool TileView::IsTransition()
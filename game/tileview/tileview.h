@@ -3,11 +3,19 @@
 #include "framework/stage.h"
 #include "framework/includes.h"
 #include "framework/palette.h"
+#include "framework/tilevolume.h"
+#include "game/tileview/occlusion.h"
+#include "game/tileview/tilerange.h"
+#include "game/tileview/tilegenerations.h"
 
 namespace OpenApoc {
 
 class TileMap;
+class TileObject;
 class Image;
+class ImageSet;
+class SpriteList;
+class Renderer;
 
 class TileView : public Stage
 {
@@ -16,8 +24,88 @@ class TileView : public Stage
 		TileMap &map;
 		Vec3<int> tileSize;
 
+		//A sprite queued for drawing this frame, in back-to-front order
+		class DrawItem
+		{
+			public:
+				std::shared_ptr<Image> image;
+				Vec2<float> position;
+				const SpriteCoverage *coverage;
+		};
+		std::vector<DrawItem> drawItems;
+		//Scratch space for the opaque items when depth sorting, as their
+		//ImageSet and index into drawItems
+		std::vector<std::pair<ImageSet*, size_t>> opaqueItems;
+		OcclusionBuffer occlusion;
+		//Keyed by image - the weak_ptr catches an address being reused by a
+		//new image. Only valid for coveragePalette
+		std::map<Image*, std::pair<std::weak_ptr<Image>, std::unique_ptr<SpriteCoverage>>> coverage;
+		std::shared_ptr<Palette> coveragePalette;
+		const SpriteCoverage &getCoverage(std::shared_ptr<Image> image);
+
+		//With a depth buffer, the sprites of static objects (any not in
+		//map.activeObjects) are kept in a SpriteList per ChunkSize x
+		//ChunkSize tiles of each z level, only rebuilt when the map's
+		//staticGenerations says one of their tiles changed
+		static const int ChunkSize = TileGenerations::BlockSize;
+		//Things drawn in one tile get a depth each, the first and last
+		//reserved for the selection marker
+		static const int SlotsPerTile = TileVolume::SlotsPerTile;
+		class Chunk
+		{
+			public:
+				std::shared_ptr<SpriteList> sprites;
+				bool dirty;
+				//map.staticGenerations' count for the chunk when baked
+				uint32_t generation;
+		};
+		std::vector<Chunk> chunks;
+		Vec3<int> chunkCount;
+		//Translucency depends on the palette, so it was baked in too
+		std::shared_ptr<Palette> chunkPalette;
+		std::vector<Chunk*> visibleChunks;
+		//A sprite drawn translucently after the chunks
+		class DepthItem
+		{
+			public:
+				std::shared_ptr<Image> image;
+				Vec2<float> position;
+				float depth;
+		};
+		std::vector<DepthItem> translucentItems;
+		//The tiles of level z that might be on screen
+		VisibleTileRange visibleTiles(int z, int dpyWidth, int dpyHeight);
+		//The depth of the 'slot'th thing drawn in 'tile', matching the order
+		//tiles are painted in
+		float tileDepth(Vec3<int> tile, int slot);
+		void bakeChunk(Vec3<int> chunk, const std::vector<TileObject*> &active);
+		//Draws with the cached chunks, or the map's TileVolume
+		void renderCached(Renderer &r, int dpyWidth, int dpyHeight);
+		//Walks every tile in painter's order
+		void renderTiles(Renderer &r, int dpyWidth, int dpyHeight);
+
+		//Debug overlay numbers, for the last frame. spritesCulled is -1 if
+		//the path taken doesn't cull
+		int spritesDrawn, spritesCulled;
+		//Screen pixels in the bounds of the sprites drawn, over the screen
+		//area
+		float overdraw;
+		//Exponential moving average of the time Render() takes
+		float renderTimeMs;
+
 	public:
 		int maxZDraw;
+		//Skip sprites hidden behind the opaque parts of those in front
+		bool occlusionCulling;
+		//With a depth buffer, draw opaque sprites grouped by ImageSet so
+		//they batch, letting depth keep them in tile order
+		bool depthSorting;
+		//Draw static objects from the cached chunks when possible
+		bool staticCaching;
+		//When caching, draw the map's TileVolume instead of the chunks if
+		//it has one
+		bool gpuTiles;
+		bool showOverdraw;
 		int offsetX, offsetY;
 		int cameraScrollX, cameraScrollY;
 
@@ -8,6 +8,11 @@ Ufopaedia::Ufopaedia(Framework &fw)
 	: Stage(fw)
 {
 	menuform = fw.gamecore->GetForm("FORM_UFOPAEDIA_TITLE");
+
+	handlers.Bind( "BUTTON_QUIT", FormEventType::ButtonClick, [this](Event*)
+	{
+		stageCmd.cmd = StageCmd::Command::POP;
+	});
 }
 
 Ufopaedia::~Ufopaedia()
@@ -44,19 +49,11 @@ void Ufopaedia::EventOccurred(Event *e)
 		}
 	}
 
-	if( e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::ButtonClick )
+	if( !handlers.Dispatch( e ) && e->Type == EVENT_FORM_INTERACTION && e->Data.Forms.EventFlag == FormEventType::ButtonClick )
 	{
-		if( e->Data.Forms.RaisedBy->Name == "BUTTON_QUIT" )
-		{
-			stageCmd.cmd = StageCmd::Command::POP;
-			return;
-		}
-		else
-		{
-			//delete menuform;
-			menuform = fw.gamecore->GetForm("FORM_UFOPAEDIA_BASE");
-			return;
-		}
+		//delete menuform;
+		menuform = fw.gamecore->GetForm("FORM_UFOPAEDIA_BASE");
+		return;
 	}
 }
 
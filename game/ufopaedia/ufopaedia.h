@@ -15,6 +15,7 @@ class Ufopaedia : public Stage
 	private:
 		Form* menuform;
 		StageCmd stageCmd;
+		FormEventHandlers handlers;
 
 
 	public:
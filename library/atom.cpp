@@ -0,0 +1,69 @@
+#include "library/atom.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace OpenApoc {
+
+namespace {
+
+class AtomTable
+{
+private:
+	std::mutex tableMutex;
+	std::unordered_map<std::string, uint32_t> ids;
+	//deque so references handed out by Atom::str() stay valid as it grows
+	std::deque<UString> strings;
+public:
+	AtomTable()
+	{
+		this->intern("");
+	}
+
+	uint32_t intern(const UString &str)
+	{
+		std::lock_guard<std::mutex> lock(tableMutex);
+		auto it = ids.find(str.str());
+		if (it != ids.end())
+			return it->second;
+		uint32_t id = strings.size();
+		strings.push_back(str);
+		ids[str.str()] = id;
+		return id;
+	}
+
+	const UString& lookup(uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(tableMutex);
+		return strings[id];
+	}
+};
+
+AtomTable& getAtomTable()
+{
+	static AtomTable table;
+	return table;
+}
+
+}; //anonymous namespace
+
+Atom::Atom()
+	: id(0)
+{}
+
+Atom::Atom(const UString &str)
+	: id(getAtomTable().intern(str))
+{}
+
+Atom::Atom(const char *cstr)
+	: id(getAtomTable().intern(UString(cstr)))
+{}
+
+const UString&
+Atom::str() const
+{
+	return getAtomTable().lookup(this->id);
+}
+
+}; //namespace OpenApoc
@@ -0,0 +1,31 @@
+
+#pragma once
+
+#include "library/strings.h"
+
+namespace OpenApoc {
+
+//An interned string. Atoms created from equal strings share the same ID, so
+//comparing two Atoms is a single integer compare. Meant for identifiers that
+//are compared over and over (control IDs and the like) - interned strings are
+//never freed.
+class Atom
+{
+private:
+	uint32_t id;
+public:
+	//The default Atom is the empty string
+	Atom();
+	explicit Atom(const UString &str);
+	explicit Atom(const char *cstr);
+
+	const UString& str() const;
+	uint32_t getID() const { return id; }
+
+	bool operator==(const Atom &other) const { return id == other.id; }
+	bool operator!=(const Atom &other) const { return id != other.id; }
+	//Orders by interning order, not by string contents
+	bool operator<(const Atom &other) const { return id < other.id; }
+};
+
+}; //namespace OpenApoc
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <list>
+#include <map>
+
+namespace OpenApoc {
+
+//Map that keeps only the 'capacity' most recently used entries
+template <typename Key, typename Value>
+class LRUCache
+{
+	private:
+		//Most recently used first
+		typedef std::list<std::pair<Key, Value>> EntryList;
+		EntryList entries;
+		std::map<Key, typename EntryList::iterator> index;
+		size_t capacity;
+
+	public:
+		LRUCache(size_t capacity) : capacity(capacity) {}
+
+		//Returns a default-constructed Value if key isn't cached
+		Value get(const Key &key)
+		{
+			auto it = this->index.find(key);
+			if (it == this->index.end())
+				return Value();
+			this->entries.splice(this->entries.begin(), this->entries, it->second);
+			return it->second->second;
+		}
+
+		void put(const Key &key, const Value &value)
+		{
+			auto it = this->index.find(key);
+			if (it != this->index.end())
+			{
+				it->second->second = value;
+				this->entries.splice(this->entries.begin(), this->entries, it->second);
+				return;
+			}
+			this->entries.emplace_front(key, value);
+			this->index[key] = this->entries.begin();
+			if (this->entries.size() > this->capacity)
+			{
+				this->index.erase(this->entries.back().first);
+				this->entries.pop_back();
+			}
+		}
+
+		void clear()
+		{
+			this->entries.clear();
+			this->index.clear();
+		}
+
+		size_t size() const
+		{
+			return this->entries.size();
+		}
+};
+
+}; //namespace OpenApoc
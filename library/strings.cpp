@@ -2,6 +2,7 @@
 
 #include <unicode/unistr.h>
 #include <unicode/umachine.h>
+#include <cwchar>
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -10,145 +11,375 @@
 namespace OpenApoc
 {
 
-class UString::UString_impl : public icu::UnicodeString
+namespace {
+
+bool isContinuationByte(char c)
+{
+	return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+//Decodes the utf8 sequence starting at 'pos' into 'c', returns the number of
+//bytes consumed. Invalid sequences decode as U+FFFD and consume one byte, the
+//same as ICU's UTF-8 converter did.
+size_t decodeUTF8(const std::string &s, size_t pos, UniChar &c)
+{
+	const unsigned char lead = static_cast<unsigned char>(s[pos]);
+	if (lead < 0x80)
+	{
+		c = lead;
+		return 1;
+	}
+	size_t len;
+	UniChar min;
+	if ((lead & 0xE0) == 0xC0)
+	{
+		len = 2;
+		min = 0x80;
+		c = lead & 0x1F;
+	}
+	else if ((lead & 0xF0) == 0xE0)
+	{
+		len = 3;
+		min = 0x800;
+		c = lead & 0x0F;
+	}
+	else if ((lead & 0xF8) == 0xF0)
+	{
+		len = 4;
+		min = 0x10000;
+		c = lead & 0x07;
+	}
+	else
+	{
+		c = 0xFFFD;
+		return 1;
+	}
+	if (pos + len > s.length())
+	{
+		c = 0xFFFD;
+		return 1;
+	}
+	for (size_t i = 1; i < len; i++)
+	{
+		if (!isContinuationByte(s[pos+i]))
+		{
+			c = 0xFFFD;
+			return 1;
+		}
+		c = (c << 6) | (static_cast<unsigned char>(s[pos+i]) & 0x3F);
+	}
+	if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+	{
+		c = 0xFFFD;
+		return 1;
+	}
+	return len;
+}
+
+void encodeUTF8(UniChar c, std::string &out)
 {
-public:
-	UString_impl(const std::string str)
-		: icu::UnicodeString(str.c_str(), "UTF-8")
-	{}
-	UString_impl(const UChar *ucstr, int len)
-		: icu::UnicodeString()
+	if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+		c = 0xFFFD;
+	if (c < 0x80)
+	{
+		out += static_cast<char>(c);
+	}
+	else if (c < 0x800)
+	{
+		out += static_cast<char>(0xC0 | (c >> 6));
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000)
 	{
-		this->setTo(ucstr, len);
+		out += static_cast<char>(0xE0 | (c >> 12));
+		out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (c & 0x3F));
 	}
-	UString_impl(const char* str)
-		: icu::UnicodeString(str, "UTF-8")
-	{}
-	UString_impl(const UString_impl &other)
-		: icu::UnicodeString(other)
-	{}
+	else
+	{
+		out += static_cast<char>(0xF0 | (c >> 18));
+		out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+		out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+		out += static_cast<char>(0x80 | (c & 0x3F));
+	}
+}
+
+bool isASCII(const std::string &s)
+{
+	for (char c : s)
+	{
+		if (static_cast<unsigned char>(c) >= 0x80)
+			return false;
+	}
+	return true;
+}
+
+std::string fromWide(const wchar_t *wcstr, size_t len)
+{
+	std::string out;
+	out.reserve(len);
+	for (size_t i = 0; i < len; i++)
+	{
+		UniChar c = static_cast<UniChar>(wcstr[i]);
+		//wchar_t is utf16 on windows, so may contain surrogate pairs
+		if (sizeof(wchar_t) == 2 && c >= 0xD800 && c <= 0xDBFF && i+1 < len)
+		{
+			UniChar low = static_cast<UniChar>(wcstr[i+1]);
+			if (low >= 0xDC00 && low <= 0xDFFF)
+			{
+				c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+				i++;
+			}
+		}
+		encodeUTF8(c, out);
+	}
+	return out;
+}
 
-};
+}; //anonymous namespace
 
 UString::~UString()
 {}
 
 UString::UString()
-	: pimpl(new UString_impl(""))
+	: ascii(true)
 {}
 
 UString::UString(std::string str)
-	: pimpl(new UString_impl(str))
+	: u8Str(std::move(str)), ascii(isASCII(u8Str))
+{}
+
+UString::UString(std::wstring wstr)
+	: u8Str(fromWide(wstr.c_str(), wstr.length())), ascii(isASCII(u8Str))
 {}
 
 UString::UString(char c)
-	: pimpl(new UString_impl(std::string(1, c)))
+	: u8Str(1, c), ascii(isASCII(u8Str))
+{}
+
+UString::UString(wchar_t wc)
+	: u8Str(fromWide(&wc, 1)), ascii(isASCII(u8Str))
 {}
 
 UString::UString(const char *cstr)
-	:pimpl(new UString_impl(cstr))
+	: u8Str(cstr), ascii(isASCII(u8Str))
+{}
+
+UString::UString(const wchar_t *wcstr)
+	: u8Str(fromWide(wcstr, wcslen(wcstr))), ascii(isASCII(u8Str))
 {}
 
+UString::UString(const UniChar *ucstr)
+{
+	for (; *ucstr; ucstr++)
+		encodeUTF8(*ucstr, this->u8Str);
+	this->ascii = isASCII(this->u8Str);
+}
+
 UString::UString(const UString& other)
-	:pimpl(new UString_impl(*other.pimpl.get()))
+	: u8Str(other.u8Str), ascii(other.ascii)
 {}
 
 UString::UString(UString&& other)
+	: u8Str(std::move(other.u8Str)), ascii(other.ascii)
 {
-	this->pimpl = std::move(other.pimpl);
+	other.u8Str.clear();
+	other.ascii = true;
 }
 
 UString::UString(UniChar uc)
-	:pimpl(new UString_impl(""))
 {
-	pimpl->setTo((UChar32)uc);
+	encodeUTF8(uc, this->u8Str);
+	this->ascii = uc < 0x80;
 }
 
-std::string
+const std::string&
 UString::str() const
 {
-	std::string str;
-	this->pimpl->toUTF8String(str);
-	return str;
-};
+	return this->u8Str;
+}
+
+std::wstring
+UString::wstr() const
+{
+	std::wstring out;
+	out.reserve(this->u8Str.length());
+	for (auto c : *this)
+	{
+		if (sizeof(wchar_t) == 2 && c >= 0x10000)
+		{
+			c -= 0x10000;
+			out += static_cast<wchar_t>(0xD800 + (c >> 10));
+			out += static_cast<wchar_t>(0xDC00 + (c & 0x3FF));
+		}
+		else
+			out += static_cast<wchar_t>(c);
+	}
+	return out;
+}
+
+size_t
+UString::byteOffset(size_t pos, size_t start) const
+{
+	const size_t len = this->u8Str.length();
+	if (this->ascii)
+		return std::min(len, start + std::min(pos, len - start));
+	size_t offset = start;
+	while (pos > 0 && offset < len)
+	{
+		offset++;
+		while (offset < len && isContinuationByte(this->u8Str[offset]))
+			offset++;
+		pos--;
+	}
+	return offset;
+}
 
 bool
 UString::operator<(const UString& other) const
 {
-	return (*this->pimpl) < (*other.pimpl);
+	return this->u8Str < other.u8Str;
 }
 
 bool
 UString::operator==(const UString& other) const
 {
-	return (*this->pimpl) == (*other.pimpl);
+	return this->u8Str == other.u8Str;
 }
 
 UString
 UString::substr(size_t offset, size_t length) const
 {
-	UString other;
-	other.pimpl->setTo(*this->pimpl, offset, length);
-	return other;
+	size_t begin = this->byteOffset(offset);
+	if (length == npos)
+		return UString(this->u8Str.substr(begin));
+	size_t end = this->byteOffset(length, begin);
+	return UString(this->u8Str.substr(begin, end - begin));
 }
 
 UString
 UString::toUpper() const
 {
-	UString other;
-	other.pimpl->setTo(this->pimpl->toUpper());
-	return other;
+	if (this->ascii)
+	{
+		UString other(*this);
+		for (auto &c : other.u8Str)
+		{
+			if (c >= 'a' && c <= 'z')
+				c -= 'a' - 'A';
+		}
+		return other;
+	}
+	std::string upper;
+	icu::UnicodeString::fromUTF8(this->u8Str).toUpper().toUTF8String(upper);
+	return UString(std::move(upper));
+}
+
+UString
+UString::toLower() const
+{
+	if (this->ascii)
+	{
+		UString other(*this);
+		for (auto &c : other.u8Str)
+		{
+			if (c >= 'A' && c <= 'Z')
+				c += 'a' - 'A';
+		}
+		return other;
+	}
+	std::string lower;
+	icu::UnicodeString::fromUTF8(this->u8Str).toLower().toUTF8String(lower);
+	return UString(std::move(lower));
 }
 
 UString&
 UString::operator=(const UString& other)
 {
-	this->pimpl->setTo(*other.pimpl);
+	this->u8Str = other.u8Str;
+	this->ascii = other.ascii;
+	return *this;
+}
+
+UString&
+UString::operator=(UString&& other)
+{
+	this->u8Str = std::move(other.u8Str);
+	this->ascii = other.ascii;
+	other.u8Str.clear();
+	other.ascii = true;
 	return *this;
 }
 
 UString&
 UString::operator+=(const UString& other)
 {
-	*this->pimpl += *other.pimpl;
+	this->u8Str += other.u8Str;
+	this->ascii = this->ascii && other.ascii;
 	return *this;
 }
 
 UniChar
 UString::operator[](size_t pos) const
 {
-	return this->pimpl->char32At(pos);
+	if (this->ascii)
+		return pos < this->u8Str.length() ? (UniChar)this->u8Str[pos] : 0xFFFF;
+	size_t offset = this->byteOffset(pos);
+	if (offset >= this->u8Str.length())
+		return 0xFFFF;
+	UniChar c;
+	decodeUTF8(this->u8Str, offset, c);
+	return c;
 }
 
 size_t
 UString::length() const
 {
-	return this->pimpl->countChar32();
+	if (this->ascii)
+		return this->u8Str.length();
+	size_t count = 0;
+	for (char c : this->u8Str)
+	{
+		if (!isContinuationByte(c))
+			count++;
+	}
+	return count;
+}
+
+bool
+UString::empty() const
+{
+	return this->u8Str.empty();
 }
 
 void
 UString::insert(size_t offset, const UString &other)
 {
-	this->pimpl->insert(offset, *other.pimpl);
+	this->u8Str.insert(this->byteOffset(offset), other.u8Str);
+	this->ascii = this->ascii && other.ascii;
 }
 
 void
 UString::remove(size_t offset, size_t count)
 {
-	this->pimpl->remove(offset, count);
+	size_t begin = this->byteOffset(offset);
+	size_t end = this->byteOffset(count, begin);
+	this->u8Str.erase(begin, end - begin);
+	//Removing the only multibyte characters leaves it ASCII
+	if (!this->ascii)
+		this->ascii = isASCII(this->u8Str);
 }
 
 bool
 UString::operator!=(const UString& other) const
 {
-	return *this->pimpl != *other.pimpl;
+	return this->u8Str != other.u8Str;
 }
 
 
 UString operator+(const UString& lhs, const UString& rhs)
 {
-	UString s;
-	s += lhs;
+	UString s(lhs);
 	s += rhs;
 	return s;
 }
@@ -157,22 +388,43 @@ std::vector<UString>
 UString::split(const UString& delims) const
 {
 	std::vector<UString> strings;
-	strings.push_back("");
-	for (auto c : *this)
+	size_t tokenStart = 0;
+	size_t pos = 0;
+	const size_t len = this->u8Str.length();
+	const bool asciiDelims = isASCII(delims.u8Str);
+	while (pos < len)
 	{
-			bool delim = false;
+		size_t charLen;
+		bool delim;
+		if (asciiDelims)
+		{
+			//A multibyte sequence never contains ASCII bytes, so a
+			//bytewise search is safe
+			charLen = 1;
+			delim = delims.u8Str.find(this->u8Str[pos]) != std::string::npos;
+		}
+		else
+		{
+			UniChar c;
+			charLen = decodeUTF8(this->u8Str, pos, c);
+			delim = false;
 			for (auto d : delims)
 			{
-					if (c == d)
-					{
-							strings.push_back("");
-							delim = true;
-							break;
-					}
+				if (c == d)
+				{
+					delim = true;
+					break;
+				}
 			}
-			if (!delim)
-					strings.back() += c;
+		}
+		if (delim)
+		{
+			strings.emplace_back(this->u8Str.substr(tokenStart, pos - tokenStart));
+			tokenStart = pos + charLen;
+		}
+		pos += charLen;
 	}
+	strings.emplace_back(this->u8Str.substr(tokenStart));
 	return strings;
 }
 
@@ -187,7 +439,8 @@ UString::u8Char(char c)
 int
 UString::compare(const UString &other) const
 {
-	return this->pimpl->compare(*other.pimpl);
+	int r = this->u8Str.compare(other.u8Str);
+	return (r < 0) ? -1 : (r > 0) ? 1 : 0;
 }
 
 UString::const_iterator
@@ -199,34 +452,36 @@ UString::begin() const
 UString::const_iterator
 UString::end() const
 {
-	return UString::const_iterator(*this, this->length());
+	return UString::const_iterator(*this, this->u8Str.length());
 }
 
 UString::const_iterator
 UString::const_iterator::operator++()
 {
-	this->offset++;
+	UniChar c;
+	this->offset += decodeUTF8(this->s.u8Str, this->offset, c);
 	return *this;
 }
 
 bool
 UString::const_iterator::operator!=(const UString::const_iterator &other) const
 {
-	return (this->offset != other.offset || this->s != other.s);
+	return (this->offset != other.offset || &this->s != &other.s);
 }
 
 UniChar
 UString::const_iterator::operator*() const
 {
-	return this->s[this->offset];
+	UniChar c;
+	decodeUTF8(this->s.u8Str, this->offset, c);
+	return c;
 }
 
 
 int
 Strings::ToInteger(const UString &s)
 {
-	std::string u8str = s.str();
-	return (int)strtol(u8str.c_str(), NULL, 0);
+	return (int)strtol(s.str().c_str(), NULL, 0);
 }
 
 uint8_t
@@ -238,7 +493,7 @@ Strings::ToU8(const UString &s)
 bool
 Strings::IsNumeric(const UString &s)
 {
-	std::string u8str = s.str();
+	const std::string &u8str = s.str();
 	char *endpos;
 	std::ignore = strtol(u8str.c_str(), &endpos, 0);
 	return (endpos != u8str.c_str());
@@ -12,8 +12,14 @@ typedef uint32_t UniChar;
 class UString
 {
 private:
-	class UString_impl;
-	std::unique_ptr<UString_impl> pimpl;
+	//Stored as utf8 - std::string keeps short strings inline (SSO), so
+	//most UStrings (control names, resource paths) never touch the heap
+	std::string u8Str;
+	//True if every byte is ASCII, so codepoint offsets are byte offsets.
+	//Kept up to date by everything that changes u8Str
+	bool ascii;
+	//Byte offset of the codepoint 'pos', or u8Str.length() if past the end
+	size_t byteOffset(size_t pos, size_t start = 0) const;
 public:
 	//ASSUMPTIONS:
 	//All std::string/char are utf8
@@ -33,8 +39,10 @@ public:
 
 	UString(const UString &other);
 	UString& operator=(const UString &other);
+	UString& operator=(UString &&other);
 
-	std::string str() const;
+	//Returns the underlying utf8 storage - no conversion is done
+	const std::string& str() const;
 	std::wstring wstr() const;
 
 	UString toUpper() const;
@@ -62,6 +70,7 @@ public:
 	
 
 	int compare(const UString& str) const;
+	bool empty() const;
 
 	bool operator==(const UString& other) const;
 	bool operator!=(const UString& other) const;
@@ -77,6 +86,7 @@ public:
 			: s(s), offset(initial_offset){};
 	public:
 		//Just enough to struggle through a range-based for
+		//'offset' is the byte offset into the utf8 storage
 		bool operator != (const const_iterator &other) const;
 		const_iterator operator ++ ();
 		UniChar operator*() const;
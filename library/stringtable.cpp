@@ -0,0 +1,231 @@
+#include "library/stringtable.h"
+
+#include <cstring>
+
+namespace OpenApoc {
+
+namespace {
+
+const char stringTableMagic[8] = {'O', 'A', 'S', 'T', 'R', 'T', 'A', 'B'};
+const uint32_t stringTableVersion = 1;
+
+//FNV-1a
+uint32_t hashString(const char *str, size_t length)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void writeU32(std::string &out, uint32_t val)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((char)((val >> (i * 8)) & 0xff));
+}
+
+bool readU32(const char *&data, const char *end, uint32_t &val)
+{
+	if (end - data < 4)
+		return false;
+	val = 0;
+	for (int i = 0; i < 4; i++)
+		val |= (uint32_t)(uint8_t)data[i] << (i * 8);
+	data += 4;
+	return true;
+}
+
+}; //anonymous namespace
+
+StringTable::StringTable()
+{
+	this->clear();
+}
+
+void
+StringTable::clear()
+{
+	this->blob.clear();
+	this->entries.clear();
+	this->index.assign(16, 0);
+}
+
+size_t
+StringTable::size() const
+{
+	return this->entries.size();
+}
+
+uint32_t
+StringTable::append(const std::string &str)
+{
+	uint32_t offset = this->blob.size();
+	this->blob.append(str);
+	this->blob.push_back('\0');
+	return offset;
+}
+
+size_t
+StringTable::findSlot(const char *key, size_t length, uint32_t hash) const
+{
+	const size_t mask = this->index.size() - 1;
+	size_t slot = hash & mask;
+	while (this->index[slot] != 0)
+	{
+		const Entry &e = this->entries[this->index[slot] - 1];
+		if (e.hash == hash && e.keyLength == length &&
+		    memcmp(this->blob.data() + e.keyOffset, key, length) == 0)
+			break;
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void
+StringTable::rebuildIndex(size_t buckets)
+{
+	this->index.assign(buckets, 0);
+	const size_t mask = buckets - 1;
+	for (size_t i = 0; i < this->entries.size(); i++)
+	{
+		size_t slot = this->entries[i].hash & mask;
+		while (this->index[slot] != 0)
+			slot = (slot + 1) & mask;
+		this->index[slot] = i + 1;
+	}
+}
+
+void
+StringTable::add(const UString &ID, const UString &value)
+{
+	const std::string &key = ID.str();
+	uint32_t hash = hashString(key.data(), key.length());
+	size_t slot = this->findSlot(key.data(), key.length(), hash);
+	if (this->index[slot] != 0)
+	{
+		//The old value is left in the blob - redefinitions are rare
+		Entry &e = this->entries[this->index[slot] - 1];
+		e.valueOffset = this->append(value.str());
+		e.valueLength = value.str().length();
+		return;
+	}
+
+	Entry e;
+	e.hash = hash;
+	e.keyOffset = this->append(key);
+	e.keyLength = key.length();
+	e.valueOffset = this->append(value.str());
+	e.valueLength = value.str().length();
+	this->entries.push_back(e);
+
+	//Keep the index at most half full so probe runs stay short
+	if (this->entries.size() * 2 > this->index.size())
+		this->rebuildIndex(this->index.size() * 2);
+	else
+		this->index[slot] = this->entries.size();
+}
+
+const char *
+StringTable::lookup(const UString &ID) const
+{
+	const std::string &key = ID.str();
+	size_t slot = this->findSlot(key.data(), key.length(), hashString(key.data(), key.length()));
+	if (this->index[slot] == 0)
+		return nullptr;
+	return this->blob.data() + this->entries[this->index[slot] - 1].valueOffset;
+}
+
+void
+StringTable::merge(const StringTable &other)
+{
+	for (auto &e : other.entries)
+	{
+		this->add(UString(other.blob.substr(e.keyOffset, e.keyLength)),
+			UString(other.blob.substr(e.valueOffset, e.valueLength)));
+	}
+}
+
+std::string
+StringTable::serialise() const
+{
+	std::string out(stringTableMagic, sizeof(stringTableMagic));
+	writeU32(out, stringTableVersion);
+	writeU32(out, this->entries.size());
+	writeU32(out, this->index.size());
+	writeU32(out, this->blob.size());
+	for (auto &e : this->entries)
+	{
+		writeU32(out, e.hash);
+		writeU32(out, e.keyOffset);
+		writeU32(out, e.keyLength);
+		writeU32(out, e.valueOffset);
+		writeU32(out, e.valueLength);
+	}
+	for (auto i : this->index)
+		writeU32(out, i);
+	out.append(this->blob);
+	return out;
+}
+
+bool
+StringTable::deserialise(const char *data, size_t length)
+{
+	this->clear();
+	const char *end = data + length;
+	if (length < sizeof(stringTableMagic) || memcmp(data, stringTableMagic, sizeof(stringTableMagic)) != 0)
+		return false;
+	data += sizeof(stringTableMagic);
+
+	uint32_t version, entryCount, indexSize, blobSize;
+	if (!readU32(data, end, version) || version != stringTableVersion)
+		return false;
+	if (!readU32(data, end, entryCount) || !readU32(data, end, indexSize) || !readU32(data, end, blobSize))
+		return false;
+	//The index must be a power of two with at least one empty slot, or
+	//lookups of missing keys would never terminate
+	if (indexSize == 0 || (indexSize & (indexSize - 1)) != 0 || indexSize <= entryCount)
+		return false;
+	if ((uint64_t)(end - data) != (uint64_t)entryCount * 20 + (uint64_t)indexSize * 4 + blobSize)
+		return false;
+
+	std::vector<Entry> newEntries(entryCount);
+	for (auto &e : newEntries)
+	{
+		readU32(data, end, e.hash);
+		readU32(data, end, e.keyOffset);
+		readU32(data, end, e.keyLength);
+		readU32(data, end, e.valueOffset);
+		readU32(data, end, e.valueLength);
+		if ((uint64_t)e.keyOffset + e.keyLength >= blobSize ||
+		    (uint64_t)e.valueOffset + e.valueLength >= blobSize)
+			return false;
+	}
+	std::vector<uint32_t> newIndex(indexSize);
+	size_t usedSlots = 0;
+	for (auto &i : newIndex)
+	{
+		readU32(data, end, i);
+		if (i > entryCount)
+			return false;
+		if (i != 0)
+			usedSlots++;
+	}
+	if (usedSlots != entryCount)
+		return false;
+	std::string newBlob(data, blobSize);
+	for (auto &e : newEntries)
+	{
+		if (newBlob[e.keyOffset + e.keyLength] != '\0' || newBlob[e.valueOffset + e.valueLength] != '\0')
+			return false;
+	}
+
+	this->entries = std::move(newEntries);
+	this->index = std::move(newIndex);
+	this->blob = std::move(newBlob);
+	return true;
+}
+
+}; //namespace OpenApoc
@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include "library/strings.h"
+
+namespace OpenApoc {
+
+//Read-mostly map of string ID to text. Every key and value lives in one
+//contiguous utf8 blob, found through an open-addressed hash index, so a
+//lookup touches no heap besides the blob and returns a pointer into it.
+//The table can be saved to (and loaded from) a flat binary image, which
+//loads without parsing or re-hashing anything.
+class StringTable
+{
+private:
+	struct Entry
+	{
+		uint32_t hash;
+		uint32_t keyOffset;
+		uint32_t keyLength;
+		uint32_t valueOffset;
+		uint32_t valueLength;
+	};
+	//Each key and value is followed by a NUL, so lookups can hand out C
+	//strings
+	std::string blob;
+	std::vector<Entry> entries;
+	//Linear probing, power-of-two sized. Holds entry index + 1, 0 is empty
+	std::vector<uint32_t> index;
+
+	uint32_t append(const std::string &str);
+	void rebuildIndex(size_t buckets);
+	//Returns the slot in 'index' holding the key, or the empty slot it
+	//would go in
+	size_t findSlot(const char *key, size_t length, uint32_t hash) const;
+
+public:
+	StringTable();
+
+	//Replaces the value if ID is already in the table
+	void add(const UString &ID, const UString &value);
+	//Returns nullptr if ID isn't in the table. The pointer stays valid until
+	//the table is next modified
+	const char *lookup(const UString &ID) const;
+	size_t size() const;
+	void clear();
+	//Adds every string in 'other', replacing any IDs already here
+	void merge(const StringTable &other);
+
+	std::string serialise() const;
+	//Replaces the contents of the table. Returns false (leaving the table
+	//empty) if 'data' isn't a valid string table image
+	bool deserialise(const char *data, size_t length);
+};
+
+}; //namespace OpenApoc
@@ -0,0 +1,58 @@
+#include "framework/palette_expand.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+//Compares the throughput of the palette expansion kernels. Not run as part of
+//the test suite - run by hand and compare the output.
+
+using namespace OpenApoc;
+
+namespace {
+
+typedef void (*ExpandFunction)(const Colour*, const uint8_t*, Colour*, size_t);
+
+volatile uint8_t sink = 0;
+
+void benchmark(const char *name, ExpandFunction expand, const Colour *table,
+	const std::vector<uint8_t> &indices, std::vector<Colour> &out, int iterations)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		expand(table, indices.data(), out.data(), indices.size());
+		sink += out[i % out.size()].r;
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration<double>(endTime - startTime).count();
+	double pixels = (double)indices.size() * iterations;
+	printf("%s: %.1f Mpixels/s (%d x %u pixels in %.3f s)\n",
+		name, pixels / seconds / 1000000.0, iterations, (unsigned)indices.size(), seconds);
+}
+
+}; //anonymous namespace
+
+int main(int argc, char **argv)
+{
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> byte(0, 255);
+
+	Colour table[256];
+	for (int i = 0; i < 256; i++)
+		table[i] = Colour(byte(rng), byte(rng), byte(rng), byte(rng));
+
+	//Roughly a 640x480 screen worth of palette sprites
+	std::vector<uint8_t> indices(640*480);
+	for (auto &i : indices)
+		i = byte(rng);
+	std::vector<Colour> out(indices.size());
+
+	const int iterations = 500;
+	benchmark("PaletteExpandScalar", PaletteExpandScalar, table, indices, out, iterations);
+	if (PaletteExpandSIMDSupported())
+		benchmark("PaletteExpandSIMD", PaletteExpandSIMD, table, indices, out, iterations);
+	else
+		printf("PaletteExpandSIMD: not supported on this CPU\n");
+	return EXIT_SUCCESS;
+}
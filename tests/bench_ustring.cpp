@@ -0,0 +1,202 @@
+#include "library/strings.h"
+#include <cstdio>
+
+#include <unicode/unistr.h>
+#include <unicode/uclean.h>
+#include <chrono>
+#include <new>
+
+//Compares UString against the previous ICU-backed implementation (kept here
+//as LegacyUString). Not run as part of the test suite - run by hand and
+//compare the output.
+
+using namespace OpenApoc;
+
+static size_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+	allocationCount++;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+//ICU objects (UMemory) allocate through ICU's own allocator, not operator new
+static void* U_CALLCONV icuAlloc(const void *context, size_t size)
+{
+	std::ignore = context;
+	allocationCount++;
+	return malloc(size);
+}
+
+static void* U_CALLCONV icuRealloc(const void *context, void *mem, size_t size)
+{
+	std::ignore = context;
+	allocationCount++;
+	return realloc(mem, size);
+}
+
+static void U_CALLCONV icuFree(const void *context, void *mem)
+{
+	std::ignore = context;
+	free(mem);
+}
+
+namespace {
+
+//The old UString - every instance holds a heap-allocated icu::UnicodeString
+class LegacyUString
+{
+private:
+	std::unique_ptr<icu::UnicodeString> pimpl;
+public:
+	LegacyUString()
+		: pimpl(new icu::UnicodeString(""))
+	{}
+	LegacyUString(const char *cstr)
+		: pimpl(new icu::UnicodeString(cstr, "UTF-8"))
+	{}
+	LegacyUString(const LegacyUString &other)
+		: pimpl(new icu::UnicodeString(*other.pimpl))
+	{}
+	LegacyUString(UniChar uc)
+		: pimpl(new icu::UnicodeString(""))
+	{
+		pimpl->setTo((UChar32)uc);
+	}
+	std::string str() const
+	{
+		std::string str;
+		pimpl->toUTF8String(str);
+		return str;
+	}
+	LegacyUString toUpper() const
+	{
+		LegacyUString other;
+		other.pimpl->setTo(pimpl->toUpper());
+		return other;
+	}
+	LegacyUString substr(size_t offset, size_t length) const
+	{
+		LegacyUString other;
+		other.pimpl->setTo(*pimpl, offset, length);
+		return other;
+	}
+	UniChar operator[](size_t pos) const
+	{
+		return pimpl->char32At(pos);
+	}
+	size_t length() const
+	{
+		return pimpl->countChar32();
+	}
+	LegacyUString& operator+=(const LegacyUString &other)
+	{
+		*pimpl += *other.pimpl;
+		return *this;
+	}
+	bool operator==(const LegacyUString &other) const
+	{
+		return *pimpl == *other.pimpl;
+	}
+	bool operator<(const LegacyUString &other) const
+	{
+		return *pimpl < *other.pimpl;
+	}
+	std::vector<LegacyUString> split(const LegacyUString &delims) const
+	{
+		std::vector<LegacyUString> strings;
+		strings.push_back("");
+		for (size_t i = 0; i < length(); i++)
+		{
+			UniChar c = (*this)[i];
+			bool delim = false;
+			for (size_t j = 0; j < delims.length(); j++)
+			{
+				if (c == delims[j])
+				{
+					strings.push_back("");
+					delim = true;
+					break;
+				}
+			}
+			if (!delim)
+				strings.back() += LegacyUString(c);
+		}
+		return strings;
+	}
+};
+
+const int iterations = 100000;
+volatile size_t sink = 0;
+
+template <typename StringType>
+void benchmark(const char *name)
+{
+	const char *path = "PCK:xcom3/ufodata/city.pck:xcom3/ufodata/city.tab:42";
+	StringType controlName("BUTTON_QUIT");
+	StringType other("BUTTON_OPTIONS");
+
+	size_t startAllocs = allocationCount;
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	for (int i = 0; i < iterations; i++)
+	{
+		StringType empty;
+		StringType s(path);
+		sink += s.str().length();
+		sink += s.toUpper().length();
+		sink += s.split(":").size();
+		sink += s.substr(4, 20)[3];
+		sink += (controlName == other);
+		sink += (controlName < other);
+		sink += empty.length();
+	}
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+	printf("%s: %d iterations in %d ms, %u allocations (%.1f per iteration)\n",
+		name, iterations, (int)ms.count(), (unsigned)(allocationCount - startAllocs),
+		(double)(allocationCount - startAllocs) / iterations);
+}
+
+template <typename StringType>
+void countAllocations(const char *name, const char *value)
+{
+	size_t startAllocs = allocationCount;
+	{
+		StringType s(value);
+		sink += s.str().length();
+	}
+	printf("%s: constructing \"%s\" and calling str(): %u allocations\n",
+		name, value, (unsigned)(allocationCount - startAllocs));
+}
+
+}; //anonymous namespace
+
+int main(int argc, char **argv)
+{
+	UErrorCode err = U_ZERO_ERROR;
+	u_setMemoryFunctions(nullptr, icuAlloc, icuRealloc, icuFree, &err);
+	if (U_FAILURE(err))
+	{
+		printf("Failed to set ICU memory functions: %s\n", u_errorName(err));
+		return EXIT_FAILURE;
+	}
+
+	countAllocations<LegacyUString>("LegacyUString", "");
+	countAllocations<UString>("UString", "");
+	countAllocations<LegacyUString>("LegacyUString", "BUTTON_QUIT");
+	countAllocations<UString>("UString", "BUTTON_QUIT");
+
+	benchmark<LegacyUString>("LegacyUString");
+	benchmark<UString>("UString");
+	return EXIT_SUCCESS;
+}
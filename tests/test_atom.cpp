@@ -0,0 +1,46 @@
+#include "library/atom.h"
+#include "framework/logger.h"
+
+using namespace OpenApoc;
+
+void test_atom_equal(const UString &s1, const UString &s2, bool expected)
+{
+	Atom a1(s1), a2(s2);
+	if ((a1 == a2) != expected || (a1 != a2) == expected)
+	{
+		LogError("Atoms \"%s\" and \"%s\" incorrectly %s",
+			s1.str().c_str(), s2.str().c_str(), expected ? "not equal" : "equal");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_atom_str(const UString &s)
+{
+	Atom a(s);
+	if (a.str() != s)
+	{
+		LogError("Atom \"%s\" returned string \"%s\"",
+			s.str().c_str(), a.str().str().c_str());
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	test_atom_equal("BUTTON_QUIT", "BUTTON_QUIT", true);
+	test_atom_equal("BUTTON_QUIT", "BUTTON_OPTIONS", false);
+	test_atom_equal("BUTTON_QUIT", "button_quit", false);
+	test_atom_equal("", "", true);
+
+	test_atom_str("BUTTON_QUIT");
+	test_atom_str("Z\xC3\xBCrich");
+	test_atom_str("");
+
+	if (Atom() != Atom(""))
+	{
+		LogError("Default atom is not the empty string");
+		exit(EXIT_FAILURE);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include "framework/image.h"
+#include "framework/logger.h"
+
+using namespace OpenApoc;
+
+std::shared_ptr<PaletteImage> make_image(Vec2<unsigned int> size, std::vector<uint8_t> pixels)
+{
+	auto img = std::make_shared<PaletteImage>(size);
+	PaletteImageLock l(img, ImageLockUse::Write);
+	for (unsigned int i = 0; i < size.x * size.y; i++)
+		static_cast<uint8_t*>(l.getData())[i] = pixels[i];
+	return img;
+}
+
+void test_image(const char *name, std::shared_ptr<PaletteImage> img, std::vector<uint8_t> expected)
+{
+	PaletteImageLock l(img, ImageLockUse::Read);
+	for (unsigned int i = 0; i < img->size.x * img->size.y; i++)
+	{
+		uint8_t got = static_cast<uint8_t*>(l.getData())[i];
+		if (got != expected[i])
+		{
+			LogError("%s: pixel {%u,%u} is %d, expected %d", name,
+				i % img->size.x, i / img->size.x, got, expected[i]);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	auto src = make_image({3,2}, {
+		1, 0, 2,
+		3, 4, 0,
+	});
+
+	//Opaque, overhanging the right and bottom edges
+	auto dst = make_image({4,3}, std::vector<uint8_t>(12, 9));
+	PaletteImage::blit(src, Vec2<unsigned int>{2,2}, dst);
+	test_image("overhang", dst, {
+		9, 9, 9, 9,
+		9, 9, 9, 9,
+		9, 9, 1, 0,
+	});
+
+	//Negative offset clips the top left
+	dst = make_image({4,3}, std::vector<uint8_t>(12, 9));
+	PaletteImage::blit(src, Rect<int>{0,0,3,2}, dst, Vec2<int>{-1,-1});
+	test_image("negative offset", dst, {
+		4, 0, 9, 9,
+		9, 9, 9, 9,
+		9, 9, 9, 9,
+	});
+
+	//Source sub-rectangle, transparent
+	dst = make_image({4,3}, std::vector<uint8_t>(12, 9));
+	PaletteImage::blit(src, Rect<int>{1,0,3,2}, dst, Vec2<int>{1,1}, BlitMode::Transparent);
+	test_image("sub-rect transparent", dst, {
+		9, 9, 9, 9,
+		9, 9, 2, 9,
+		9, 4, 9, 9,
+	});
+
+	//Entirely outside the destination
+	dst = make_image({4,3}, std::vector<uint8_t>(12, 9));
+	PaletteImage::blit(src, Rect<int>{0,0,3,2}, dst, Vec2<int>{4,0});
+	PaletteImage::blit(src, Rect<int>{0,0,3,2}, dst, Vec2<int>{-3,0});
+	test_image("outside", dst, std::vector<uint8_t>(12, 9));
+
+	//Long rows to cover the vectorised transparent path
+	std::vector<uint8_t> row(40), expectedRow(40);
+	for (int i = 0; i < 40; i++)
+	{
+		row[i] = (i % 3 == 0) ? 0 : i;
+		expectedRow[i] = (i % 3 == 0) ? 7 : i;
+	}
+	auto longSrc = make_image({40,1}, row);
+	dst = make_image({40,1}, std::vector<uint8_t>(40, 7));
+	PaletteImage::blit(longSrc, Rect<int>{0,0,40,1}, dst, Vec2<int>{0,0}, BlitMode::Transparent);
+	test_image("long transparent row", dst, expectedRow);
+
+	//RGB transparency is keyed on alpha
+	auto rgbSrc = std::make_shared<RGBImage>(Vec2<unsigned int>{9,1}, Colour{10,20,30,255});
+	{
+		RGBImageLock l(rgbSrc, ImageLockUse::Write);
+		Colour clear{1,2,3,0};
+		l.set({4,0}, clear);
+	}
+	auto rgbDst = std::make_shared<RGBImage>(Vec2<unsigned int>{9,1}, Colour{0,0,0,255});
+	RGBImage::blit(rgbSrc, Rect<int>{0,0,9,1}, rgbDst, Vec2<int>{0,0}, BlitMode::Transparent);
+	{
+		RGBImageLock l(rgbDst, ImageLockUse::Read);
+		for (unsigned int x = 0; x < 9; x++)
+		{
+			Colour c = l.get({x,0});
+			uint8_t expected = (x == 4) ? 0 : 10;
+			if (c.r != expected)
+			{
+				LogError("RGB transparent blit pixel %u has red %d, expected %d", x, c.r, expected);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	//Opaque bounds, used to trim sprites
+	auto sparse = make_image({5,4}, {
+		0, 0, 0, 0, 0,
+		0, 0, 3, 0, 0,
+		0, 1, 0, 0, 0,
+		0, 0, 0, 0, 0,
+	});
+	if (!(sparse->getOpaqueBounds() == Rect<int>{1,1,3,3}))
+	{
+		Rect<int> r = sparse->getOpaqueBounds();
+		LogError("Sparse image bounds {%d,%d,%d,%d}, expected {1,1,3,3}", r.p0.x, r.p0.y, r.p1.x, r.p1.y);
+		exit(EXIT_FAILURE);
+	}
+	if (!(src->getOpaqueBounds() == Rect<int>{0,0,3,2}))
+	{
+		LogError("Full image bounds don't cover the whole image");
+		exit(EXIT_FAILURE);
+	}
+	if (!(make_image({3,2}, std::vector<uint8_t>(6, 0))->getOpaqueBounds() == Rect<int>{0,0,0,0}))
+	{
+		LogError("Transparent image bounds aren't empty");
+		exit(EXIT_FAILURE);
+	}
+
+	return EXIT_SUCCESS;
+}
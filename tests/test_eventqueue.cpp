@@ -0,0 +1,181 @@
+#include "framework/eventqueue.h"
+#include "framework/logger.h"
+
+#include <thread>
+
+using namespace OpenApoc;
+
+static Event make_key_event(int keyCode)
+{
+	Event e;
+	e.Type = EVENT_KEY_DOWN;
+	e.Data.Keyboard.KeyCode = keyCode;
+	e.Data.Keyboard.UniChar = 0;
+	e.Data.Keyboard.Modifiers = 0;
+	return e;
+}
+
+static Event make_mouse_move(int x, int y, int dx, int dy, int button = 0)
+{
+	Event e;
+	e.Type = EVENT_MOUSE_MOVE;
+	e.Data.Mouse.X = x;
+	e.Data.Mouse.Y = y;
+	e.Data.Mouse.DeltaX = dx;
+	e.Data.Mouse.DeltaY = dy;
+	e.Data.Mouse.WheelVertical = 0;
+	e.Data.Mouse.WheelHorizontal = 0;
+	e.Data.Mouse.Button = button;
+	return e;
+}
+
+void test_order_and_capacity()
+{
+	EventQueue q(5);
+	//Capacity gets rounded up to 8
+	for (int i = 0; i < 8; i++)
+	{
+		if (!q.push(make_key_event(i)))
+		{
+			LogError("Push %d failed on a queue with free space", i);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (q.push(make_key_event(8)))
+	{
+		LogError("Push succeeded on a full queue");
+		exit(EXIT_FAILURE);
+	}
+	Event e;
+	for (int i = 0; i < 8; i++)
+	{
+		if (!q.pop(e, true) || e.Type != EVENT_KEY_DOWN || e.Data.Keyboard.KeyCode != i)
+		{
+			LogError("Pop %d returned the wrong event", i);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (q.pop(e, true))
+	{
+		LogError("Pop succeeded on an empty queue");
+		exit(EXIT_FAILURE);
+	}
+	//Wrap around the ring a few times
+	for (int i = 0; i < 100; i++)
+	{
+		q.push(make_key_event(i));
+		if (!q.pop(e, true) || e.Data.Keyboard.KeyCode != i)
+		{
+			LogError("Pop after wrap %d returned the wrong event", i);
+			exit(EXIT_FAILURE);
+		}
+	}
+	auto stats = q.getStats();
+	if (stats.pushed != 108 || stats.popped != 108 || stats.dropped != 1 || stats.maxDepth != 8)
+	{
+		LogError("Unexpected stats pushed %llu popped %llu dropped %llu maxDepth %u",
+			(unsigned long long)stats.pushed, (unsigned long long)stats.popped,
+			(unsigned long long)stats.dropped, (unsigned)stats.maxDepth);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_coalesce()
+{
+	EventQueue q(16);
+	q.push(make_mouse_move(10, 10, 1, 1));
+	q.push(make_mouse_move(12, 11, 2, 1));
+	q.push(make_mouse_move(15, 15, 3, 4));
+	q.push(make_key_event(1));
+	q.push(make_mouse_move(16, 15, 1, 0));
+	q.push(make_mouse_move(17, 15, 1, 0, 1));
+
+	Event e;
+	if (!q.pop(e, true) || e.Type != EVENT_MOUSE_MOVE ||
+	    e.Data.Mouse.X != 15 || e.Data.Mouse.Y != 15 ||
+	    e.Data.Mouse.DeltaX != 6 || e.Data.Mouse.DeltaY != 6)
+	{
+		LogError("Mouse moves not coalesced correctly");
+		exit(EXIT_FAILURE);
+	}
+	if (!q.pop(e, true) || e.Type != EVENT_KEY_DOWN)
+	{
+		LogError("Coalescing moved a mouse move past a key event");
+		exit(EXIT_FAILURE);
+	}
+	//Different buttons held are kept apart
+	if (!q.pop(e, true) || e.Data.Mouse.X != 16 || !q.pop(e, true) || e.Data.Mouse.X != 17)
+	{
+		LogError("Mouse moves with different buttons were coalesced");
+		exit(EXIT_FAILURE);
+	}
+	if (q.getStats().coalesced != 2)
+	{
+		LogError("Expected 2 coalesced events, got %llu", (unsigned long long)q.getStats().coalesced);
+		exit(EXIT_FAILURE);
+	}
+
+	q.push(make_mouse_move(1, 1, 1, 1));
+	q.push(make_mouse_move(2, 2, 1, 1));
+	if (!q.pop(e, false) || e.Data.Mouse.X != 1 || !q.pop(e, false) || e.Data.Mouse.X != 2)
+	{
+		LogError("Mouse moves coalesced with coalescing disabled");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_multiple_producers()
+{
+	const int producers = 4;
+	const int eventsPerProducer = 100000;
+	EventQueue q(256);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < producers; t++)
+	{
+		threads.emplace_back([&q, t]()
+		{
+			for (int i = 0; i < eventsPerProducer; i++)
+			{
+				Event e = make_key_event(i);
+				e.Data.Keyboard.UniChar = t;
+				while (!q.push(e))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	std::vector<int> next(producers, 0);
+	int received = 0;
+	Event e;
+	while (received < producers * eventsPerProducer)
+	{
+		if (!q.pop(e, true))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		int t = e.Data.Keyboard.UniChar;
+		if (t < 0 || t >= producers || e.Data.Keyboard.KeyCode != next[t])
+		{
+			LogError("Producer %d event out of order: got %d expected %d", t, e.Data.Keyboard.KeyCode, next[t]);
+			exit(EXIT_FAILURE);
+		}
+		next[t]++;
+		received++;
+	}
+	for (auto &t : threads)
+		t.join();
+	if (q.pop(e, true))
+	{
+		LogError("Extra event left in queue");
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	test_order_and_capacity();
+	test_coalesce();
+	test_multiple_producers();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include "forms/hittestgrid.h"
+#include "framework/logger.h"
+
+#include <random>
+
+using namespace OpenApoc;
+
+static int brute_force_find(const std::vector<Rect<int>> &rects, Vec2<int> p)
+{
+	for (unsigned i = 0; i < rects.size(); i++)
+	{
+		Rect<int> r = rects[i];
+		if (r.within(p))
+			return i;
+	}
+	return -1;
+}
+
+void test_hit(const HitTestGrid &grid, Vec2<int> p, int expected)
+{
+	int found = grid.Find(p);
+	if (found != expected)
+	{
+		LogError("Point {%d,%d} hit %d, expected %d", p.x, p.y, found, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_overlapping()
+{
+	HitTestGrid grid(64);
+	//A button on top of a panel on top of a form
+	grid.Add(Rect<int>(100, 100, 150, 120));
+	grid.Add(Rect<int>(50, 50, 300, 300));
+	grid.Add(Rect<int>(0, 0, 640, 480));
+	//Zero-sized controls never get hit
+	grid.Add(Rect<int>(10, 10, 10, 40));
+	grid.Build();
+
+	test_hit(grid, Vec2<int>{100, 100}, 0);
+	test_hit(grid, Vec2<int>{149, 119}, 0);
+	test_hit(grid, Vec2<int>{150, 119}, 1);
+	test_hit(grid, Vec2<int>{10, 20}, 2);
+	test_hit(grid, Vec2<int>{639, 479}, 2);
+	test_hit(grid, Vec2<int>{640, 479}, -1);
+	test_hit(grid, Vec2<int>{-1, 0}, -1);
+}
+
+void test_random()
+{
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> pos(-200, 1000);
+	std::uniform_int_distribution<int> size(0, 150);
+
+	std::vector<Rect<int>> rects;
+	HitTestGrid grid(32);
+	for (int i = 0; i < 500; i++)
+	{
+		int x = pos(rng), y = pos(rng);
+		Rect<int> r(x, y, x + size(rng), y + size(rng));
+		rects.push_back(r);
+		grid.Add(r);
+	}
+	grid.Build();
+
+	for (int i = 0; i < 20000; i++)
+	{
+		Vec2<int> p{pos(rng), pos(rng)};
+		test_hit(grid, p, brute_force_find(rects, p));
+	}
+}
+
+void test_empty()
+{
+	HitTestGrid grid;
+	grid.Build();
+	test_hit(grid, Vec2<int>{0, 0}, -1);
+	grid.Add(Rect<int>(0, 0, 10, 10));
+	grid.Build();
+	test_hit(grid, Vec2<int>{5, 5}, 0);
+	grid.Clear();
+	grid.Build();
+	test_hit(grid, Vec2<int>{5, 5}, -1);
+}
+
+int main(int argc, char **argv)
+{
+	test_overlapping();
+	test_random();
+	test_empty();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include "game/tileview/occlusion.h"
+#include "framework/image.h"
+#include "framework/palette.h"
+#include "framework/logger.h"
+
+using namespace OpenApoc;
+
+static std::shared_ptr<PaletteImage> make_image(Vec2<unsigned int> size, uint8_t index)
+{
+	return std::make_shared<PaletteImage>(size, index);
+}
+
+void test_hidden(const OcclusionBuffer &buffer, const SpriteCoverage &coverage, Vec2<float> pos, bool expected)
+{
+	if (buffer.isHidden(coverage, pos) != expected)
+	{
+		LogError("Sprite at {%f,%f} %s hidden", pos.x, pos.y, expected ? "should be" : "shouldn't be");
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	auto palette = std::make_shared<Palette>(256, Colour{255,255,255,255});
+	//Index 0 is transparent, 2 is translucent
+	palette->colours[0] = Colour{0,0,0,0};
+	palette->colours[2] = Colour{0,0,0,128};
+
+	SpriteCoverage wall(make_image({32,32}, 1), palette);
+	SpriteCoverage glass(make_image({32,32}, 2), palette);
+	SpriteCoverage small(make_image({8,8}, 1), palette);
+	SpriteCoverage empty(make_image({8,8}, 0), palette);
+
+	if (!(wall.bounds == Rect<int>{0,0,32,32}) || wall.rowSpans[5] != std::make_pair(0,32))
+	{
+		LogError("Opaque sprite coverage wrong");
+		exit(EXIT_FAILURE);
+	}
+	if (glass.rowSpans[5] != std::make_pair(0,0))
+	{
+		LogError("Translucent pixels counted as opaque");
+		exit(EXIT_FAILURE);
+	}
+	if (wall.translucent || empty.translucent || !glass.translucent)
+	{
+		LogError("Sprite translucency wrong");
+		exit(EXIT_FAILURE);
+	}
+
+	OcclusionBuffer buffer(Vec2<int>{64,64});
+	test_hidden(buffer, small, {10,10}, false);
+	//Anything off screen, or with nothing to draw, is hidden
+	test_hidden(buffer, small, {-20,10}, true);
+	test_hidden(buffer, small, {10,70}, true);
+	test_hidden(buffer, empty, {10,10}, true);
+
+	buffer.occlude(glass, {0,0});
+	test_hidden(buffer, small, {10,10}, false);
+
+	//Between pixels, the wall doesn't hide anything
+	buffer.occlude(wall, {0.5f,0});
+	test_hidden(buffer, small, {10,10}, false);
+
+	buffer.occlude(wall, {0,0});
+	test_hidden(buffer, small, {10,10}, true);
+	test_hidden(buffer, small, {24,24}, true);
+	//Overlapping the edge of the wall
+	test_hidden(buffer, small, {28,10}, false);
+	test_hidden(buffer, small, {10.5f,10}, true);
+
+	//Misaligned with the blocks, only the blocks fully inside are hidden
+	buffer.reset(Vec2<int>{64,64});
+	buffer.occlude(wall, {4,4});
+	test_hidden(buffer, small, {8,8}, true);
+	test_hidden(buffer, small, {4,4}, false);
+	test_hidden(buffer, small, {28,28}, false);
+
+	int area = buffer.visibleArea(wall, {48,-16});
+	if (area != 16 * 16)
+	{
+		LogError("Visible area %d, expected %d", area, 16 * 16);
+		exit(EXIT_FAILURE);
+	}
+
+	return EXIT_SUCCESS;
+}
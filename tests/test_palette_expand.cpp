@@ -0,0 +1,73 @@
+#include "framework/palette_expand.h"
+#include "framework/logger.h"
+
+#include <random>
+
+using namespace OpenApoc;
+
+typedef void (*ExpandFunction)(const Colour*, const uint8_t*, Colour*, size_t);
+
+void test_expand(const char *name, ExpandFunction expand, const Colour *table,
+	const std::vector<uint8_t> &indices, size_t offset, size_t count)
+{
+	std::vector<Colour> expected(count + 1, Colour{1,2,3,4});
+	std::vector<Colour> result(count + 1, Colour{1,2,3,4});
+
+	PaletteExpandScalar(table, indices.data() + offset, expected.data(), count);
+	expand(table, indices.data() + offset, result.data(), count);
+
+	for (size_t i = 0; i <= count; i++)
+	{
+		const Colour &e = expected[i], &r = result[i];
+		if (e.r != r.r || e.g != r.g || e.b != r.b || e.a != r.a)
+		{
+			LogError("%s: pixel %u of %u (offset %u) is {%d,%d,%d,%d}, expected {%d,%d,%d,%d}",
+				name, (unsigned)i, (unsigned)count, (unsigned)offset,
+				r.r, r.g, r.b, r.a, e.r, e.g, e.b, e.a);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> byte(0, 255);
+
+	Colour table[256];
+	for (int i = 0; i < 256; i++)
+		table[i] = Colour(byte(rng), byte(rng), byte(rng), byte(rng));
+
+	std::vector<uint8_t> indices(4096 + 64);
+	for (auto &i : indices)
+		i = byte(rng);
+
+	//The scalar path against a straight lookup
+	std::vector<Colour> out(indices.size());
+	PaletteExpandScalar(table, indices.data(), out.data(), indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		const Colour &c = table[indices[i]];
+		if (out[i].r != c.r || out[i].g != c.g || out[i].b != c.b || out[i].a != c.a)
+		{
+			LogError("Scalar expand pixel %u incorrect", (unsigned)i);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	//Odd lengths and unaligned offsets to catch any tail handling problems
+	for (size_t count : {0, 1, 7, 8, 9, 15, 16, 17, 63, 576, 4096})
+	{
+		for (size_t offset : {0, 1, 3})
+		{
+			test_expand("PaletteExpand", PaletteExpand, table, indices, offset, count);
+			if (PaletteExpandSIMDSupported())
+				test_expand("PaletteExpandSIMD", PaletteExpandSIMD, table, indices, offset, count);
+		}
+	}
+
+	if (!PaletteExpandSIMDSupported())
+		LogWarning("SIMD palette expansion not supported on this CPU - only tested the scalar path");
+
+	return EXIT_SUCCESS;
+}
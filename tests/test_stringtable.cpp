@@ -0,0 +1,94 @@
+#include "library/stringtable.h"
+#include "framework/logger.h"
+
+#include <cstring>
+
+using namespace OpenApoc;
+
+void test_lookup(const StringTable &table, const UString &id, const char *expected)
+{
+	const char *value = table.lookup(id);
+	if (expected == nullptr)
+	{
+		if (value != nullptr)
+		{
+			LogError("Lookup of missing ID \"%s\" returned \"%s\"", id.str().c_str(), value);
+			exit(EXIT_FAILURE);
+		}
+		return;
+	}
+	if (value == nullptr || strcmp(value, expected) != 0)
+	{
+		LogError("Lookup of \"%s\" returned \"%s\" expected \"%s\"", id.str().c_str(),
+			value ? value : "(null)", expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	StringTable table;
+	test_lookup(table, "STR_MISSING", nullptr);
+
+	table.add("STR_START_CAMPAIGN", "Start Campaign");
+	table.add("STR_QUIT", "Quit");
+	table.add("STR_EMPTY", "");
+	table.add("STR_ZURICH", "Z\xC3\xBCrich");
+	test_lookup(table, "STR_START_CAMPAIGN", "Start Campaign");
+	test_lookup(table, "STR_QUIT", "Quit");
+	test_lookup(table, "STR_EMPTY", "");
+	test_lookup(table, "STR_ZURICH", "Z\xC3\xBCrich");
+	test_lookup(table, "STR_MISSING", nullptr);
+	test_lookup(table, "", nullptr);
+
+	table.add("STR_QUIT", "Exit");
+	test_lookup(table, "STR_QUIT", "Exit");
+	if (table.size() != 4)
+	{
+		LogError("Redefining a string changed the table size to %d", (int)table.size());
+		exit(EXIT_FAILURE);
+	}
+
+	//Enough entries to grow the index a few times
+	for (int i = 0; i < 1000; i++)
+		table.add(Strings::FromInteger(i), Strings::FromInteger(i * 2));
+	for (int i = 0; i < 1000; i++)
+		test_lookup(table, Strings::FromInteger(i), Strings::FromInteger(i * 2).str().c_str());
+	test_lookup(table, "STR_START_CAMPAIGN", "Start Campaign");
+
+	std::string image = table.serialise();
+	StringTable loaded;
+	if (!loaded.deserialise(image.data(), image.size()) || loaded.size() != table.size())
+	{
+		LogError("Failed to load a saved string table");
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < 1000; i++)
+		test_lookup(loaded, Strings::FromInteger(i), Strings::FromInteger(i * 2).str().c_str());
+	test_lookup(loaded, "STR_QUIT", "Exit");
+	test_lookup(loaded, "STR_MISSING", nullptr);
+
+	//Truncated or corrupt images are rejected
+	if (loaded.deserialise(image.data(), image.size() - 1) || loaded.size() != 0)
+	{
+		LogError("Loaded a truncated string table");
+		exit(EXIT_FAILURE);
+	}
+	std::string corrupt = image;
+	corrupt[0] = 'X';
+	if (loaded.deserialise(corrupt.data(), corrupt.size()))
+	{
+		LogError("Loaded a string table with a bad header");
+		exit(EXIT_FAILURE);
+	}
+
+	StringTable overrides;
+	overrides.add("STR_QUIT", "Leave");
+	overrides.add("STR_NEW", "New");
+	table.merge(overrides);
+	test_lookup(table, "STR_QUIT", "Leave");
+	test_lookup(table, "STR_NEW", "New");
+	test_lookup(table, "STR_START_CAMPAIGN", "Start Campaign");
+
+	return EXIT_SUCCESS;
+}
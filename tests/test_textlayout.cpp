@@ -0,0 +1,50 @@
+#include "framework/textlayout.h"
+#include "framework/logger.h"
+
+using namespace OpenApoc;
+
+//Every glyph is 1 pixel wide, so widths are just character counts
+static int unit_width(UniChar c)
+{
+	std::ignore = c;
+	return 1;
+}
+
+void test_wrap(const UString &text, int width, std::vector<UString> expected)
+{
+	auto lines = wrapParagraph(text, width, unit_width);
+	bool match = lines.size() == expected.size();
+	for (size_t i = 0; match && i < lines.size(); i++)
+	{
+		if (lines[i] != expected[i])
+			match = false;
+	}
+	if (!match)
+	{
+		LogError("Wrapping \"%s\" to %d gave %d lines:", text.str().c_str(), width, (int)lines.size());
+		for (auto &l : lines)
+			LogError("  \"%s\"", l.str().c_str());
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	test_wrap("", 10, {""});
+	test_wrap("short", 10, {"short"});
+	test_wrap("exactly10!", 10, {"exactly10!"});
+	test_wrap("the quick brown fox", 10, {"the quick", "brown fox"});
+	test_wrap("the quick brown fox", 9, {"the quick", "brown fox"});
+	test_wrap("the quick brown fox", 8, {"the", "quick", "brown", "fox"});
+	//Runs of spaces at a break are dropped
+	test_wrap("aaaa     bbbb", 6, {"aaaa", "bbbb"});
+	//A word longer than the line is split
+	test_wrap("abcdefghij xy", 4, {"abcd", "efgh", "ij", "xy"});
+	//Even with no room at all every line takes one character
+	test_wrap("abc", 0, {"a", "b", "c"});
+	//Leading indentation is kept on the first line only
+	test_wrap("  ab cd ef", 5, {"  ab", "cd ef"});
+	//Non-ASCII text is wrapped by codepoint
+	test_wrap(UString(L"été été"), 3, {UString(L"été"), UString(L"été")});
+	return EXIT_SUCCESS;
+}
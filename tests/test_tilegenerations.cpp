@@ -0,0 +1,117 @@
+#include "game/tileview/tilegenerations.h"
+#include "framework/logger.h"
+
+using namespace OpenApoc;
+
+//Follows the map's changes the way TileView's chunks do, counting the
+//blocks it had to rebuild
+class TestView
+{
+	private:
+		const TileGenerations &map;
+		std::vector<uint32_t> baked;
+		std::vector<bool> built;
+
+	public:
+		TestView(const TileGenerations &map) : map(map)
+		{
+			auto count = map.getBlockCount();
+			baked.resize(count.x * count.y * count.z, 0);
+			built.resize(baked.size(), false);
+		}
+
+		std::vector<Vec3<int>> render()
+		{
+			std::vector<Vec3<int>> rebuilt;
+			auto count = map.getBlockCount();
+			for (int z = 0; z < count.z; z++)
+				for (int y = 0; y < count.y; y++)
+					for (int x = 0; x < count.x; x++)
+					{
+						Vec3<int> block{x, y, z};
+						size_t i = (z * count.y + y) * count.x + x;
+						if (built[i] && baked[i] == map.get(block))
+							continue;
+						built[i] = true;
+						baked[i] = map.get(block);
+						rebuilt.push_back(block);
+					}
+			return rebuilt;
+		}
+};
+
+void test_rebuilt(const char *step, TestView &view, std::vector<Vec3<int>> expected)
+{
+	auto rebuilt = view.render();
+	if (rebuilt != expected)
+	{
+		LogError("%s: rebuilt %u blocks, expected %u", step, (unsigned)rebuilt.size(), (unsigned)expected.size());
+		for (auto &b : rebuilt)
+			LogError("  rebuilt %d,%d,%d", b.x, b.y, b.z);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_blocks()
+{
+	//The city's size - a partial block at the far edge of x
+	TileGenerations map(Vec3<int>{100, 96, 10});
+	auto count = map.getBlockCount();
+	if (count != Vec3<int>{7, 6, 10})
+	{
+		LogError("Got %d,%d,%d blocks, expected 7,6,10", count.x, count.y, count.z);
+		exit(EXIT_FAILURE);
+	}
+	if (TileGenerations::blockOf(Vec3<int>{15, 16, 3}) != Vec3<int>{0, 1, 3} ||
+	    TileGenerations::blockOf(Vec3<int>{99, 95, 9}) != Vec3<int>{6, 5, 9})
+	{
+		LogError("Tiles put in the wrong blocks");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_changes()
+{
+	TileGenerations map(Vec3<int>{100, 96, 10});
+	TestView view(map);
+	TestView lateView(map);
+
+	auto all = view.render();
+	if (all.size() != 7 * 6 * 10)
+	{
+		LogError("First render built %u blocks", (unsigned)all.size());
+		exit(EXIT_FAILURE);
+	}
+	test_rebuilt("Nothing changed", view, {});
+
+	//A static object changing rebuilds just its block
+	map.changed(Vec3<int>{20, 40, 2});
+	test_rebuilt("One change", view, {Vec3<int>{1, 2, 2}});
+	test_rebuilt("Already rebuilt", view, {});
+
+	//Several changes in a block still rebuild it once, on each side of a
+	//block edge
+	map.changed(Vec3<int>{15, 0, 0});
+	map.changed(Vec3<int>{15, 15, 0});
+	map.changed(Vec3<int>{16, 0, 0});
+	map.changed(Vec3<int>{99, 95, 9});
+	test_rebuilt("Block edges", view, {Vec3<int>{0, 0, 0}, Vec3<int>{1, 0, 0}, Vec3<int>{6, 5, 9}});
+
+	//A view that hasn't looked in a while catches everything up at once,
+	//however many changes it missed
+	for (int i = 0; i < 100000; i++)
+		map.changed(Vec3<int>{50, 50, 5});
+	test_rebuilt("Many changes", view, {Vec3<int>{3, 3, 5}});
+	lateView.render();
+	test_rebuilt("Late view", lateView, {});
+	map.changed(Vec3<int>{0, 95, 0});
+	test_rebuilt("Late view, new change", lateView, {Vec3<int>{0, 5, 0}});
+	test_rebuilt("First view, new change", view, {Vec3<int>{0, 5, 0}});
+}
+
+int main(int argc, char **argv)
+{
+	test_blocks();
+	test_changes();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#include "game/tileview/tilerange.h"
+#include "framework/logger.h"
+
+#include <random>
+
+using namespace OpenApoc;
+
+//The test TileView used to make for every tile
+static bool tile_visible(Vec3<int> tileSize, Vec2<int> windowSize, Vec2<int> origin, int x, int y)
+{
+	float sx = (x * tileSize.x / 2.0f) - (y * tileSize.x / 2.0f) + origin.x;
+	float sy = (x * tileSize.y / 2.0f) + (y * tileSize.y / 2.0f) + origin.y;
+	return !(sx + tileSize.x < 0 || sy + tileSize.y < 0
+		|| sx - tileSize.x > windowSize.x || sy - tileSize.y > windowSize.y);
+}
+
+static void test_range(Vec3<int> tileSize, Vec2<int> mapSize, Vec2<int> windowSize, Vec2<int> origin)
+{
+	VisibleTileRange range(tileSize, mapSize, windowSize, origin, Vec2<int>{tileSize.x, tileSize.y});
+	for (int y = 0; y < mapSize.y; y++)
+	{
+		for (int x = 0; x < mapSize.x; x++)
+		{
+			bool inRange = !range.empty() && y >= range.yMin && y <= range.yMax &&
+				x >= range.xMin(y) && x <= range.xMax(y);
+			if (inRange != tile_visible(tileSize, windowSize, origin, x, y))
+			{
+				LogError("Tile {%d,%d} %s in range with origin {%d,%d}, window {%d,%d}", x, y,
+					inRange ? "wrongly" : "not", origin.x, origin.y, windowSize.x, windowSize.y);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	//The city's tiles
+	Vec3<int> tileSize{64, 32, 16};
+	Vec2<int> mapSize{100, 100};
+
+	test_range(tileSize, mapSize, Vec2<int>{800, 600}, Vec2<int>{0, 0});
+	test_range(tileSize, mapSize, Vec2<int>{800, 600}, Vec2<int>{400, -160});
+	//Off every edge of the map
+	test_range(tileSize, mapSize, Vec2<int>{800, 600}, Vec2<int>{-10000, 0});
+	test_range(tileSize, mapSize, Vec2<int>{800, 600}, Vec2<int>{0, 10000});
+	test_range(tileSize, mapSize, Vec2<int>{800, 600}, Vec2<int>{0, -10000});
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> offset(-4000, 4000);
+	std::uniform_int_distribution<int> window(1, 1500);
+	for (int i = 0; i < 500; i++)
+	{
+		test_range(tileSize, Vec2<int>{1 + (int)(rng() % 120), 1 + (int)(rng() % 120)},
+			Vec2<int>{window(rng), window(rng)}, Vec2<int>{offset(rng), offset(rng)});
+	}
+	//Odd tile sizes, where tiles land on half pixels
+	for (int i = 0; i < 100; i++)
+	{
+		test_range(Vec3<int>{17, 9, 5}, mapSize, Vec2<int>{window(rng), window(rng)}, Vec2<int>{offset(rng), offset(rng)});
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#include "library/strings.h"
+#include "framework/logger.h"
+
+using namespace OpenApoc;
+
+void test_length(const UString &s, size_t expected)
+{
+	if (s.length() != expected)
+	{
+		LogError("String \"%s\" has length %u, expected %u",
+			s.str().c_str(), (unsigned)s.length(), (unsigned)expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_char_at(const UString &s, size_t pos, UniChar expected)
+{
+	if (s[pos] != expected)
+	{
+		LogError("String \"%s\" char %u is 0x%x, expected 0x%x",
+			s.str().c_str(), (unsigned)pos, s[pos], expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_equal(const UString &s, const UString &expected)
+{
+	if (s != expected || !(s == expected) || s.compare(expected) != 0)
+	{
+		LogError("String \"%s\" does not match expected \"%s\"",
+			s.str().c_str(), expected.str().c_str());
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_split(const UString &s, const UString &delims, std::vector<UString> expected)
+{
+	auto split = s.split(delims);
+	if (split.size() != expected.size())
+	{
+		LogError("Splitting \"%s\" gave %u strings, expected %u",
+			s.str().c_str(), (unsigned)split.size(), (unsigned)expected.size());
+		exit(EXIT_FAILURE);
+	}
+	for (size_t i = 0; i < split.size(); i++)
+		test_equal(split[i], expected[i]);
+}
+
+void test_iterate(const UString &s, std::vector<UniChar> expected)
+{
+	size_t i = 0;
+	for (auto c : s)
+	{
+		if (i >= expected.size() || c != expected[i])
+		{
+			LogError("Iterating \"%s\" mismatch at char %u",
+				s.str().c_str(), (unsigned)i);
+			exit(EXIT_FAILURE);
+		}
+		i++;
+	}
+	if (i != expected.size())
+	{
+		LogError("Iterating \"%s\" gave %u chars, expected %u",
+			s.str().c_str(), (unsigned)i, (unsigned)expected.size());
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	//"Zürich €1 𝄞" - 1, 2, 3 and 4 byte utf8 sequences
+	UString mixed("Z\xC3\xBCrich \xE2\x82\xAC" "1 \xF0\x9D\x84\x9E");
+
+	test_length(UString(), 0);
+	test_length(UString("BUTTON_QUIT"), 11);
+	test_length(mixed, 11);
+
+	test_char_at(mixed, 0, 'Z');
+	test_char_at(mixed, 1, 0xFC);
+	test_char_at(mixed, 7, 0x20AC);
+	test_char_at(mixed, 10, 0x1D11E);
+	test_char_at(UString("\xFF"), 0, 0xFFFD);
+	test_char_at(UString::u8Char(' '), 0, ' ');
+
+	test_iterate(mixed, {'Z', 0xFC, 'r', 'i', 'c', 'h', ' ', 0x20AC, '1', ' ', 0x1D11E});
+	test_iterate(UString(), {});
+
+	test_equal(UString((UniChar)0x20AC), "\xE2\x82\xAC");
+	test_equal(mixed.substr(1, 5), "\xC3\xBCrich");
+	test_equal(mixed.substr(7), "\xE2\x82\xAC" "1 \xF0\x9D\x84\x9E");
+	test_equal(mixed.substr(20), "");
+	test_equal(UString("ABC") + UString("\xC3\xBC"), "ABC\xC3\xBC");
+
+	test_equal(UString("xcom:/Data/Ufo2p.pck").toUpper(), "XCOM:/DATA/UFO2P.PCK");
+	test_equal(UString("XCOM:/Data").toLower(), "xcom:/data");
+	test_equal(UString("z\xC3\xBCrich").toUpper(), "Z\xC3\x9CRICH");
+	test_equal(UString("Z\xC3\x9CRICH").toLower(), "z\xC3\xBCrich");
+
+	UString edited("ab\xE2\x82\xAC" "cd");
+	edited.remove(2, 1);
+	test_equal(edited, "abcd");
+	edited.insert(1, "\xC3\xBC");
+	test_equal(edited, "a\xC3\xBC" "bcd");
+	edited.remove(3, 10);
+	test_equal(edited, "a\xC3\xBC" "b");
+	//Indexing ASCII strings skips the utf8 walk - check the strings stay
+	//right as they go in and out of being ASCII
+	edited.remove(1, 1);
+	test_char_at(edited, 1, 'b');
+	test_char_at(edited, 2, 0xFFFF);
+	test_length(edited, 2);
+	edited += UString((UniChar)0x20AC);
+	test_char_at(edited, 2, 0x20AC);
+	test_length(edited, 3);
+	UString ascii("ABCDEF");
+	test_char_at(ascii, 5, 'F');
+	test_char_at(ascii, 6, 0xFFFF);
+	test_equal(ascii.substr(2, 3), "CDE");
+	test_equal(ascii.substr(4, UString::npos), "EF");
+	ascii.insert(3, "\xC3\xBC");
+	test_char_at(ascii, 4, 'D');
+	test_length(ascii, 7);
+
+	test_split("PCK:xcom3/ufodata/city.pck:city.tab:0", ":",
+		{"PCK", "xcom3/ufodata/city.pck", "city.tab", "0"});
+	test_split("", ",", {""});
+	test_split("a,,b,", ",", {"a", "", "b", ""});
+	test_split("a\xE2\x82\xAC" "b c", "\xE2\x82\xAC ", {"a", "b", "c"});
+
+	if (!(UString("A") < UString("B")) || UString("B") < UString("A")
+		|| UString("A").compare("B") >= 0 || UString("B").compare("A") <= 0)
+	{
+		LogError("String ordering incorrect");
+		exit(EXIT_FAILURE);
+	}
+
+	std::wstring wide = mixed.wstr();
+	test_equal(UString(wide), mixed);
+	test_length(UString(L"ab"), 2);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+#include "forms/virtualrows.h"
+#include "framework/logger.h"
+
+using namespace OpenApoc;
+
+//Rows are never dereferenced, so stand-ins are just distinct addresses
+static char rowStorage[256];
+
+static Control* make_row(int n)
+{
+	return reinterpret_cast<Control*>(&rowStorage[n]);
+}
+
+//An item source that reuses any row offered, counting the new ones made
+struct TestSource
+{
+	int created;
+	int reused;
+	std::vector<Control*> detached;
+
+	TestSource() : created(0), reused(0) {}
+
+	bool update(VirtualRows &rows, int offset, int height, int stride, int count, bool invalidate)
+	{
+		int first, end;
+		VirtualRows::Window(offset, height, stride, count, 2, first, end);
+		return rows.Update(first, end, invalidate,
+			[this](int Index, Control* Recycled) -> Control*
+			{
+				std::ignore = Index;
+				if (Recycled != nullptr)
+				{
+					reused++;
+					return Recycled;
+				}
+				return make_row(created++);
+			},
+			[this](Control* Row) { detached.push_back(Row); });
+	}
+};
+
+void test_window(int offset, int count, int expectedFirst, int expectedEnd)
+{
+	int first, end;
+	//Ten 10 pixel rows in view, two extra either side
+	VirtualRows::Window(offset, 100, 10, count, 2, first, end);
+	if (first != expectedFirst || end != expectedEnd)
+	{
+		LogError("Offset %d of %d items gave rows [%d,%d), expected [%d,%d)",
+			offset, count, first, end, expectedFirst, expectedEnd);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_state(const char *step, const VirtualRows &rows, int first, size_t live, size_t spare)
+{
+	if (rows.GetFirst() != first || rows.GetRows().size() != live || rows.GetSpare().size() != spare)
+	{
+		LogError("%s: first %d, %u live, %u spare - expected first %d, %u live, %u spare", step,
+			rows.GetFirst(), (unsigned)rows.GetRows().size(), (unsigned)rows.GetSpare().size(),
+			first, (unsigned)live, (unsigned)spare);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_count(const char *step, const char *what, int value, int expected)
+{
+	if (value != expected)
+	{
+		LogError("%s: %d %s, expected %d", step, value, what, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void test_windows()
+{
+	test_window(0, 100, 0, 13);
+	test_window(455, 100, 43, 58);
+	//Scrolled to the last page
+	test_window(900, 100, 88, 100);
+	//Scrolled past the end, e.g. before the scrollbar is clamped
+	test_window(5000, 100, 100, 100);
+	test_window(900, 5, 5, 5);
+	test_window(0, 5, 0, 5);
+	test_window(0, 0, 0, 0);
+}
+
+void test_scroll_and_shrink()
+{
+	VirtualRows rows;
+	TestSource source;
+
+	source.update(rows, 0, 100, 10, 100, false);
+	test_state("Top", rows, 0, 13, 0);
+	test_count("Top", "rows made", source.created, 13);
+	if (source.update(rows, 0, 100, 10, 100, false))
+	{
+		LogError("Update with the same window reported a change");
+		exit(EXIT_FAILURE);
+	}
+
+	//Scrolling a little keeps the rows still in view, and the one that
+	//left is reused before any new rows are made
+	source.update(rows, 30, 100, 10, 100, false);
+	test_state("Scrolled 3 rows", rows, 1, 15, 0);
+	test_count("Scrolled 3 rows", "rows detached", source.detached.size(), 1);
+	test_count("Scrolled 3 rows", "rows reused", source.reused, 1);
+	test_count("Scrolled 3 rows", "rows made", source.created, 15);
+	if (rows.GetRows()[0] != make_row(1) || source.detached[0] != make_row(0))
+	{
+		LogError("Scrolling moved the wrong rows");
+		exit(EXIT_FAILURE);
+	}
+
+	source.detached.clear();
+	source.reused = 0;
+
+	//Past the end every row leaves the window and is kept as spare
+	source.update(rows, 5000, 100, 10, 100, false);
+	test_state("Past the end", rows, 100, 0, 15);
+	test_count("Past the end", "rows detached", source.detached.size(), 15);
+
+	//Back to the last page, which reuses spares instead of making rows
+	source.detached.clear();
+	source.update(rows, 900, 100, 10, 100, false);
+	test_state("Last page", rows, 88, 12, 3);
+	test_count("Last page", "rows made", source.created, 15);
+	test_count("Last page", "rows reused", source.reused, 12);
+
+	//Shrinking the item count under the scroll position empties the
+	//window, detaching exactly the rows that were live
+	std::vector<Control*> live = rows.GetRows();
+	source.update(rows, 900, 100, 10, 5, false);
+	test_state("Shrunk", rows, 5, 0, 15);
+	if (source.detached != live)
+	{
+		LogError("Shrinking detached the wrong rows");
+		exit(EXIT_FAILURE);
+	}
+
+	//Once scrolled back, the remaining items are filled from the spares
+	source.detached.clear();
+	source.update(rows, 0, 100, 10, 5, true);
+	test_state("Shrunk, top", rows, 0, 5, 10);
+	test_count("Shrunk, top", "rows made", source.created, 15);
+	test_count("Shrunk, top", "rows detached", source.detached.size(), 0);
+
+	//Invalidating refills every row, again from the spares
+	source.update(rows, 0, 100, 10, 5, true);
+	test_state("Invalidated", rows, 0, 5, 10);
+	test_count("Invalidated", "rows detached", source.detached.size(), 5);
+	test_count("Invalidated", "rows made", source.created, 15);
+
+	//Reset hands back only the spares - the live rows belong to the owner
+	live = rows.GetRows();
+	auto freed = rows.Reset();
+	test_state("Reset", rows, 0, 0, 0);
+	test_count("Reset", "spare rows freed", freed.size(), 10);
+	for (auto row : live)
+	{
+		if (std::find(freed.begin(), freed.end(), row) != freed.end())
+		{
+			LogError("Reset freed a live row");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+void test_declined_rows()
+{
+	VirtualRows rows;
+	TestSource source;
+	source.update(rows, 0, 100, 10, 20, false);
+	source.update(rows, 5000, 100, 10, 20, false);
+	test_state("Spares", rows, 20, 0, 13);
+
+	//A source that makes its own row (or none) leaves the offered spare
+	int offered = 0;
+	rows.Update(0, 2, false,
+		[&offered](int Index, Control* Recycled) -> Control*
+		{
+			if (Recycled != nullptr)
+				offered++;
+			return Index == 0 ? make_row(200) : nullptr;
+		},
+		[](Control* Row) { std::ignore = Row; });
+	test_state("Declined", rows, 0, 2, 13);
+	test_count("Declined", "spares offered", offered, 2);
+	if (rows.GetRows()[0] != make_row(200) || rows.GetRows()[1] != nullptr)
+	{
+		LogError("Declined rows weren't kept as given");
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	test_windows();
+	test_scroll_and_shrink();
+	test_declined_rows();
+	return EXIT_SUCCESS;
+}